@@ -0,0 +1,317 @@
+#include "AnalysisCache.h"
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    //==============================================================================
+    // XXH64 (reference algorithm, little-endian reads)
+    constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t prime3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+    inline uint64_t rotl(uint64_t x, int r) noexcept { return (x << r) | (x >> (64 - r)); }
+
+    inline uint64_t read64(const uint8_t* p) noexcept
+    {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+        return v;
+    }
+
+    inline uint32_t read32(const uint8_t* p) noexcept
+    {
+        return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    }
+
+    inline uint64_t round(uint64_t acc, uint64_t input) noexcept
+    {
+        acc += input * prime2;
+        return rotl(acc, 31) * prime1;
+    }
+
+    inline uint64_t mergeRound(uint64_t acc, uint64_t v) noexcept
+    {
+        acc ^= round(0, v);
+        return acc * prime1 + prime4;
+    }
+
+    uint64_t xxh64(const void* data, size_t len, uint64_t seed) noexcept
+    {
+        const uint8_t* p = static_cast<const uint8_t*> (data);
+        const uint8_t* const end = p + len;
+        uint64_t h;
+
+        if (len >= 32)
+        {
+            uint64_t v1 = seed + prime1 + prime2, v2 = seed + prime2, v3 = seed, v4 = seed - prime1;
+            for (; p + 32 <= end; p += 32)
+            {
+                v1 = round(v1, read64(p));
+                v2 = round(v2, read64(p + 8));
+                v3 = round(v3, read64(p + 16));
+                v4 = round(v4, read64(p + 24));
+            }
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = mergeRound(h, v1);
+            h = mergeRound(h, v2);
+            h = mergeRound(h, v3);
+            h = mergeRound(h, v4);
+        }
+        else
+        {
+            h = seed + prime5;
+        }
+
+        h += (uint64_t)len;
+
+        for (; p + 8 <= end; p += 8)
+            h = rotl(h ^ round(0, read64(p)), 27) * prime1 + prime4;
+        if (p + 4 <= end)
+        {
+            h = rotl(h ^ ((uint64_t)read32(p) * prime1), 23) * prime2 + prime3;
+            p += 4;
+        }
+        for (; p < end; ++p)
+            h = rotl(h ^ ((uint64_t)*p * prime5), 11) * prime1;
+
+        h ^= h >> 33; h *= prime2;
+        h ^= h >> 29; h *= prime3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    //==============================================================================
+    constexpr juce::int64 regionBytes = 64 * 1024;   // per sampled region
+
+    juce::var floatArray(const float* v, int n)
+    {
+        juce::Array<juce::var> a;
+        for (int i = 0; i < n; ++i) a.add((double)v[i]);
+        return a;
+    }
+
+    bool readFloatArray(const juce::var& v, float* out, int n)
+    {
+        auto* a = v.getArray();
+        if (a == nullptr || a->size() != n) return false;
+        for (int i = 0; i < n; ++i) out[i] = (float)(double)a->getReference(i);
+        return true;
+    }
+}
+
+AnalysisCache::AnalysisCache(const juce::File& directory)
+    : dir(directory)
+{
+}
+
+juce::File AnalysisCache::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("Canonkey").getChildFile("AnalysisCache");
+}
+
+juce::String AnalysisCache::computeKey(const juce::File& audioFile)
+{
+    juce::FileInputStream in(audioFile);
+    if (!in.openedOk()) return {};
+
+    const juce::int64 size = in.getTotalLength();
+    const juce::int64 mtime = audioFile.getLastModificationTime().toMilliseconds();
+    const int32_t version = (int32_t)analysisVersion;
+
+    // Size, mtime and version are appended field by field: a struct would hash its
+    // uninitialised padding and give the same file a different key per run
+    constexpr size_t trailerBytes = sizeof(size) + sizeof(mtime) + sizeof(version);
+
+    // Small files are hashed whole, larger ones at head / middle / tail
+    juce::HeapBlock<uint8_t> buf;
+    size_t used = 0;
+    auto addRegion = [&](juce::int64 pos, juce::int64 n)
+        {
+            if (!in.setPosition(pos)) return false;
+            const int got = in.read(buf.get() + used, (int)n);
+            if (got != (int)n) return false;
+            used += (size_t)got;
+            return true;
+        };
+
+    bool ok = true;
+    if (size <= 3 * regionBytes)
+    {
+        buf.malloc((size_t)juce::jmax<juce::int64>(1, size) + trailerBytes);
+        ok = addRegion(0, size);
+    }
+    else
+    {
+        buf.malloc((size_t)(3 * regionBytes) + trailerBytes);
+        ok = addRegion(0, regionBytes)
+            && addRegion((size - regionBytes) / 2, regionBytes)
+            && addRegion(size - regionBytes, regionBytes);
+    }
+    if (!ok) return {};
+
+    auto append = [&](const void* field, size_t bytes)
+        {
+            std::memcpy(buf.get() + used, field, bytes);
+            used += bytes;
+        };
+    append(&size, sizeof(size));
+    append(&mtime, sizeof(mtime));
+    append(&version, sizeof(version));
+
+    return juce::String::toHexString((juce::int64)xxh64(buf.get(), used, 0)).paddedLeft('0', 16);
+}
+
+juce::File AnalysisCache::entryFile(const juce::String& key) const
+{
+    // Two-level layout keeps directories small on large libraries
+    return dir.getChildFile(key.substring(0, 2)).getChildFile(key + ".json");
+}
+
+bool AnalysisCache::lookup(const juce::String& key, const juce::File& audioFile, FileAnalysis::Result& out,
+    bool acceptPartial) const
+{
+    if (key.isEmpty()) return false;
+
+    const auto f = entryFile(key);
+    if (!f.existsAsFile()) return false;
+
+    const auto v = juce::JSON::parse(f.loadFileAsString());
+    if (!v.isObject() || (int)v["version"] != analysisVersion) return false;
+    if ((bool)v["earlyExit"] && !acceptPartial) return false;
+
+    FileAnalysis::Result r;
+    r.file = audioFile;
+    r.ok = true;
+    r.fromCache = true;
+    r.bpm = (float)(double)v["bpm"];
+    r.bpmConfidence = (float)(double)v["bpmConfidence"];
+    r.keyIndex = (int)v["keyIndex"];
+    r.isMinor = (bool)v["isMinor"];
+    r.keyConfidence = (float)(double)v["keyConfidence"];
+    r.tuningCents = (float)(double)v["tuningCents"];
+    r.sampleRate = (double)v["sampleRate"];
+    r.durationSec = (double)v["durationSec"];
+    r.analysedSec = (double)v["analysedSec"];
+    r.earlyExit = (bool)v["earlyExit"];
+    r.converged = (bool)v["converged"];
+
+    if (!readFloatArray(v["chroma"], r.chroma.data(), 12))
+        return false;
+
+    if (auto* curve = v["tempoCurve"].getArray(); curve != nullptr && curve->size() == FileAnalysis::tempoCurvePoints)
+    {
+        r.tempoCurve.resize((size_t)FileAnalysis::tempoCurvePoints);
+        readFloatArray(v["tempoCurve"], r.tempoCurve.data(), FileAnalysis::tempoCurvePoints);
+    }
+
+    if (auto* hyps = v["tempoHypotheses"].getArray())
+    {
+        for (int i = 0; i < juce::jmin(hyps->size(), BpmTracker::maxHypotheses); ++i)
+            r.tempoHypotheses[(size_t)i] = { (float)(double)(*hyps)[i]["bpm"], (float)(double)(*hyps)[i]["score"] };
+    }
+
+    if (auto* segs = v["segments"].getArray())
+    {
+        for (const auto& sv : *segs)
+        {
+            FileAnalysis::Segment s;
+            s.startSec = (double)sv["start"];
+            s.endSec = (double)sv["end"];
+            s.bpm = (float)(double)sv["bpm"];
+            s.bpmConfidence = (float)(double)sv["bpmConfidence"];
+            s.keyIndex = (int)sv["keyIndex"];
+            s.isMinor = (bool)sv["isMinor"];
+            s.keyConfidence = (float)(double)sv["keyConfidence"];
+            r.segments.push_back(s);
+        }
+    }
+
+    out = std::move(r);
+    return true;
+}
+
+bool AnalysisCache::store(const juce::String& key, const FileAnalysis::Result& r) const
+{
+    if (key.isEmpty() || !r.ok) return false;
+
+    auto* o = new juce::DynamicObject();
+    o->setProperty("version", analysisVersion);
+    o->setProperty("file", r.file.getFileName());
+    o->setProperty("bpm", (double)r.bpm);
+    o->setProperty("bpmConfidence", (double)r.bpmConfidence);
+    o->setProperty("keyIndex", r.keyIndex);
+    o->setProperty("isMinor", r.isMinor);
+    o->setProperty("keyConfidence", (double)r.keyConfidence);
+    o->setProperty("tuningCents", (double)r.tuningCents);
+    o->setProperty("sampleRate", r.sampleRate);
+    o->setProperty("durationSec", r.durationSec);
+    o->setProperty("analysedSec", r.analysedSec);
+    o->setProperty("earlyExit", r.earlyExit);
+    o->setProperty("converged", r.converged);
+    o->setProperty("chroma", floatArray(r.chroma.data(), 12));
+    if (!r.tempoCurve.empty())
+        o->setProperty("tempoCurve", floatArray(r.tempoCurve.data(), (int)r.tempoCurve.size()));
+
+    juce::Array<juce::var> hyps;
+    for (const auto& h : r.tempoHypotheses)
+    {
+        if (h.bpm <= 0.0f) break;
+        auto* ho = new juce::DynamicObject();
+        ho->setProperty("bpm", (double)h.bpm);
+        ho->setProperty("score", (double)h.score);
+        hyps.add(juce::var(ho));
+    }
+    if (!hyps.isEmpty())
+        o->setProperty("tempoHypotheses", hyps);
+
+    if (!r.segments.empty())
+    {
+        juce::Array<juce::var> segs;
+        for (const auto& s : r.segments)
+        {
+            auto* so = new juce::DynamicObject();
+            so->setProperty("start", s.startSec);
+            so->setProperty("end", s.endSec);
+            so->setProperty("bpm", (double)s.bpm);
+            so->setProperty("bpmConfidence", (double)s.bpmConfidence);
+            so->setProperty("keyIndex", s.keyIndex);
+            so->setProperty("isMinor", s.isMinor);
+            so->setProperty("keyConfidence", (double)s.keyConfidence);
+            segs.add(juce::var(so));
+        }
+        o->setProperty("segments", segs);
+    }
+
+    const auto f = entryFile(key);
+    if (!f.getParentDirectory().createDirectory()) return false;
+
+    // replaceWithText writes a temporary file and moves it over: readers never see half an entry
+    return f.replaceWithText(juce::JSON::toString(juce::var(o), true));
+}
+
+FileAnalysis::Result AnalysisCache::getOrAnalyze(const juce::File& audioFile,
+    const std::function<FileAnalysis::Result()>& analyse, bool acceptPartial)
+{
+    const auto key = computeKey(audioFile);
+
+    FileAnalysis::Result r;
+    if (lookup(key, audioFile, r, acceptPartial))
+    {
+        ++hits;
+        return r;
+    }
+
+    ++misses;
+    r = analyse();
+    store(key, r);
+    return r;
+}
+
+void AnalysisCache::clear()
+{
+    dir.deleteRecursively();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+#include "FileAnalysis.h"
+
+// On-disk cache of FileAnalysis results, one small JSON entry per file.
+// Entries are keyed by XXH64 over sampled content regions (head, middle, tail),
+// the file size and mtime plus analysisVersion, so a hit needs ~200 KB of reads
+// and no decoding. Safe to share between threads (entries are written whole).
+class AnalysisCache
+{
+public:
+    // Bump whenever analyzer settings or algorithms change the results
+    //   2: prefetch decoding (different read-block boundaries)
+    //   3: decimating front-end
+    //   4: ranked tempo hypotheses and octave stage
+    static constexpr int analysisVersion = 4;
+
+    explicit AnalysisCache(const juce::File& directory = getDefaultDirectory());
+
+    // <user app data>/Canonkey/AnalysisCache
+    static juce::File getDefaultDirectory();
+
+    // Content key (16 hex digits); empty if the file cannot be read
+    static juce::String computeKey(const juce::File& audioFile);
+
+    // Cached result for key (file/fromCache filled in); false on miss or stale entry.
+    // Early-exit entries only count when acceptPartial is set.
+    bool lookup(const juce::String& key, const juce::File& audioFile, FileAnalysis::Result& out,
+        bool acceptPartial = false) const;
+
+    // Store a successful result under key
+    bool store(const juce::String& key, const FileAnalysis::Result& r) const;
+
+    // Serve from cache, otherwise run analyse() and store the result if it succeeded
+    // (a full analysis later replaces an early-exit entry)
+    FileAnalysis::Result getOrAnalyze(const juce::File& audioFile,
+        const std::function<FileAnalysis::Result()>& analyse, bool acceptPartial = false);
+
+    // Drop every entry
+    void clear();
+
+    int getHits() const noexcept   { return hits.load(); }
+    int getMisses() const noexcept { return misses.load(); }
+
+private:
+    juce::File entryFile(const juce::String& key) const;
+
+    juce::File dir;
+    std::atomic<int> hits{ 0 }, misses{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnalysisCache)
+};
@@ -0,0 +1,62 @@
+#include "AnalysisChain.h"
+
+AnalysisChain::AnalysisChain(double sampleRate,
+    const BpmTracker::Settings& bpmSettings,
+    const KeyDetector::Settings& keySettings,
+    int decimation)
+    : sr(sampleRate > 0.0 ? sampleRate : 44100.0),
+    decimationFactor(decimation > 0 ? decimation : PolyphaseDecimator::chooseFactor(sr)),
+    analysisRate(sr / (double)decimationFactor),
+    bpm(analysisRate, bpmSettings),
+    key(analysisRate, keySettings)
+{
+    frontEnd.setDecimation(decimationFactor);
+    bpm.attachTo(frontEnd);
+    key.attachTo(frontEnd);
+}
+
+void AnalysisChain::processMono(const float* samples, int numSamples)
+{
+    frontEnd.processMono(samples, numSamples);
+}
+
+void AnalysisChain::reset()
+{
+    frontEnd.reset();
+    bpm.reset();
+    key.reset(analysisRate);
+}
+
+void AnalysisChain::setBeatOutput(BeatEventQueue* queue, juce::int64 streamStart) noexcept
+{
+    // The tracker counts decimated samples from the reset
+    bpm.getBeatTracker().setOutput(queue, (double)decimationFactor,
+        (double)streamStart + frontEnd.getDecimationOffset());
+}
+
+void AnalysisChain::setQualityTier(int tier) noexcept
+{
+    qualityTier = juce::jlimit(0, maxQualityTier, tier);
+    const int stride = 1 << qualityTier;
+    key.setFrameStride(stride);
+    bpm.setTempoInterval(stride);
+}
+
+void AnalysisChain::finishOffline()
+{
+    bpm.finishOffline();
+    key.finishOffline();
+}
+
+void AnalysisChain::restartOfflineStream()
+{
+    // Key frames are scored independently; only the BPM envelope must not span the seam
+    frontEnd.reset();
+    bpm.reset(false);
+}
+
+void AnalysisChain::resetOfflineAggregate() noexcept
+{
+    bpm.resetOfflineAggregate();
+    key.resetOfflineAggregate();
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <JuceHeader.h>
+#include "SpectralFrontEnd.h"
+#include "BpmTracker.h"
+#include "KeyDetector.h"
+
+// Mono stream -> polyphase decimation to ~20-24 kHz -> one shared STFT front-end
+// -> BpmTracker + KeyDetector. Both analyzers read nothing above 8 kHz, so they
+// run at the decimated rate with frame sizes scaled to keep their 44.1 kHz bin
+// widths (BPM 2048/512, Key 4096/2048 there): the same work at any device rate.
+// The stream is buffered once and each spectrum is computed once.
+class AnalysisChain
+{
+public:
+    // decimation: 0 = automatic (PolyphaseDecimator::chooseFactor), 1 = off
+    explicit AnalysisChain(double sampleRate,
+        const BpmTracker::Settings& bpmSettings = {},
+        const KeyDetector::Settings& keySettings = {},
+        int decimation = 0);
+
+    // Feed time-domain mono samples (any block size)
+    void processMono(const float* samples, int numSamples);
+
+    // Clear stream/analysis state, keep allocations
+    void reset();
+
+    // Offline mode: compute the whole-range BPM/key aggregate
+    void finishOffline();
+    // Offline mode: forget the aggregate (e.g. after a warm-up range), keep stream state
+    void resetOfflineAggregate() noexcept;
+    // Offline mode: the next samples do not follow the previous ones (probe window
+    // elsewhere in the file): clear stream state, keep the aggregate
+    void restartOfflineStream();
+
+    double getSampleRate() const noexcept { return sr; }
+    // Rate the analyzers run at (sampleRate / decimation factor)
+    double getAnalysisRate() const noexcept { return analysisRate; }
+
+    // Live: route beat events to queue (nullptr = off), timestamps in input samples
+    // counted from streamStart at the last reset. Call again after reset().
+    void setBeatOutput(BeatEventQueue* queue, juce::int64 streamStart = 0) noexcept;
+
+    // Skip the transforms of frames that peak below thresholdDb (live idle, gaps between
+    // tracks); the analyzers hold their state through them. Off by default.
+    void setSilenceGate(bool enabled, float thresholdDb = -60.0f) noexcept { frontEnd.setSilenceGate(enabled, thresholdDb); }
+
+    // Live quality scaling (LoadGovernor): tier 0 = full; each tier halves the key frame
+    // rate (its STFT is skipped too) and the BPM tempo pick rate. The onset envelope
+    // and beat PLL always run at full rate. Kept across reset(). Analysis thread.
+    static constexpr int maxQualityTier = 3;
+    void setQualityTier(int tier) noexcept;
+    int getQualityTier() const noexcept { return qualityTier; }
+
+    // Offline: append the per-frame features (FeatureFile) to these vectors, nullptr = off
+    void setFeatureCapture(std::vector<float>* envelope, std::vector<float>* chroma) noexcept
+    {
+        bpm.setEnvelopeCapture(envelope);
+        key.setChromaCapture(chroma);
+    }
+
+    // Samples that complete the next frame of the fastest consumer
+    int getHopSize() const noexcept { return frontEnd.getSmallestHop(); }
+
+    BpmTracker&  getBpmTracker() noexcept  { return bpm; }
+    KeyDetector& getKeyDetector() noexcept { return key; }
+
+private:
+    double sr;
+    int decimationFactor;
+    double analysisRate;
+    SpectralFrontEnd frontEnd;
+    BpmTracker  bpm;
+    KeyDetector key;
+    int qualityTier = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(AnalysisChain)
+};
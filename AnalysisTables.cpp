@@ -0,0 +1,17 @@
+#include "AnalysisTables.h"
+#include <cmath>
+
+namespace AnalysisTables
+{
+    std::shared_ptr<const std::vector<float>> getHannWindow(int size)
+    {
+        static Cache<int, std::vector<float>> windows;
+        return windows.get(size, [size]
+            {
+                auto w = std::make_shared<std::vector<float>>((size_t)size);
+                for (int n = 0; n < size; ++n)
+                    (*w)[(size_t)n] = 0.5f * (1.0f - std::cos(2.0f * juce::MathConstants<float>::pi * (float)n / (float)(size - 1)));
+                return std::shared_ptr<const std::vector<float>>(std::move(w));
+            });
+    }
+}
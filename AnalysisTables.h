@@ -0,0 +1,38 @@
+#pragma once
+#include <JuceHeader.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Immutable tables shared by every analyzer instance with the same configuration.
+// Analysis windows and band layouts are built once per process and handed out
+// read-only, so constructing a BpmTracker / KeyDetector / front-end for another file
+// or a live restart costs a lookup instead of rebuilding them.
+// FFT engines are not tables: a transform may write engine state (IPP work buffers,
+// a lock in the fallback engine), and chains run on whichever thread claims them,
+// so every front-end and BpmTracker owns its own juce::dsp::FFT.
+// Any thread; lookups lock, so call at construction time, not per frame.
+namespace AnalysisTables
+{
+    // One shared value per key, built by make() (returning shared_ptr<const Value>) on first use
+    template <typename Key, typename Value>
+    class Cache
+    {
+    public:
+        template <typename Make>
+        std::shared_ptr<const Value> get(const Key& key, Make&& make)
+        {
+            const juce::ScopedLock sl(lock);
+            auto& slot = entries[key];
+            if (slot == nullptr) slot = make();
+            return slot;
+        }
+
+    private:
+        juce::CriticalSection lock;
+        std::map<Key, std::shared_ptr<const Value>> entries;
+    };
+
+    // Symmetric Hann window of size points
+    std::shared_ptr<const std::vector<float>> getHannWindow(int size);
+}
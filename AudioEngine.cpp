@@ -1,4 +1,32 @@
 #include "AudioEngine.h"
+#include "RealtimeGuard.h"
+#include "Telemetry.h"
+
+namespace
+{
+// Times one device callback / native packet; flags callbacks that took longer than the
+// audio they carry. Stage timers inside the taps record on this thread meanwhile.
+struct CallbackTimer
+{
+    CallbackTimer(int numSamples, double sampleRate) noexcept
+        : budgetNs(sampleRate > 0.0 ? (uint64_t)(1.0e9 * (double)numSamples / sampleRate) : 0)
+    {
+    }
+
+    ~CallbackTimer() noexcept
+    {
+        const auto elapsed = Telemetry::nowNanos() - start;
+        Telemetry::record(Telemetry::Stage::audioCallback, elapsed);
+        Telemetry::increment(Telemetry::Counter::audioBlocks);
+        if (budgetNs > 0 && elapsed > budgetNs)
+            Telemetry::increment(Telemetry::Counter::callbackOverruns);
+    }
+
+    Telemetry::ScopedThreadRecording recording;
+    const uint64_t budgetNs;
+    const uint64_t start = Telemetry::nowNanos();
+};
+}
 
 static bool isWASAPITypeName(const juce::String& s)
 {
@@ -202,19 +230,29 @@ bool AudioEngine::startBestInputForLive(juce::String& error)
 #if JUCE_WINDOWS
     // 2) Fallback: native WASAPI loopback of default render endpoint
     wasapiLoopback = std::make_unique<WasapiLoopback>();
-    bool ok = wasapiLoopback->start(
-        [this](const float* const* input, int numCh, int numSamples, double sr)
-        {
-            // Publish SR changes for native loopback path as well
-            static double lastSr = 0.0;
-            if (onSampleRateChanged && sr > 0.0 && std::abs(sr - lastSr) > 1.0)
+    nativeLoopbackRate = 0.0;
+    bool ok = false;
+    if (onInterleavedBlock)
+    {
+        // Interleaved tap: packets go straight to the listener, no planar copy
+        ok = wasapiLoopback->startInterleaved(
+            [this](const void* frames, SimdKernels::SampleFormat format, int numCh, int numFrames, double sr)
             {
-                lastSr = sr;
-                onSampleRateChanged(sr);
-            }
-
-            if (onAudioBlock) onAudioBlock(input, numCh, numSamples, sr);
-        }, error);
+                CallbackTimer timer(numFrames, sr);
+                publishNativeLoopbackRate(sr);
+                if (onInterleavedBlock) onInterleavedBlock(frames, format, numCh, numFrames, sr);
+            }, error);
+    }
+    else
+    {
+        ok = wasapiLoopback->start(
+            [this](const float* const* input, int numCh, int numSamples, double sr)
+            {
+                CallbackTimer timer(numSamples, sr);
+                publishNativeLoopbackRate(sr);
+                if (onAudioBlock) onAudioBlock(input, numCh, numSamples, sr);
+            }, error);
+    }
     if (ok) { running.store(true); return true; }
     wasapiLoopback.reset();
 #endif
@@ -225,6 +263,16 @@ bool AudioEngine::startBestInputForLive(juce::String& error)
     return false;
 }
 
+void AudioEngine::publishNativeLoopbackRate(double sr)
+{
+    // Publish SR changes for native loopback path as well
+    if (onSampleRateChanged && sr > 0.0 && std::abs(sr - nativeLoopbackRate) > 1.0)
+    {
+        nativeLoopbackRate = sr;
+        onSampleRateChanged(sr);
+    }
+}
+
 void AudioEngine::stop()
 {
 #if JUCE_WINDOWS
@@ -242,8 +290,18 @@ void AudioEngine::stop()
     if (onSampleRateChanged) onSampleRateChanged(0.0);
 }
 
+int AudioEngine::getXRunCount() const
+{
+#if JUCE_WINDOWS
+    if (wasapiLoopback) return wasapiLoopback->getDiscontinuityCount();
+#endif
+    auto* dev = deviceManager.getCurrentAudioDevice();
+    return dev ? juce::jmax(0, dev->getXRunCount()) : 0;
+}
+
 AudioEngine::DeviceInfo AudioEngine::getCurrentDeviceInfo() const
 {
+    RealtimeGuard::assertNotRealtime();
     std::scoped_lock lk(infoMutex);
     return info;
 }
@@ -255,16 +313,16 @@ void AudioEngine::audioDeviceIOCallbackWithContext(const float* const* input, in
     int numSamples,
     const juce::AudioIODeviceCallbackContext&)
 {
+    auto* dev = deviceManager.getCurrentAudioDevice();
+    const double sr = dev ? dev->getCurrentSampleRate() : 0.0;
+    CallbackTimer timer(numSamples, sr);
+
     for (int ch = 0; ch < numOut; ++ch)
         if (output[ch] != nullptr)
             juce::FloatVectorOperations::clear(output[ch], numSamples);
 
     if (onAudioBlock != nullptr && numIn > 0)
-    {
-        auto* dev = deviceManager.getCurrentAudioDevice();
-        const double sr = dev ? dev->getCurrentSampleRate() : 0.0;
         onAudioBlock(input, numIn, numSamples, sr);
-    }
 }
 
 void AudioEngine::audioDeviceAboutToStart(juce::AudioIODevice* device)
@@ -318,7 +376,7 @@ std::vector<AudioEngine::DeviceEntry> AudioEngine::enumerateDevices()
     return out;
 }
 
-bool AudioEngine::startWithDevice(const DeviceEntry& entry, juce::String& error)
+bool AudioEngine::startWithDevice(const DeviceEntry& entry, juce::String& error, int numInputChannels)
 {
     stop();
     error.clear();
@@ -357,8 +415,13 @@ bool AudioEngine::startWithDevice(const DeviceEntry& entry, juce::String& error)
 
     setup.inputDeviceName = entry.name;
     setup.outputDeviceName = {};
-    setup.useDefaultInputChannels = true;
+    setup.useDefaultInputChannels = numInputChannels <= 0;
     setup.useDefaultOutputChannels = false;
+    if (numInputChannels > 0)
+    {
+        setup.inputChannels.clear();
+        setup.inputChannels.setRange(0, numInputChannels, true);
+    }
 
     auto err = deviceManager.setAudioDeviceSetup(setup, true);
     if (err.isNotEmpty()) { error = err; return false; }
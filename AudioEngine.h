@@ -1,6 +1,7 @@
 #pragma once
 #include <JuceHeader.h>
 #include <functional>
+#include "SimdKernels.h"
 #if JUCE_WINDOWS
 #include "WasapiLoopback.h"
 #endif
@@ -33,7 +34,9 @@ public:
     };
 
     std::vector<DeviceEntry> enumerateDevices();
-    bool startWithDevice(const DeviceEntry& entry, juce::String& error);
+    // numInputChannels > 0 opens the first N inputs instead of the device default
+    // (multi-stream setups need every channel group of the interface)
+    bool startWithDevice(const DeviceEntry& entry, juce::String& error, int numInputChannels = 0);
 
     struct DeviceInfo
     {
@@ -44,12 +47,21 @@ public:
     };
     DeviceInfo getCurrentDeviceInfo() const;
 
+    // Device-reported xruns (discontinuities on the native loopback path); message thread.
+    // JUCE devices that cannot tell report 0.
+    int getXRunCount() const;
+
     juce::AudioDeviceManager& getDeviceManager() noexcept { return deviceManager; }
 
     // Realtime audio block tap
     std::function<void(const float* const* input, int numCh, int numSamples, double sampleRate)>
         onAudioBlock;
 
+    // Optional interleaved tap, preferred by sources that deliver interleaved packets
+    // (native WASAPI loopback). frames == nullptr means numFrames of silence.
+    std::function<void(const void* frames, SimdKernels::SampleFormat format, int numCh, int numFrames, double sampleRate)>
+        onInterleavedBlock;
+
     // NEW: notify listeners when the device sample-rate changes (or starts/stops)
     std::function<void(double newSampleRate)> onSampleRateChanged;
 
@@ -68,6 +80,9 @@ private:
     mutable std::mutex infoMutex;
     DeviceInfo info;
 
+    double nativeLoopbackRate = 0.0;  // last SR published from the native loopback thread
+    void publishNativeLoopbackRate(double sr);
+
     bool setDeviceType(const juce::String& typeName);
     juce::String findWASAPILoopbackName();
     juce::String findDefaultInputForType(const juce::String& typeName);
@@ -0,0 +1,176 @@
+#include "BatchAnalyzer.h"
+#include "AnalysisCache.h"
+#include "FeatureFile.h"
+#include <cmath>
+
+class BatchAnalyzer::Job : public juce::ThreadPoolJob
+{
+public:
+    Job(BatchAnalyzer& ownerRef, const juce::File& f)
+        : juce::ThreadPoolJob("Analyze " + f.getFileName()), owner(ownerRef), file(f) {}
+
+    JobStatus runJob() override
+    {
+        auto shouldStop = [this] { return shouldExit(); };
+
+        if (owner.featureDir != juce::File())
+        {
+            FeatureFile::Features features;
+            auto r = FileAnalysis::analyzeFile(file, shouldStop, {}, &features);
+            if (r.ok)
+            {
+                const auto out = FeatureFile::getFeatureFile(owner.featureDir, file);
+                if (out == juce::File() || !FeatureFile::write(features, out))
+                {
+                    r.ok = false;
+                    r.error = "Cannot write features.";
+                }
+                else if (owner.cache)
+                {
+                    owner.cache->store(AnalysisCache::computeKey(file), r);
+                }
+            }
+            owner.jobFinished(r);
+            return jobHasFinished;
+        }
+
+        auto analyse = [&]
+            {
+                return owner.earlyExit ? FileAnalysis::analyzeFileEarlyExit(file, owner.earlyExitOptions, shouldStop)
+                                       : FileAnalysis::analyzeFile(file, shouldStop);
+            };
+        auto r = owner.cache ? owner.cache->getOrAnalyze(file, analyse, owner.earlyExit) : analyse();
+        owner.jobFinished(r);
+        return jobHasFinished;
+    }
+
+private:
+    BatchAnalyzer& owner;
+    juce::File file;
+};
+
+BatchAnalyzer::BatchAnalyzer(int numThreads)
+    : numWorkers(numThreads > 0 ? numThreads : juce::jmax(1, juce::SystemStats::getNumCpus())),
+    pool(numWorkers)
+{
+    finishedEvent.signal();
+}
+
+BatchAnalyzer::~BatchAnalyzer()
+{
+    cancel();
+}
+
+juce::Array<juce::File> BatchAnalyzer::collectAudioFiles(const juce::Array<juce::File>& filesOrDirs, bool recursive)
+{
+    juce::Array<juce::File> out;
+    for (const auto& f : filesOrDirs)
+    {
+        if (f.isDirectory())
+        {
+            for (const auto& entry : juce::RangedDirectoryIterator(f, recursive, "*", juce::File::findFiles))
+                if (FileAnalysis::isSupportedAudioFile(entry.getFile()))
+                    out.add(entry.getFile());
+        }
+        else if (f.existsAsFile() && FileAnalysis::isSupportedAudioFile(f))
+        {
+            out.add(f);
+        }
+    }
+    return out;
+}
+
+bool BatchAnalyzer::start(const juce::Array<juce::File>& files, ResultCallback resultCb, FinishedCallback finishedCb)
+{
+    if (running.exchange(true)) return false;
+
+    onResult = std::move(resultCb);
+    onFinished = std::move(finishedCb);
+
+    total.store(files.size());
+    pending.store(files.size());
+    completed.store(0);
+    failed.store(0);
+    audioMicros.store(0);
+    decodedMicros.store(0);
+    startMs.store(juce::Time::getMillisecondCounterHiRes());
+    endMs.store(0.0);
+    finishedEvent.reset();
+
+    if (files.isEmpty())
+    {
+        endMs.store(startMs.load());
+        running.store(false);
+        finishedEvent.signal();
+        if (onFinished) onFinished(getStats());
+        return true;
+    }
+
+    for (const auto& f : files)
+        pool.addJob(new Job(*this, f), true);
+
+    return true;
+}
+
+void BatchAnalyzer::jobFinished(const FileAnalysis::Result& r)
+{
+    if (r.cancelled) return;   // cancel() settles the books
+
+    if (r.ok)
+    {
+        audioMicros.fetch_add((juce::int64)std::llround(r.durationSec * 1.0e6));
+        if (!r.fromCache)
+            decodedMicros.fetch_add((juce::int64)std::llround(r.analysedSec * 1.0e6));
+    }
+    else
+    {
+        failed.fetch_add(1);
+    }
+    completed.fetch_add(1);
+
+    if (onResult) onResult(r);
+
+    if (pending.fetch_sub(1) == 1)
+    {
+        endMs.store(juce::Time::getMillisecondCounterHiRes());
+        running.store(false);
+        if (onFinished) onFinished(getStats());
+        finishedEvent.signal();
+    }
+}
+
+void BatchAnalyzer::cancel()
+{
+    if (!running.load()) return;
+
+    // Running jobs see shouldExit() and return; queued ones are deleted unrun
+    pool.removeAllJobs(true, -1);
+
+    if (running.load())
+    {
+        endMs.store(juce::Time::getMillisecondCounterHiRes());
+        pending.store(0);
+        running.store(false);
+        if (onFinished) onFinished(getStats());
+        finishedEvent.signal();
+    }
+}
+
+bool BatchAnalyzer::waitForCompletion(int timeoutMs)
+{
+    return finishedEvent.wait(timeoutMs);
+}
+
+BatchAnalyzer::Stats BatchAnalyzer::getStats() const noexcept
+{
+    Stats s;
+    s.total = total.load();
+    s.completed = completed.load();
+    s.failed = failed.load();
+    s.audioSec = (double)audioMicros.load() * 1.0e-6;
+    s.decodedSec = (double)decodedMicros.load() * 1.0e-6;
+
+    const double end = endMs.load() > 0.0 ? endMs.load() : juce::Time::getMillisecondCounterHiRes();
+    s.elapsedSec = juce::jmax(0.0, (end - startMs.load()) * 0.001);
+    return s;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+#include "FileAnalysis.h"
+
+class AnalysisCache;
+
+// Library-scale batch analysis: one independent decode + AnalysisChain per
+// file, spread over a worker pool sized to the core count. Usable from the UI
+// and from headless entry points (no GUI / message thread dependencies).
+class BatchAnalyzer
+{
+public:
+    struct Stats
+    {
+        int    total = 0, completed = 0, failed = 0;
+        double elapsedSec = 0.0;   // wall clock since start()
+        double audioSec = 0.0;     // audio analysed so far
+        double decodedSec = 0.0;   // audio actually decoded (less than audioSec with early exit / cache hits)
+
+        double filesPerSecond() const noexcept { return elapsedSec > 0.0 ? (double)completed / elapsedSec : 0.0; }
+        double realtimeFactor() const noexcept { return elapsedSec > 0.0 ? audioSec / elapsedSec : 0.0; }
+    };
+
+    // Called on worker threads, once per analysed file (including failures)
+    using ResultCallback = std::function<void(const FileAnalysis::Result&)>;
+    // Called once per batch: on the last worker thread, or on the thread calling cancel()
+    using FinishedCallback = std::function<void(const Stats&)>;
+
+    explicit BatchAnalyzer(int numThreads = 0);   // 0 = one worker per CPU core
+    ~BatchAnalyzer();
+
+    // Expand directories (optionally recursively) into supported audio files
+    static juce::Array<juce::File> collectAudioFiles(const juce::Array<juce::File>& filesOrDirs, bool recursive = true);
+
+    // Queue a batch; returns false if one is already running
+    bool start(const juce::Array<juce::File>& files, ResultCallback onResult, FinishedCallback onFinished = {});
+
+    // Optional result cache (not owned; set before start())
+    void setCache(AnalysisCache* c) noexcept { cache = c; }
+
+    // Optional early-exit analysis, decoding only until estimates converge (set before start())
+    void setEarlyExit(bool enabled, const FileAnalysis::EarlyExitOptions& options = {})
+    {
+        earlyExit = enabled;
+        earlyExitOptions = options;
+    }
+
+    // Optional: write each file's per-frame features to dir (FeatureFile, named by content
+    // key) for re-scoring. Features need a full linear decode, so this bypasses the
+    // cache lookup and early exit (set before start())
+    void setFeatureOutput(const juce::File& dir) { featureDir = dir; }
+
+    // Stop queued and running jobs, waits for workers to return
+    void cancel();
+
+    bool isRunning() const noexcept { return running.load(); }
+    bool waitForCompletion(int timeoutMs = -1);
+    Stats getStats() const noexcept;
+    int getNumThreads() const noexcept { return numWorkers; }
+
+private:
+    class Job;
+    void jobFinished(const FileAnalysis::Result& r);
+
+    int numWorkers;
+    juce::ThreadPool pool;
+    AnalysisCache* cache = nullptr;
+    bool earlyExit = false;
+    FileAnalysis::EarlyExitOptions earlyExitOptions;
+    juce::File featureDir;
+
+    ResultCallback   onResult;
+    FinishedCallback onFinished;
+
+    std::atomic<bool>        running{ false };
+    std::atomic<int>         total{ 0 }, completed{ 0 }, failed{ 0 }, pending{ 0 };
+    std::atomic<juce::int64> audioMicros{ 0 }, decodedMicros{ 0 };
+    std::atomic<double>      startMs{ 0.0 }, endMs{ 0.0 };
+    juce::WaitableEvent      finishedEvent{ true };  // manual reset
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BatchAnalyzer)
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// One predicted/observed beat from the online beat tracker
+struct BeatEvent
+{
+    juce::int64 samplePos = 0;      // input-rate sample of the beat onset (stream clock of the producer)
+    float periodSamples = 0.0f;     // beat period at the input rate: the next beat is expected at samplePos + period
+    float bpm = 0.0f;
+    float confidence = 0.0f;        // 0..1, share of onset energy landing on the beat grid
+    int   beatInBar = 0;            // 0 = downbeat (accent heuristic), 1..beatsPerBar-1 otherwise
+};
+
+// Single-producer / single-consumer lock-free queue of beat events.
+// Producer: analysis thread (BeatTracker). Consumer: UI / lighting thread.
+// A full queue drops the newest event (the consumer is not keeping up, and
+// the period of older events still predicts the grid).
+class BeatEventQueue
+{
+public:
+    explicit BeatEventQueue(size_t capacityPow2 = 64)
+    {
+        size_t cap = 8;
+        while (cap < capacityPow2) cap <<= 1;
+        events.resize(cap);
+        mask = cap - 1;
+    }
+
+    // Producer
+    bool push(const BeatEvent& e) noexcept
+    {
+        const auto w = write.load(std::memory_order_relaxed);
+        if (w - read.load(std::memory_order_acquire) >= events.size())
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        events[w & mask] = e;
+        write.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: up to maxEvents oldest-first into out, returns the number popped
+    int pop(BeatEvent* out, int maxEvents) noexcept
+    {
+        if (out == nullptr || maxEvents <= 0) return 0;
+
+        auto r = read.load(std::memory_order_relaxed);
+        const auto w = write.load(std::memory_order_acquire);
+        int n = 0;
+        for (; r != w && n < maxEvents; ++r)
+            out[n++] = events[r & mask];
+
+        read.store(r, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer: discard pending events
+    void clear() noexcept { read.store(write.load(std::memory_order_acquire), std::memory_order_release); }
+
+    size_t droppedEvents() const noexcept { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<BeatEvent> events;
+    size_t mask = 0;
+
+    std::atomic<size_t> write{ 0 };
+    std::atomic<size_t> read{ 0 };
+    std::atomic<size_t> dropped{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(BeatEventQueue)
+};
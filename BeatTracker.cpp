@@ -0,0 +1,219 @@
+#include "BeatTracker.h"
+#include <algorithm>
+#include <cmath>
+
+// Linearly interpolated history value at fractional index pos (0 = oldest)
+static inline float sampleAt(const RunningWindow& h, double pos) noexcept
+{
+    const int i = (int)pos;
+    const float frac = (float)(pos - (double)i);
+    const float a = h[i];
+    return i + 1 < h.size() ? a + frac * (h[i + 1] - a) : a;
+}
+
+BeatTracker::BeatTracker(const Settings& s)
+    : settings(s)
+{
+    settings.tolerance = juce::jlimit(0.05f, 0.45f, settings.tolerance);
+    settings.correctionGain = juce::jlimit(0.0f, 1.0f, settings.correctionGain);
+    settings.periodGain = juce::jlimit(0.0f, settings.correctionGain, settings.periodGain);
+    settings.beatsPerBar = juce::jlimit(1, maxBeatsPerBar, settings.beatsPerBar);
+}
+
+void BeatTracker::prepare(double rate, double spf, double zeroSample) noexcept
+{
+    envRate = rate;
+    samplesPerFrame = spf;
+    frameZeroSample = zeroSample;
+    reset();
+}
+
+void BeatTracker::setOutput(BeatEventQueue* queue, double scale, double offset) noexcept
+{
+    output = queue;
+    sampleScale = scale;
+    sampleOffset = offset;
+}
+
+void BeatTracker::reset() noexcept
+{
+    frame = 0;
+    contiguousFrames = 0;
+    locked = false;
+    emitted = false;
+    tempoPeriod = periodCorr = period = nextBeat = 0.0;
+    errSum = hitEnergy = periodEnergy = 0.0;
+    confidence = 0.0f;
+    bpm = 0.0f;
+    beatCount = 0;
+    octaveFrames = 0;
+    std::fill(std::begin(accent), std::end(accent), 0.0f);
+    lockedFlag.store(false, std::memory_order_relaxed);
+    confidenceOut.store(0.0f, std::memory_order_relaxed);
+}
+
+void BeatTracker::processFrame(float env, float tempo, const RunningWindow& history) noexcept
+{
+    const double n = (double)frame++;
+    contiguousFrames = juce::jmin(contiguousFrames + 1, history.size());
+    if (!settings.enabled || envRate <= 0.0) return;
+
+    if (tempo <= 0.0f)
+    {
+        locked = false;
+        lockedFlag.store(false, std::memory_order_relaxed);
+        return;
+    }
+
+    // The tempo estimate is already median-debounced: follow small changes,
+    // re-acquire the phase after a jump
+    double p = 60.0 * envRate / (double)tempo;
+    if (locked)
+    {
+        // Octave flips of the estimate keep the grid at its level unless they persist
+        const double tol = (double)settings.relockChange;
+        const double ratio = p / tempoPeriod;
+        const double held = std::abs(ratio - 2.0) < 2.0 * tol ? 0.5 : std::abs(ratio - 0.5) < 0.5 * tol ? 2.0 : 1.0;
+        octaveFrames = held != 1.0 ? octaveFrames + 1 : 0;
+        if (held != 1.0 && (double)octaveFrames < (double)octaveHoldBeats * tempoPeriod)
+            p *= held;
+
+        if (std::abs(p - tempoPeriod) > tol * tempoPeriod)
+            locked = false;
+    }
+    if (!locked && !acquire(history, p, n))
+        return;
+
+    tempoPeriod = p;
+    period = p + periodCorr;
+    bpm = (float)(60.0 * envRate / period);
+    periodEnergy += env;
+
+    const double d = n - nextBeat;
+    const double tol = (double)settings.tolerance * period;
+    if (std::abs(d) <= tol)
+    {
+        errSum += (double)env * d;
+        hitEnergy += env;
+    }
+
+    if (!emitted && d >= 0.0)
+    {
+        emitBeat();
+        emitted = true;
+    }
+
+    if (d > tol)
+        closeBeat();
+}
+
+void BeatTracker::skipFrame() noexcept
+{
+    ++frame;
+    contiguousFrames = 0;
+    locked = false;
+    lockedFlag.store(false, std::memory_order_relaxed);
+}
+
+bool BeatTracker::acquire(const RunningWindow& history, double p, double n) noexcept
+{
+    // Comb over the last few periods: the offset (frames before now) whose
+    // grid collects the most onset energy is the most recent beat. Only history
+    // since the last gap lines up with the frame clock.
+    const int count = contiguousFrames;
+    const int periods = juce::jmin(4, (int)((double)(count - 1) / p));
+    if (periods < 2) return false;
+
+    const int numOffsets = juce::jmax(1, (int)std::ceil(p));
+    const double newest = (double)(history.size() - 1);
+    auto comb = [&](int o) noexcept
+    {
+        float s = 0.0f;
+        for (int k = 0; k < periods; ++k)
+            s += sampleAt(history, newest - (double)o - (double)k * p);
+        return s;
+    };
+
+    int best = 0;
+    float bestScore = 0.0f;
+    for (int o = 0; o < numOffsets; ++o)
+    {
+        const float v = comb(o);
+        if (v > bestScore) { bestScore = v; best = o; }
+    }
+    if (bestScore <= 0.0f) return false;
+
+    // Refine to the energy centroid around the peak, the same measure the loop
+    // tracks (the smoothed envelope peaks earlier than its centroid)
+    const int half = juce::jmax(1, (int)((double)settings.tolerance * p));
+    double sum = 0.0, moment = 0.0;
+    for (int d = -half; d <= half; ++d)
+    {
+        int o = best + d;
+        if (o < 0) o += numOffsets;              // the comb is periodic in o
+        else if (o >= numOffsets) o -= numOffsets;
+        const double v = comb(o);
+        sum += v;
+        moment += v * (double)d;
+    }
+    const double delta = sum > 0.0 ? moment / sum : 0.0;
+
+    // The last beat was (best + delta) frames ago
+    nextBeat = n - ((double)best + delta) + p;
+
+    tempoPeriod = period = p;
+    periodCorr = 0.0;
+    octaveFrames = 0;
+    locked = true;
+    emitted = false;
+    errSum = hitEnergy = periodEnergy = 0.0;
+    beatCount = 0;
+    std::fill(std::begin(accent), std::end(accent), 0.0f);
+    lockedFlag.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void BeatTracker::emitBeat() noexcept
+{
+    if (output == nullptr) return;
+
+    // Downbeat = bar position with the strongest running accent
+    const int bar = settings.beatsPerBar;
+    int down = 0;
+    for (int i = 1; i < bar; ++i)
+        if (accent[i] > accent[down]) down = i;
+    const int slot = (int)(beatCount % bar);
+
+    BeatEvent e;
+    e.samplePos = (juce::int64)std::llround(sampleOffset
+        + sampleScale * (frameZeroSample + nextBeat * samplesPerFrame));
+    e.periodSamples = (float)(sampleScale * period * samplesPerFrame);
+    e.bpm = bpm;
+    e.confidence = confidence;
+    e.beatInBar = (slot - down + bar) % bar;
+    output->push(e);
+}
+
+void BeatTracker::closeBeat() noexcept
+{
+    // Onset-weighted timing error inside the window moves the next prediction
+    const double err = hitEnergy > 1e-12 ? errSum / hitEnergy : 0.0;
+
+    // A random phase puts ~2 * tolerance of the energy in the window; a locked one nearly all of it
+    const double chance = 2.0 * (double)settings.tolerance;
+    const double share = periodEnergy > 1e-12 ? hitEnergy / periodEnergy : 0.0;
+    const float hit = (float)juce::jlimit(0.0, 1.0, (share - chance) / (1.0 - chance));
+    confidence = 0.85f * confidence + 0.15f * hit;
+    confidenceOut.store(confidence, std::memory_order_relaxed);
+
+    const int slot = (int)(beatCount % settings.beatsPerBar);
+    accent[slot] = 0.9f * accent[slot] + 0.1f * (float)hitEnergy;
+
+    const double maxCorr = 0.5 * (double)settings.relockChange * tempoPeriod;
+    periodCorr = juce::jlimit(-maxCorr, maxCorr, periodCorr + (double)settings.periodGain * err);
+    period = tempoPeriod + periodCorr;
+    nextBeat += period + (double)settings.correctionGain * err;
+    ++beatCount;
+    emitted = false;
+    errSum = hitEnergy = periodEnergy = 0.0;
+}
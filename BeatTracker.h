@@ -0,0 +1,92 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include "BeatEventQueue.h"
+#include "RunningWindow.h"
+
+// Online beat tracker driven by BpmTracker's onset envelope and tempo (live mode).
+// A second-order phase-locked loop: the phase is acquired once by a comb over
+// the recent envelope, then the onset-weighted timing error measured around
+// every predicted beat corrects the next prediction and, more slowly, the
+// period (the ACF tempo is often off by a fraction of a BPM, which would
+// otherwise leave a constant lag). Beats are emitted as soon as their
+// predicted frame is reached (no look-ahead). Downbeats are guessed from the
+// bar position with the strongest average onset (kick/crash accent).
+// O(1) per envelope frame; re-acquisition costs a few periods of reads.
+class BeatTracker
+{
+public:
+    struct Settings
+    {
+        bool  enabled = true;
+        float correctionGain = 0.25f;   // share of the measured timing error applied to the next beat (phase)
+        float periodGain = 0.05f;       // share applied to the period (absorbs small tempo estimate errors)
+        float tolerance = 0.2f;         // half-width of the window around a beat, fraction of the period
+        float relockChange = 0.08f;     // tempo change (fraction) that re-acquires the phase
+        int   beatsPerBar = 4;
+    };
+
+    explicit BeatTracker(const Settings& s = {});
+
+    // envRate: envelope frames per second. frameZeroSample: sample (tracker rate) an
+    // onset shows up at in envelope frame 0, i.e. frame centre minus smoothing delay.
+    void prepare(double envRate, double samplesPerFrame, double frameZeroSample) noexcept;
+
+    // Output queue (nullptr = none). Timestamps are scale * trackerSample + offset,
+    // so the owner can map decimated samples back to its own stream clock.
+    // Analysis thread only.
+    void setOutput(BeatEventQueue* queue, double sampleScale = 1.0, double sampleOffset = 0.0) noexcept;
+
+    // Forget phase and frame count (the next frame is frame 0 again)
+    void reset() noexcept;
+
+    // One envelope frame; history holds the recent envelope with env as its newest value
+    void processFrame(float env, float bpm, const RunningWindow& history) noexcept;
+
+    // A frame with no envelope (silence gate): the clock advances, the lock is
+    // dropped, and only history pushed after the gap is used to re-acquire
+    void skipFrame() noexcept;
+
+    // Results (thread-safe)
+    bool  isLocked() const noexcept { return lockedFlag.load(std::memory_order_relaxed); }
+    float getConfidence() const noexcept { return confidenceOut.load(std::memory_order_relaxed); }
+
+private:
+    bool acquire(const RunningWindow& history, double periodFrames, double frame) noexcept;
+    void emitBeat() noexcept;
+    void closeBeat() noexcept;
+
+    static constexpr int maxBeatsPerBar = 8;
+    static constexpr int octaveHoldBeats = 8;   // a doubled / halved tempo must last this long to move the grid
+
+    Settings settings;
+    double envRate = 0.0;
+    double samplesPerFrame = 1.0;
+    double frameZeroSample = 0.0;
+
+    BeatEventQueue* output = nullptr;
+    double sampleScale = 1.0, sampleOffset = 0.0;
+
+    // PLL state, in envelope frames
+    juce::int64 frame = 0;
+    int    contiguousFrames = 0;      // history entries since the last gap (acquisition reads no further back)
+    bool   locked = false;
+    bool   emitted = false;           // the pending beat has gone out
+    double tempoPeriod = 0.0;         // from the tempo estimate
+    double periodCorr = 0.0;          // loop's own correction to it
+    int    octaveFrames = 0;          // frames the estimate has sat an octave away
+    double period = 0.0;
+    double nextBeat = 0.0;
+    double errSum = 0.0, hitEnergy = 0.0, periodEnergy = 0.0;
+    float  confidence = 0.0f;
+    float  bpm = 0.0f;
+
+    // Downbeat: running onset strength per bar position (beatCount % beatsPerBar)
+    juce::int64 beatCount = 0;
+    float accent[maxBeatsPerBar] = {};
+
+    std::atomic<bool>  lockedFlag{ false };
+    std::atomic<float> confidenceOut{ 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE(BeatTracker)
+};
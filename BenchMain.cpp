@@ -0,0 +1,487 @@
+// Kernel benchmark: times the analysis stages on synthetic fixtures and prints JSON.
+// Compiled only with CANONKEY_BUILD_BENCH=1. Build the bench console target from the
+// same sources as the CLI target (see CliMain.cpp), defining CANONKEY_BUILD_BENCH=1
+// for the whole target: that compiles Main.cpp's app entry out and, through
+// RealtimeGuard.h, turns on CANONKEY_RT_GUARD so allocations are counted.
+//
+//   canonkey-bench [--seconds S] [--iterations N] [--output <file>] [audio files...]
+//
+// Synthetic fixtures are deterministic (click tracks at known BPMs, chord
+// progressions in known keys); extra audio files are analysed end to end.
+// Stage timings are the median of N runs in ns per call.
+
+#ifndef CANONKEY_BUILD_BENCH
+ #define CANONKEY_BUILD_BENCH 0
+#endif
+
+#if CANONKEY_BUILD_BENCH
+
+#include <JuceHeader.h>
+#include "AnalysisChain.h"
+#include "FileAnalysis.h"
+#include "RealtimeGuard.h"
+#include "RingBuffer.h"
+#include "SimdKernels.h"
+#include <cstdio>
+
+namespace
+{
+    constexpr double benchRate = 44100.0;
+
+    //==============================================================================
+    // Fixtures
+    std::vector<float> makeClickTrack(double bpm, double seconds)
+    {
+        std::vector<float> x((size_t)(seconds * benchRate), 0.0f);
+        const double period = 60.0 / bpm;
+        for (size_t n = 0; n < x.size(); ++n)
+        {
+            const double t = (double)n / benchRate;
+            const double ph = std::fmod(t, period);
+            if (ph < 0.02)
+                x[n] = (float)(0.8 * std::exp(-ph * 300.0) * std::sin(2.0 * juce::MathConstants<double>::pi * 1000.0 * t));
+        }
+        return x;
+    }
+
+    // Triads (root pitch class, minor) held for 2 s each, four harmonics per note
+    std::vector<float> makeProgression(const std::vector<std::pair<int, bool>>& chords, double seconds)
+    {
+        std::vector<float> x((size_t)(seconds * benchRate), 0.0f);
+        const double chordSec = 2.0;
+        for (size_t n = 0; n < x.size(); ++n)
+        {
+            const double t = (double)n / benchRate;
+            const auto& c = chords[(size_t)(t / chordSec) % chords.size()];
+            const int notes[3] = { c.first, c.first + (c.second ? 3 : 4), c.first + 7 };
+
+            double s = 0.0;
+            for (int pc : notes)
+            {
+                const double hz = 261.63 * std::pow(2.0, (double)pc / 12.0);
+                for (int h = 1; h <= 4; ++h)
+                    s += 0.06 / h * std::sin(2.0 * juce::MathConstants<double>::pi * hz * h * t);
+            }
+            x[n] = (float)s;
+        }
+        return x;
+    }
+
+    struct ClickCase { const char* name; double bpm; };
+    struct KeyCase { const char* name; std::vector<std::pair<int, bool>> chords; int key; bool minor; };
+
+    const ClickCase clickCases[] = { { "click_90", 90.0 }, { "click_128", 128.0 }, { "click_174", 174.0 } };
+
+    const std::vector<KeyCase>& keyCases()
+    {
+        static const std::vector<KeyCase> cases = {
+            { "prog_C_major", { { 0, false }, { 5, false }, { 7, false }, { 0, false } }, 0, false },
+            { "prog_A_minor", { { 9, true }, { 2, true }, { 4, true }, { 9, true } }, 9, true },
+            { "prog_G_major", { { 7, false }, { 0, false }, { 2, false }, { 7, false } }, 7, false },
+        };
+        return cases;
+    }
+
+    //==============================================================================
+    // Timing helpers
+    double ticksToNs(juce::int64 ticks)
+    {
+        return (double)ticks * 1.0e9 / (double)juce::Time::getHighResolutionTicksPerSecond();
+    }
+
+    double median(std::vector<double> v)
+    {
+        if (v.empty()) return 0.0;
+        std::sort(v.begin(), v.end());
+        return v[v.size() / 2];
+    }
+
+    struct StageResult
+    {
+        juce::String name;
+        double nsPerCall = 0.0;
+        juce::int64 calls = 0;
+        double allocsPerCall = 0.0;
+    };
+
+    // Runs body() `iterations` times; body returns the number of calls it made
+    template <typename Body>
+    StageResult timeStage(const juce::String& name, int iterations, Body&& body)
+    {
+        StageResult r;
+        r.name = name;
+        std::vector<double> perCall;
+
+        body();   // warm caches and lazily sized buffers
+
+        juce::int64 totalCalls = 0;
+        uint64_t allocs = 0;
+        for (int it = 0; it < iterations; ++it)
+        {
+            const auto a0 = RealtimeGuard::threadAllocationCount();
+            const auto t0 = juce::Time::getHighResolutionTicks();
+            const juce::int64 calls = body();
+            const auto t1 = juce::Time::getHighResolutionTicks();
+            allocs += RealtimeGuard::threadAllocationCount() - a0;
+
+            if (calls > 0) perCall.push_back(ticksToNs(t1 - t0) / (double)calls);
+            totalCalls += calls;
+        }
+
+        r.nsPerCall = median(perCall);
+        r.calls = totalCalls;
+        r.allocsPerCall = totalCalls > 0 ? (double)allocs / (double)totalCalls : 0.0;
+        return r;
+    }
+
+    // Captures every spectrum of one resolution
+    struct SpectrumRecorder : SpectralFrontEnd::Consumer
+    {
+        std::vector<std::vector<float>> frames;
+        void processSpectrum(const std::vector<float>& mag) override { frames.push_back(mag); }
+    };
+
+    struct NullConsumer : SpectralFrontEnd::Consumer
+    {
+        void processSpectrum(const std::vector<float>&) override {}
+    };
+
+    std::vector<std::vector<float>> recordSpectra(const std::vector<float>& x, int order, int hop)
+    {
+        SpectralFrontEnd fe;
+        SpectrumRecorder rec;
+        fe.addConsumer(rec, order, hop);
+        fe.processMono(x.data(), (int)x.size());
+        return std::move(rec.frames);
+    }
+}
+
+//==============================================================================
+// Friend of BpmTracker / KeyDetector: reaches the private per-stage entry points
+class KernelBench
+{
+public:
+    KernelBench(double seconds, int iterations) : secs(seconds), iters(iterations) {}
+
+    juce::var run(const juce::StringArray& fixtureFiles)
+    {
+        auto* root = new juce::DynamicObject();
+        root->setProperty("benchmark", "canonkey-kernels");
+        root->setProperty("version", 1);
+        root->setProperty("sampleRate", benchRate);
+        root->setProperty("secondsPerFixture", secs);
+        root->setProperty("iterations", iters);
+        root->setProperty("allocationCounting", (bool)CANONKEY_RT_GUARD);
+        root->setProperty("instructionSet", SimdKernels::activeInstructionSet());
+
+        const auto clicks = makeClickTrack(128.0, secs);
+        const auto chords = makeProgression(keyCases().front().chords, secs);
+
+        juce::Array<juce::var> stages;
+        for (auto& s : runStages(clicks, chords))
+        {
+            auto* o = new juce::DynamicObject();
+            o->setProperty("name", s.name);
+            o->setProperty("nsPerCall", s.nsPerCall);
+            o->setProperty("calls", s.calls);
+            o->setProperty("allocsPerCall", s.allocsPerCall);
+            stages.add(juce::var(o));
+        }
+        root->setProperty("stages", stages);
+        root->setProperty("endToEnd", runEndToEnd(clicks, chords));
+        root->setProperty("accuracy", runAccuracy());
+
+        juce::Array<juce::var> files;
+        for (auto& path : fixtureFiles)
+            files.add(runFile(juce::File(path)));
+        root->setProperty("files", files);
+
+        return juce::var(root);
+    }
+
+private:
+    double secs;
+    int iters;
+
+    std::vector<StageResult> runStages(const std::vector<float>& clicks, const std::vector<float>& chords)
+    {
+        std::vector<StageResult> out;
+
+        // ---- Front-end ----
+        {
+            SpectralFrontEnd fe;
+            NullConsumer sink;
+            fe.addConsumer(sink, 11, 512);
+            out.push_back(timeStage("frontEnd.stft2048_hop512", iters, [&]
+                {
+                    fe.reset();
+                    fe.processMono(clicks.data(), (int)clicks.size());
+                    return (juce::int64)(((juce::int64)clicks.size() - 2048) / 512 + 1);
+                }));
+        }
+
+        // ---- BpmTracker ----
+        {
+            const auto spectra = recordSpectra(clicks, 11, 512);
+            BpmTracker bpm(benchRate);
+
+            out.push_back(timeStage("bpm.processSpectrum", iters, [&]
+                {
+                    bpm.reset();
+                    for (auto& m : spectra) bpm.processSpectrum(m);
+                    return (juce::int64)spectra.size();
+                }));
+
+            // Envelope input recorded from the same spectra (only the value range matters)
+            std::vector<float> flux, lowFlux;
+            {
+                BpmTracker probe(benchRate);
+                for (auto& m : spectra)
+                {
+                    probe.processSpectrum(m);
+                    flux.push_back(probe.emaState);
+                    lowFlux.push_back(probe.lowEmaState);
+                }
+            }
+            out.push_back(timeStage("bpm.pushEnvelope", iters, [&]
+                {
+                    bpm.reset();
+                    for (size_t i = 0; i < flux.size(); ++i) bpm.pushEnvelope(flux[i], lowFlux[i]);
+                    return (juce::int64)flux.size();
+                }));
+
+            // Full analysis window for the ACF kernels
+            bpm.reset();
+            for (auto& m : spectra) bpm.processSpectrum(m);
+
+            for (auto method : { BpmTracker::AcfMethod::direct, BpmTracker::AcfMethod::fft })
+            {
+                bpm.setAcfMethod(method);
+                const juce::String name = method == BpmTracker::AcfMethod::fft ? "bpm.computeAcf.fft" : "bpm.computeAcf.direct";
+                out.push_back(timeStage(name, iters, [&]
+                    {
+                        int minLag = 0, maxLag = 0;
+                        for (int i = 0; i < 64; ++i) bpm.computeWindowAcf(minLag, maxLag);
+                        return (juce::int64)64;
+                    }));
+            }
+
+            int minLag = 0, maxLag = 0;
+            bpm.computeWindowAcf(minLag, maxLag);
+            const auto acf = bpm.acfBuf;
+            out.push_back(timeStage("bpm.pickTempo", iters, [&]
+                {
+                    float b = 0.0f, c = 0.0f;
+                    for (int i = 0; i < 64; ++i) bpm.pickTempo(acf, minLag, maxLag, b, c);
+                    return (juce::int64)64;
+                }));
+
+            // Per-hop cost of the incremental engine (accumulator update + tempo pick)
+            out.push_back(timeStage("bpm.incrementalStep", iters, [&]
+                {
+                    for (int i = 0; i < 64; ++i)
+                    {
+                        bpm.updateIncrementalAcf(0.01f * (float)(i & 7), 0.01f * (float)(i & 3));
+                        bpm.computeTempoIncremental();
+                    }
+                    return (juce::int64)64;
+                }));
+
+            // Per-frame cost of the beat PLL on the buffered envelope (locks on the first call)
+            BeatTracker beats;
+            beats.prepare(bpm.envRate, (double)bpm.hopSize, 0.0);
+            out.push_back(timeStage("bpm.beatStep", iters, [&]
+                {
+                    for (int i = 0; i < 64; ++i)
+                        beats.processFrame(0.01f * (float)(i & 7), 120.0f, bpm.onsetEnv);
+                    return (juce::int64)64;
+                }));
+        }
+
+        // ---- KeyDetector ----
+        {
+            const auto spectra = recordSpectra(chords, 12, 2048);
+            KeyDetector key(benchRate);
+
+            out.push_back(timeStage("key.analyzeFrame", iters, [&]
+                {
+                    key.reset();
+                    for (auto& m : spectra) key.analyzeFrame(m);
+                    return (juce::int64)spectra.size();
+                }));
+
+            out.push_back(timeStage("key.score24", iters, [&]
+                {
+                    for (int i = 0; i < 256; ++i) key.score24(key.chromaEMA.data());
+                    return (juce::int64)256;
+                }));
+
+            out.push_back(timeStage("key.viterbiStep", iters, [&]
+                {
+                    for (int i = 0; i < 256; ++i) key.viterbiStep();
+                    return (juce::int64)256;
+                }));
+        }
+
+        // ---- RingBuffer ----
+        {
+            RingBuffer ring(1u << 16);
+            constexpr int block = 512;
+            std::vector<float> l(clicks.begin(), clicks.begin() + block), r(l);
+            const float* chans[2] = { l.data(), r.data() };
+            std::vector<float> popped((size_t)block);
+
+            out.push_back(timeStage("ring.pushPlanarToMono.stereo512", iters, [&]
+                {
+                    for (int i = 0; i < 1024; ++i)
+                    {
+                        ring.pushPlanarToMono(chans, 2, block);
+                        ring.pop(popped.data(), (size_t)block);
+                    }
+                    return (juce::int64)1024;
+                }));
+        }
+
+        return out;
+    }
+
+    // Realtime factor = audio seconds / wall seconds, per analyzer
+    juce::var runEndToEnd(const std::vector<float>& clicks, const std::vector<float>& chords)
+    {
+        auto* o = new juce::DynamicObject();
+        const double audioSec = (double)clicks.size() / benchRate;
+        constexpr int block = 512;
+
+        auto factor = [&](auto&& process)
+            {
+                std::vector<double> f;
+                for (int it = 0; it < iters; ++it)
+                {
+                    const auto t0 = juce::Time::getHighResolutionTicks();
+                    process();
+                    const double wall = ticksToNs(juce::Time::getHighResolutionTicks() - t0) * 1.0e-9;
+                    f.push_back(wall > 0.0 ? audioSec / wall : 0.0);
+                }
+                return median(f);
+            };
+
+        auto feed = [&](auto& target, const std::vector<float>& x)
+            {
+                for (size_t i = 0; i < x.size(); i += block)
+                    target.processMono(x.data() + i, (int)std::min<size_t>(block, x.size() - i));
+            };
+
+        BpmTracker bpm(benchRate);
+        o->setProperty("bpmTracker", factor([&] { bpm.reset(); feed(bpm, clicks); }));
+
+        KeyDetector key(benchRate);
+        o->setProperty("keyDetector", factor([&] { key.reset(); feed(key, chords); }));
+
+        AnalysisChain live(benchRate);
+        o->setProperty("chainLive", factor([&] { live.reset(); feed(live, clicks); }));
+
+        BpmTracker::Settings bs; bs.offline = true;
+        KeyDetector::Settings ks; ks.offline = true;
+        AnalysisChain offline(benchRate, bs, ks);
+        o->setProperty("chainOffline", factor([&] { offline.reset(); feed(offline, clicks); offline.finishOffline(); }));
+
+        // Same chain at the input rate: what the decimation stage saves
+        AnalysisChain offlineFullRate(benchRate, bs, ks, 1);
+        o->setProperty("chainOfflineNoDecimation", factor([&] { offlineFullRate.reset(); feed(offlineFullRate, clicks); offlineFullRate.finishOffline(); }));
+
+        return juce::var(o);
+    }
+
+    // Detected vs expected on the synthetic fixtures (offline chain)
+    juce::var runAccuracy()
+    {
+        juce::Array<juce::var> cases;
+        BpmTracker::Settings bs; bs.offline = true;
+        KeyDetector::Settings ks; ks.offline = true;
+
+        for (auto& c : clickCases)
+        {
+            const auto x = makeClickTrack(c.bpm, secs);
+            AnalysisChain chain(benchRate, bs, ks);
+            chain.processMono(x.data(), (int)x.size());
+            chain.finishOffline();
+
+            const float got = chain.getBpmTracker().getBpm();
+            auto* o = new juce::DynamicObject();
+            o->setProperty("name", c.name);
+            o->setProperty("expectedBpm", c.bpm);
+            o->setProperty("bpm", got);
+            o->setProperty("bpmConfidence", chain.getBpmTracker().getConfidence());
+            o->setProperty("pass", std::abs(got - c.bpm) <= 0.04 * c.bpm);
+            cases.add(juce::var(o));
+        }
+
+        for (auto& c : keyCases())
+        {
+            const auto x = makeProgression(c.chords, secs);
+            AnalysisChain chain(benchRate, bs, ks);
+            chain.processMono(x.data(), (int)x.size());
+            chain.finishOffline();
+
+            const auto k = chain.getKeyDetector().getLast();
+            auto* o = new juce::DynamicObject();
+            o->setProperty("name", c.name);
+            o->setProperty("expectedKey", FileAnalysis::keyName(c.key, c.minor));
+            o->setProperty("key", FileAnalysis::keyName(k.keyIndex, k.isMinor));
+            o->setProperty("keyConfidence", k.confidence);
+            o->setProperty("pass", k.keyIndex == c.key && k.isMinor == c.minor);
+            cases.add(juce::var(o));
+        }
+        return cases;
+    }
+
+    juce::var runFile(const juce::File& f)
+    {
+        const auto r = FileAnalysis::analyzeFile(f);
+        auto* o = new juce::DynamicObject();
+        o->setProperty("file", f.getFullPathName());
+        o->setProperty("ok", r.ok);
+        o->setProperty("bpm", r.bpm);
+        o->setProperty("key", FileAnalysis::keyName(r.keyIndex, r.isMinor));
+        o->setProperty("durationSec", r.durationSec);
+        o->setProperty("realtimeFactor", r.wallSec > 0.0 ? r.durationSec / r.wallSec : 0.0);
+        return juce::var(o);
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    double seconds = 30.0;
+    int iterations = 5;
+    juce::File output;
+    juce::StringArray files;
+
+    const juce::ArgumentList args(argc, argv);
+    for (int i = 0; i < args.size(); ++i)
+    {
+        const auto a = args[i].text;
+        const bool hasValue = i + 1 < args.size();
+        if (a == "--seconds" && hasValue)         seconds = juce::jlimit(5.0, 600.0, args[++i].text.getDoubleValue());
+        else if (a == "--iterations" && hasValue) iterations = juce::jlimit(1, 100, args[++i].text.getIntValue());
+        else if (a == "--output" && hasValue)     output = args[++i].resolveAsFile();
+        else if (a.startsWith("--"))
+        {
+            std::fputs("usage: canonkey-bench [--seconds S] [--iterations N] [--output <file>] [audio files...]\n", stderr);
+            return 2;
+        }
+        else files.add(args[i].resolveAsFile().getFullPathName());
+    }
+
+    KernelBench bench(seconds, iterations);
+    const auto text = juce::JSON::toString(bench.run(files)) + "\n";
+
+    if (output != juce::File())
+        return output.replaceWithText(text) ? 0 : 1;
+
+    std::fputs(text.toRawUTF8(), stdout);
+    return 0;
+}
+
+#endif // CANONKEY_BUILD_BENCH
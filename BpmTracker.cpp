@@ -1,11 +1,11 @@
 #include "BpmTracker.h"
+#include "RealtimeGuard.h"
+#include "SimdKernels.h"
+#include "Telemetry.h"
+#include "AnalysisTables.h"
+#include <tuple>
 
 // ---------------- Utilities ----------------
-static inline float hann(int n, int N) noexcept
-{
-    return 0.5f * (1.0f - std::cos(2.0f * juce::MathConstants<float>::pi * (float)n / (float)(N - 1)));
-}
-
 static inline float triWeight(int i, int a, int b, int c) noexcept
 {
     if (i <= a || i >= c) return 0.0f;
@@ -25,14 +25,24 @@ static inline double melToHz(double m)
 }
 
 // ---------------- BpmTracker ----------------
-BpmTracker::BpmTracker(double sampleRate)
+BpmTracker::BpmTracker(double sampleRate, const Settings& s)
     : sr(sampleRate > 0.0 ? sampleRate : 44100.0),
-    fft(juce::jlimit(4, 16, (int)std::round(std::log2((double)frameSize))))
+    minBPM(s.minBPM),
+    maxBPM(juce::jmax(s.minBPM + 1.0f, s.maxBPM)),
+    analysisSeconds(juce::jlimit(3.0f, 60.0f, s.analysisSeconds)),
+    reestimateEvery(juce::jmax(0.01f, s.reestimateEvery)),
+    forgetSeconds(juce::jmax(0.5f, s.forgetSeconds)),
+    acfMethod(s.acfMethod),
+    offline(s.offline),
+    resolveOctaves(s.resolveOctaves),
+    beatTracker(s.beats)
 {
-    // Recompute derived sizes
-    fftOrder = (int)std::round(std::log2((double)frameSize));
+    // Scale frame and hop from their 44.1 kHz values so bin width and envelope
+    // rate stay (nearly) the same at decimated or high device rates
+    const double rateScale = sr / 44100.0;
+    fftOrder = juce::jlimit(8, 14, (int)std::round(std::log2((double)frameSize * rateScale)));
     frameSize = 1 << fftOrder;
-    hopSize = juce::jmax(128, hopSize);
+    hopSize = juce::jmax(64, (int)std::round((double)hopSize * rateScale));
     envRate = sr / (double)hopSize;
 
     // Envelope windows
@@ -40,62 +50,147 @@ BpmTracker::BpmTracker(double sampleRate)
     envMaxLen = juce::jmax((int)std::round(analysisSeconds * envRate), maLen + 1);
 
     // Buffers
-    window.allocate(frameSize, true);
-    fftBuffer.allocate((size_t)(2 * frameSize), true);
-    inFrame.assign(frameSize, 0.0f);
-    mag.assign(frameSize / 2 + 1, 0.0f);
-
-    bandMag.assign((size_t)numBands, 0.0f);
-    prevBandMag.assign((size_t)numBands, 0.0f);
-    buildWindow();
-    buildBands();
-
-    fifo.resize((size_t)(4 * frameSize));
-    fifoFill = 0;
+    mag.assign((size_t)(frameSize / 2 + 1), 0.0f);
 
-    onsetEnv.clear(); fluxRaw.clear(); fluxMA.clear();
+    static AnalysisTables::Cache<std::tuple<double, int, int>, BandLayout> layouts;
+    layout = layouts.get({ sr, frameSize, numBands }, [this]
+        {
+            return std::make_shared<const BandLayout>(buildBands(sr, frameSize, numBands));
+        });
+    bandMag.assign(layout->bands.size(), 0.0f);
+    prevBandMag.assign(layout->bands.size(), 0.0f);
+
+    ownFrontEnd = std::make_unique<SpectralFrontEnd>();
+    ownFrontEnd->addConsumer(*this, fftOrder, hopSize);
+
+    adaptLen = juce::jmax(maLen, (int)std::round(1.5 * envRate));
+    fluxRaw.reset(adaptLen);
+    fluxMA.reset(maLen);
+    onsetEnv.reset(envMaxLen);
+    lowFluxRaw.reset(adaptLen);
+    lowFluxMA.reset(maLen);
+    lowEnv.reset(envMaxLen);
+    lowOnsets.reset(envMaxLen);
+    bpmHistory.reset(bpmHistLen);
+
+    const int maxLagFrames = bpmToLag(minBPM) + 1;
+    const int combLagFrames = 3 * bpmToLag(minBPM) + 1;
+    envScratch.reserve((size_t)envMaxLen);
+    acfBuf.reserve((size_t)combLagFrames);
     acfBuf.resize(1);
-    bpmHistory.clear();
+    lowAcfBuf.reserve((size_t)maxLagFrames);
+    medianScratch.resize((size_t)juce::jmax(maxLagFrames, bpmHistLen));
+    peakBuf.reserve((size_t)maxLagFrames);
+    candBuf.reserve((size_t)(3 * topPeaks));
+    globalAcf.reserve((size_t)combLagFrames);
+    globalLowAcf.reserve((size_t)maxLagFrames);
+    offlineHop = juce::jmax(1, envMaxLen / 2);
+
+    // FFT ACF scratch, sized once for the full analysis window
+    int acfOrder = 1;
+    while ((1 << acfOrder) < 2 * envMaxLen) ++acfOrder;
+    acfFft = std::make_unique<juce::dsp::FFT>(acfOrder);
+    acfFftBuf.assign((size_t)(2 << acfOrder), 0.0f);
+
+    // Incremental accumulators over the tempo lag range (onset envelope: up to the
+    // third comb harmonic)
+    incMinLag = bpmToLag(maxBPM);
+    incMaxLag = juce::jmax(incMinLag + 1, bpmToLag(minBPM));
+    incCombLag = 3 * incMaxLag;
+    incHistory.assign((size_t)(2 * (incCombLag + 1)), 0.0f);
+    incAcf.assign((size_t)(incCombLag - incMinLag + 1), 0.0f);
+    incLowHistory.assign((size_t)(2 * (incMaxLag + 1)), 0.0f);
+    incLowAcf.assign((size_t)(incMaxLag - incMinLag + 1), 0.0f);
+    incTaper.resize(incAcf.size());
+    for (size_t i = 0; i < incTaper.size(); ++i)
+        incTaper[i] = juce::jmax(0.0f, 1.0f - (float)(incMinLag + (int)i) / (float)envMaxLen);
+    incLambda = (float)std::exp(-1.0 / (forgetSeconds * envRate));
+    lowPeakDecay = (float)std::exp(-1.0 / (analysisSeconds * envRate));
+
+    // An onset enters the envelope at its frame centre and the EMA delays it by
+    // (1 - a) / a frames on average
+    beatTracker.prepare(envRate, (double)hopSize,
+        0.6667 * (double)frameSize - (double)hopSize * (1.0 - (double)emaAlpha) / (double)emaAlpha);
 
     currentBpm.store(0.0f);
     currentConf.store(0.0f);
 }
 
-void BpmTracker::reset(bool /*hard*/)
+void BpmTracker::reset(bool hard)
 {
-    std::fill(inFrame.begin(), inFrame.end(), 0.0f);
+    if (ownFrontEnd) ownFrontEnd->reset();
     std::fill(mag.begin(), mag.end(), 0.0f);
     std::fill(bandMag.begin(), bandMag.end(), 0.0f);
     std::fill(prevBandMag.begin(), prevBandMag.end(), 0.0f);
-    fifoFill = 0;
+    prevLowMag = 0.0f;
     emaState = 0.0f;
+    lowEmaState = 0.0f;
+    lowPrev = 0.0f;
+    lowPeakMax = 0.0f;
+    lowRising = false;
     onsetEnv.clear();
     fluxRaw.clear();
     fluxMA.clear();
+    lowFluxRaw.clear();
+    lowFluxMA.clear();
+    lowEnv.clear();
+    lowOnsets.clear();
     bpmHistory.clear();
+    lastACFTime = 0.0;
+    framesSinceTempo = 0;
+    framesSinceAggregate = 0;
+    std::fill(incHistory.begin(), incHistory.end(), 0.0f);
+    std::fill(incAcf.begin(), incAcf.end(), 0.0f);
+    std::fill(incLowHistory.begin(), incLowHistory.end(), 0.0f);
+    std::fill(incLowAcf.begin(), incLowAcf.end(), 0.0f);
+    incEnergy = 0.0f;
+    incMean = 0.0f;
+    incLowEnergy = 0.0f;
+    incLowMean = 0.0f;
+    incPos = 0;
+    incLowPos = 0;
+    incFrames = 0;
+    beatTracker.reset();
+    if (!hard) return;
+
     currentBpm.store(0.0f);
     currentConf.store(0.0f);
-    lastACFTime = 0.0;
+    pickHypotheses = {};
+    hypotheses.store(pickHypotheses);
+    resetOfflineAggregate();
+}
+
+void BpmTracker::resetOfflineAggregate() noexcept
+{
+    globalAcf.clear();
+    globalLowAcf.clear();
+    globalAcfCount = 0;
+    offlineLowOnsets = 0.0;
+    offlineFrames = 0.0;
+    offlineEnvSum = 0.0;
+    offlineLowSum = 0.0;
+    framesSinceAggregate = 0;
 }
 
-void BpmTracker::buildWindow()
+void BpmTracker::attachTo(SpectralFrontEnd& frontEnd)
 {
-    for (int n = 0; n < frameSize; ++n)
-        window[n] = hann(n, frameSize);
+    ownFrontEnd.reset();
+    frontEnd.addConsumer(*this, fftOrder, hopSize);
 }
 
-void BpmTracker::buildBands()
+BpmTracker::BandLayout BpmTracker::buildBands(double sampleRate, int fftSize, int count)
 {
-    bands.clear();
+    BandLayout l;
+    auto& bands = l.bands;
 
     // Mel-spaced triangular bands between 30 Hz and 8 kHz (or Nyquist)
-    const double ny = sr * 0.5;
+    const double ny = sampleRate * 0.5;
     const double fMin = 30.0;
     const double fMax = std::min(8000.0, ny - 1.0);
 
     const double mMin = hzToMel(fMin);
     const double mMax = hzToMel(fMax);
-    const int B = juce::jlimit(3, 12, numBands);
+    const int B = juce::jlimit(3, 12, count);
 
     std::vector<int> centers;
     centers.reserve(B);
@@ -103,114 +198,89 @@ void BpmTracker::buildBands()
     {
         double m = mMin + (mMax - mMin) * (double)(b + 1) / (double)(B + 1);
         double f = melToHz(m);
-        int bin = (int)std::round(f * (double)frameSize / sr);
-        bin = juce::jlimit(1, frameSize / 2 - 1, bin);
+        int bin = (int)std::round(f * (double)fftSize / sampleRate);
+        bin = juce::jlimit(1, fftSize / 2 - 1, bin);
         centers.push_back(bin);
     }
 
     for (int i = 0; i < B; ++i)
     {
         int c = centers[i];
-        int a = juce::jlimit(1, frameSize / 2 - 1, c - juce::jmax(2, c / 3));
-        int c2 = juce::jlimit(2, frameSize / 2, c + juce::jmax(2, c / 3));
+        int a = juce::jlimit(1, fftSize / 2 - 1, c - juce::jmax(2, c / 3));
+        int c2 = juce::jlimit(2, fftSize / 2, c + juce::jmax(2, c / 3));
         bands.push_back({ a, c, c2 });
     }
-}
-
-void BpmTracker::ensureFifoCapacity(int needed)
-{
-    if ((int)fifo.size() - fifoFill < needed)
-        fifo.resize((size_t)(fifoFill + needed + frameSize));
-}
 
-static inline void magnitudeFromFFT(float* fftData, int frameSize, std::vector<float>& magOut)
-{
-    const int nBins = frameSize / 2 + 1;
-    magOut.resize((size_t)nBins);
-    // JUCE real FFT format:
-    // [ Re0, ReN/2, Re1, Im1, Re2, Im2, ... Re(N/2-1), Im(N/2-1) ]
-    magOut[0] = std::abs(fftData[0]);
-    magOut[nBins - 1] = std::abs(fftData[1]);
-    for (int k = 1; k < nBins - 1; ++k)
+    // Triangle weights are fixed per band: precompute them once, normalised so
+    // a band energy is a single dot product over its bin range
+    for (const auto& t : bands)
     {
-        const float re = fftData[2 * k];
-        const float im = fftData[2 * k + 1];
-        magOut[(size_t)k] = std::sqrt(re * re + im * im);
+        l.weightOffset.push_back((int)l.weights.size());
+        float wsum = 0.0f;
+        for (int i = t.a; i <= t.c; ++i) wsum += triWeight(i, t.a, t.b, t.c);
+        for (int i = t.a; i <= t.c; ++i)
+            l.weights.push_back(wsum > 0.0f ? triWeight(i, t.a, t.b, t.c) / wsum : 0.0f);
     }
-}
 
-static inline float triangularBandEnergy(const std::vector<float>& mag, const BpmTracker::Tri& t)
-{
-    float acc = 0.0f, wsum = 0.0f;
-    for (int i = t.a; i <= t.c; ++i)
+    // Low-band flux over the kick / bass fundamentals (40-250 Hz)
+    l.lowLo = juce::jlimit(1, fftSize / 2 - 1, (int)std::round(40.0 * (double)fftSize / sampleRate));
+    l.lowHi = juce::jlimit(l.lowLo + 1, fftSize / 2, (int)std::round(250.0 * (double)fftSize / sampleRate));
+
+    l.lo = l.lowLo;
+    l.hi = l.lowHi;
+    for (const auto& t : bands)
     {
-        const float w = triWeight(i, t.a, t.b, t.c);
-        acc += w * mag[(size_t)i];
-        wsum += w;
+        l.lo = std::min(l.lo, t.a);
+        l.hi = std::max(l.hi, t.c);
     }
-    return (wsum > 0.0f ? acc / wsum : 0.0f);
+    return l;
 }
 
-float BpmTracker::median(std::deque<float> v)
+float BpmTracker::medianInPlace(float* v, int n) noexcept
 {
-    if (v.empty()) return 0.0f;
-    std::sort(v.begin(), v.end());
-    const size_t n = v.size();
-    return (n & 1) ? v[n / 2] : 0.5f * (v[n / 2 - 1] + v[n / 2]);
+    if (n <= 0) return 0.0f;
+    float* mid = v + n / 2;
+    std::nth_element(v, mid, v + n);
+    if (n & 1) return *mid;
+    // Even count: the lower middle is the largest value left of mid
+    const float lo = *std::max_element(v, mid);
+    return 0.5f * (lo + *mid);
 }
 
-float BpmTracker::mean(const std::deque<float>& v)
+void BpmTracker::processMono(const float* samples, int numSamples)
 {
-    if (v.empty()) return 0.0f;
-    double s = 0.0; for (float x : v) s += x;
-    return (float)(s / (double)v.size());
-}
+    if (!samples || numSamples <= 0) return;
+    RealtimeGuard::ScopedRealtimeSection rt;
 
-float BpmTracker::stddev(const std::deque<float>& v, float m)
-{
-    if (v.size() < 2) return 0.0f;
-    double s = 0.0; for (float x : v) { const double d = x - m; s += d * d; }
-    return (float)std::sqrt(s / (double)(v.size() - 1));
+    // Attached trackers are driven by the shared front-end
+    jassert(ownFrontEnd != nullptr);
+    if (ownFrontEnd) ownFrontEnd->processMono(samples, numSamples);
 }
 
-void BpmTracker::processMono(const float* samples, int numSamples)
+void BpmTracker::processSpectrum(const std::vector<float>& spectrum)
 {
-    if (!samples || numSamples <= 0) return;
+    RealtimeGuard::ScopedRealtimeSection rt;
+    jassert((int)spectrum.size() == frameSize / 2 + 1);
 
-    ensureFifoCapacity(numSamples);
-    std::memcpy(fifo.data() + fifoFill, samples, (size_t)numSamples * sizeof(float));
-    fifoFill += numSamples;
-
-    // Form overlapping frames at hopSize
-    while (fifoFill >= frameSize)
+    float flux = 0.0f, lowFlux = 0.0f;
     {
-        // Window
-        for (int n = 0; n < frameSize; ++n)
-            inFrame[(size_t)n] = fifo[(size_t)n] * window[n];
-
-        // Copy to FFT buffer (real in-place)
-        std::memset(fftBuffer.getData(), 0, (size_t)(2 * frameSize) * sizeof(float));
-        for (int i = 0; i < frameSize; ++i)
-            fftBuffer[i] = inFrame[(size_t)i];
+        Telemetry::ScopedStage timer(Telemetry::Stage::envelope);
 
-        fft.performRealOnlyForwardTransform(fftBuffer.getData());
+        // Log compression of magnitudes (only the bins the bands read)
+        const auto& l = *layout;
+        SimdKernels::log1pScaled(spectrum.data() + l.lo, mag.data() + l.lo, l.hi - l.lo + 1, logCompression);
 
-        // Magnitude spectrum
-        magnitudeFromFFT(fftBuffer.getData(), frameSize, mag);
-
-        // Log compression of magnitudes
-        for (auto& v : mag)
-            v = std::log1p(logCompression * v);
-
-        // Band energies
-        for (size_t b = 0; b < bands.size(); ++b)
-            bandMag[b] = triangularBandEnergy(mag, bands[b]);
+        // Band energies from the precomputed triangle tables
+        for (size_t b = 0; b < l.bands.size(); ++b)
+        {
+            const auto& t = l.bands[b];
+            bandMag[b] = SimdKernels::dot(mag.data() + t.a, l.weights.data() + l.weightOffset[b], t.c - t.a + 1);
+        }
 
         // Spectral flux across bands (positive diffs only)
-        float flux = 0.0f;
         if (!prevBandMag.empty())
         {
-            for (size_t b = 0; b < bands.size(); ++b)
+            for (size_t b = 0; b < l.bands.size(); ++b)
             {
                 const float d = bandMag[b] - prevBandMag[b];
                 if (d > 0.0f) flux += d;
@@ -218,132 +288,431 @@ void BpmTracker::processMono(const float* samples, int numSamples)
         }
         prevBandMag = bandMag;
 
-        pushEnvelope(flux);
-
-        // Advance FIFO by hop
-        if (fifoFill > hopSize)
-            std::memmove(fifo.data(), fifo.data() + hopSize, (size_t)(fifoFill - hopSize) * sizeof(float));
-        fifoFill -= hopSize;
+        // Low-band flux: rise of the mean log magnitude over the low bins
+        float lowMag = 0.0f;
+        for (int i = l.lowLo; i <= l.lowHi; ++i) lowMag += mag[(size_t)i];
+        lowMag /= (float)(l.lowHi - l.lowLo + 1);
+        lowFlux = juce::jmax(0.0f, lowMag - prevLowMag);
+        prevLowMag = lowMag;
     }
+
+    pushEnvelope(flux, lowFlux);
 }
 
-void BpmTracker::pushEnvelope(float fluxVal)
+void BpmTracker::processSilentFrame()
+{
+    // The spectrum of silence: the first sound after the gap is measured as an onset
+    std::fill(prevBandMag.begin(), prevBandMag.end(), 0.0f);
+    prevLowMag = 0.0f;
+    if (offline) return;
+
+    // A zero (demeaned) sample: the accumulator forgets at the rate time passes, so a
+    // long gap hands over to the next track as fast as before, without learning from
+    // the noise floor. O(L), no tempo pick: the estimate holds
+    updateIncrementalAcf(incMean, incLowMean);
+    beatTracker.skipFrame();
+}
+
+void BpmTracker::pushEnvelope(float fluxVal, float lowFluxVal)
 {
     // Keep short history for adaptive threshold (≈ 1.5 s)
-    const int adaptLen = juce::jmax(maLen, (int)std::round(1.5 * envRate));
-    fluxRaw.push_back(fluxVal);
-    if ((int)fluxRaw.size() > adaptLen) fluxRaw.pop_front();
+    fluxRaw.push(fluxVal);
 
-    const float m = mean(fluxRaw);
-    const float sd = stddev(fluxRaw, m);
+    const float m = fluxRaw.mean();
+    const float sd = fluxRaw.stddev();
     const float thr = m + threshK * sd;
 
     float onset = juce::jmax(0.0f, fluxVal - thr);
 
     // Whitening via moving average subtraction (slow trend removal)
-    fluxMA.push_back(fluxVal);
-    if ((int)fluxMA.size() > maLen) fluxMA.pop_front();
-    const float ma = mean(fluxMA);
+    fluxMA.push(fluxVal);
+    const float ma = fluxMA.mean();
     onset = juce::jmax(0.0f, onset - 0.5f * ma);
 
     // EMA smoothing
     emaState = (1.0f - emaAlpha) * emaState + emaAlpha * onset;
-    const float env = emaState;
 
-    onsetEnv.push_back(env);
-    if ((int)onsetEnv.size() > envMaxLen) onsetEnv.pop_front();
+    // Low band through the same threshold, whitening and smoothing
+    lowFluxRaw.push(lowFluxVal);
+    float lowOnset = juce::jmax(0.0f, lowFluxVal - (lowFluxRaw.mean() + threshK * lowFluxRaw.stddev()));
+    lowFluxMA.push(lowFluxVal);
+    lowOnset = juce::jmax(0.0f, lowOnset - 0.5f * lowFluxMA.mean());
+    lowEmaState = (1.0f - emaAlpha) * lowEmaState + emaAlpha * lowOnset;
+
+    if (envelopeCapture)
+    {
+        envelopeCapture->push_back(emaState);
+        envelopeCapture->push_back(lowEmaState);
+    }
+
+    processEnvelope(emaState, lowEmaState);
+}
+
+void BpmTracker::processEnvelope(float env, float lowEnvVal)
+{
+    onsetEnv.push(env);
+
+    // Low-band onset density: one count per envelope peak of at least a quarter of the
+    // recent strongest (sustained low notes beating against each other ripple the flux)
+    bool lowPeak = false;
+    if (lowRising && lowEnvVal < lowPrev)
+    {
+        lowPeakMax = juce::jmax(lowPeakMax, lowPrev);
+        lowPeak = lowPrev > 0.25f * lowPeakMax;
+    }
+    lowPeakMax *= lowPeakDecay;
+    lowRising = lowEnvVal > lowPrev;
+    lowPrev = lowEnvVal;
+    lowEnv.push(lowEnvVal);
+    lowOnsets.push(lowPeak ? 1.0f : 0.0f);
+
+    // Everything below is tempo estimation (+ the beat PLL)
+    Telemetry::ScopedStage timer(Telemetry::Stage::acf);
+
+    if (offline)
+    {
+        offlineFrames += 1.0;
+        offlineEnvSum += (double)env;
+        offlineLowSum += (double)lowEnvVal;
+        if (lowPeak) offlineLowOnsets += 1.0;
+
+        // One window per half analysis length once the envelope is full
+        if (++framesSinceAggregate >= offlineHop && onsetEnv.full())
+        {
+            framesSinceAggregate = 0;
+            accumulateOfflineAcf();
+        }
+        return;
+    }
+
+    // The running accumulator is always kept current so the method can be switched live
+    updateIncrementalAcf(env, lowEnvVal);
+    if (acfMethod == AcfMethod::incremental)
+    {
+        if (++framesSinceTempo >= tempoInterval)
+        {
+            framesSinceTempo = 0;
+            computeTempoIncremental();
+        }
+        beatTracker.processFrame(env, currentBpm.load(), onsetEnv);
+        return;
+    }
 
     // Determine if it's time to recompute ACF (≈ every reestimateEvery seconds)
     lastACFTime += 1.0;
-    const double framesPerUpdate = reestimateEvery * envRate;
+    const double framesPerUpdate = reestimateEvery * envRate * tempoInterval;
     if (lastACFTime >= framesPerUpdate)
     {
         lastACFTime = 0.0;
         maybeComputeTempo();
     }
+    beatTracker.processFrame(env, currentBpm.load(), onsetEnv);
 }
 
-void BpmTracker::maybeComputeTempo()
+bool BpmTracker::computeWindowAcf(int& minLag, int& maxLag)
 {
     if ((int)onsetEnv.size() < (int)(2.5 * envRate)) // need a few seconds first
-        return;
-
-    // Copy env to contiguous vector (demean & weight by energy)
-    const int N = (int)onsetEnv.size();
-    std::vector<float> x((size_t)N);
-    double s = 0.0;
-    for (int i = 0; i < N; ++i) { x[(size_t)i] = onsetEnv[(size_t)i]; s += x[(size_t)i]; }
-    const float mu = (float)(s / (double)N);
+        return false;
+
+    // Copy env to contiguous scratch (demean & weight by energy)
+    const int N = onsetEnv.size();
+    std::vector<float>& x = envScratch;
+    x.resize((size_t)N);                 // within reserved capacity
+    onsetEnv.copyTo(x.data());
+    const float mu = onsetEnv.mean();
     for (int i = 0; i < N; ++i) x[(size_t)i] = juce::jmax(0.0f, x[(size_t)i] - mu);
 
     // Lags corresponding to BPM range
-    const int minLag = bpmToLag(maxBPM);
-    const int maxLag = bpmToLag(minBPM);
-    const int L = juce::jlimit(2, juce::jmax(2, N - 2), maxLag);
-
-    // Compute ACF over [minLag, L]
-    computeAcf(x, minLag, L, acfBuf);
-
-    if (acfBuf.empty()) return;
+    minLag = bpmToLag(maxBPM);
+    const int L = juce::jlimit(2, juce::jmax(2, N - 2), bpmToLag(minBPM));
+
+    // Compute ACF over [minLag, 3 * L] for the comb harmonics (computeAcf clamps to the window)
+    computeAcf(x, minLag, 3 * L, acfBuf);
+
+    // Low-band envelope over the tempo range, demeaned alike (x is free again)
+    lowEnv.copyTo(x.data());
+    const float lowMu = lowEnv.mean();
+    for (int i = 0; i < N; ++i) x[(size_t)i] = juce::jmax(0.0f, x[(size_t)i] - lowMu);
+    computeAcf(x, minLag, L, lowAcfBuf);
+    lowOnsetRate = (float)(lowOnsets.mean() * envRate);
+    lowShare = onsetEnv.mean() > 0.0f ? lowEnv.mean() / onsetEnv.mean() : 0.0f;
+
+    maxLag = juce::jlimit(1, N - 1, L);
+    minLag = juce::jlimit(1, maxLag - 1, minLag);
+    return !acfBuf.empty();
+}
 
+bool BpmTracker::pickTempo(const std::vector<float>& acf, int minLag, int L, float& bpmOut, float& confOut)
+{
     // Peak picking: find top K peaks within [minLag..L]
-    struct Peak { int lag; float val; };
-    std::vector<Peak> peaks;
-    peaks.reserve((size_t)topPeaks + 4);
+    const int n = juce::jmin((int)acf.size(), L - minLag + 1);
+    std::vector<AcfPeak>& peaks = peakBuf;
+    peaks.clear();
 
     auto isLocalMax = [&](int i)->bool {
-        const float v = acfBuf[(size_t)i];
-        return v > acfBuf[(size_t)juce::jmax(0, i - 1)] && v >= acfBuf[(size_t)juce::jmin((int)acfBuf.size() - 1, i + 1)];
+        const float v = acf[(size_t)i];
+        return v > acf[(size_t)juce::jmax(0, i - 1)] && v >= acf[(size_t)juce::jmin((int)acf.size() - 1, i + 1)];
         };
 
-    for (int i = 1; i < (int)acfBuf.size() - 1; ++i)
+    for (int i = 1; i < n - 1; ++i)
         if (isLocalMax(i))
-            peaks.push_back({ i + minLag, acfBuf[(size_t)i] });
+            peaks.push_back({ i + minLag, acf[(size_t)i] });
 
-    if (peaks.empty()) return;
+    if (peaks.empty()) return false;
 
-    std::sort(peaks.begin(), peaks.end(), [](const Peak& a, const Peak& b) { return a.val > b.val; });
-    if ((int)peaks.size() > topPeaks) peaks.resize((size_t)topPeaks);
+    const size_t keep = (size_t)juce::jmin(topPeaks, (int)peaks.size());
+    std::partial_sort(peaks.begin(), peaks.begin() + (std::ptrdiff_t)keep, peaks.end(),
+        [](const AcfPeak& a, const AcfPeak& b) { return a.val > b.val; });
+    peaks.resize(keep);
 
-    // Comb-filter scoring with harmonic & subharmonic consideration
-    float bestScore = -1.0f;
-    int bestLag = peaks.front().lag;
+    // Candidates: the peaks and their double / half tempi, each moved to the strongest
+    // lag within +-1 (integer lags of an octave rarely line up exactly)
+    candBuf.clear();
+    auto addCandidate = [&](int lag)
+    {
+        int best = -1;
+        for (int l = lag - 1; l <= lag + 1; ++l)
+            if (l >= minLag && l < minLag + n && (best < 0 || acf[(size_t)(l - minLag)] > acf[(size_t)(best - minLag)]))
+                best = l;
+        if (best < 0) return;
+        for (const auto& c : candBuf)
+            if (c.lag == best) return;
+
+        const float comb = combScoreAtLag(acf, best, minLag);
+        candBuf.push_back({ best, comb, comb * octaveEvidence(best, minLag) });
+    };
     for (const auto& pk : peaks)
     {
-        int L1 = pk.lag;
-        float s1 = combScoreAtLag(acfBuf, L1 - minLag);
+        addCandidate(pk.lag);
+        addCandidate(pk.lag * 2);
+        addCandidate((pk.lag + 1) / 2);
+    }
+    std::sort(candBuf.begin(), candBuf.end(), [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
 
-        // Penalize clear octave errors if not significantly higher
-        int L2 = juce::jlimit(minLag, L, L1 * 2);
-        int Lh = juce::jlimit(minLag, L, juce::jmax(2, L1 / 2));
+    const auto& best = candBuf.front();
+    bpmOut = juce::jlimit(minBPM, maxBPM, lagToBpm(best.lag));
 
-        float s2 = combScoreAtLag(acfBuf, L2 - minLag);
-        float sh = combScoreAtLag(acfBuf, Lh - minLag);
+    // Hypotheses: one per tempo (within 3%), scores as shares of the listed evidence
+    pickHypotheses = {};
+    int count = 0;
+    float total = 0.0f;
+    for (const auto& c : candBuf)
+    {
+        if (count == maxHypotheses || c.score <= 0.0f) break;
+        const float bpm = juce::jlimit(minBPM, maxBPM, lagToBpm(c.lag));
+        bool seen = false;
+        for (int i = 0; i < count; ++i)
+            seen = seen || std::abs(pickHypotheses[(size_t)i].bpm - bpm) < 0.03f * bpm;
+        if (seen) continue;
+
+        pickHypotheses[(size_t)count++] = { bpm, c.score };
+        total += c.score;
+    }
+    for (int i = 0; i < count; ++i)
+        pickHypotheses[(size_t)i].score /= total;
+
+    // Confidence: comb score vs. median ACF over the tempo range (robust; a sparse
+    // envelope has a median at or below zero)
+    const int nAcf = juce::jmin(n, (int)medianScratch.size());
+    std::copy(acf.begin(), acf.begin() + nAcf, medianScratch.begin());
+    const float acfMed = juce::jmax(0.0f, medianInPlace(medianScratch.data(), nAcf));
+    confOut = 0.0f;
+    if (best.comb > 0.0f) confOut = juce::jlimit(0.0f, 1.0f, (best.comb - acfMed) / (best.comb + acfMed + 1e-6f));
+    return true;
+}
 
-        float score = s1;
-        if (s2 > score && (s2 - score) > 0.1f) score = s2 * 0.95f;
-        if (sh > score && (sh - score) > 0.08f) score = sh * 0.92f;
+float BpmTracker::octaveEvidence(int lag, int minLag) const noexcept
+{
+    if (!resolveOctaves) return 1.0f;
+
+    // Tempi an octave apart share most comb harmonics. The beat level is where the
+    // low band (kick / bass) repeats and has about one onset per beat, as far as the
+    // low band carries onsets at all (a sustained low note only ripples)
+    const float bpm = lagToBpm(lag);
+    const float salience = juce::jlimit(0.0f, 1.0f, lowShare / lowShareFloor - 1.0f);
+    float w = 1.0f;
+
+    const int i = lag - minLag;
+    const int nLow = (int)lowAcfBuf.size();
+    if (i >= 0 && i < nLow)
+    {
+        float low = lowAcfBuf[(size_t)i];
+        if (i > 0) low = juce::jmax(low, lowAcfBuf[(size_t)(i - 1)]);
+        if (i + 1 < nLow) low = juce::jmax(low, lowAcfBuf[(size_t)(i + 1)]);
+        w *= 1.0f + salience * lowWeight * juce::jmax(0.0f, low);
+    }
 
-        if (score > bestScore) { bestScore = score; bestLag = L1; }
+    // Floored: density only breaks ties between comparable comb scores
+    if (lowOnsetRate > 0.0f)
+    {
+        const float perBeat = std::log2(lowOnsetRate * 60.0f / bpm) / densityOctaves;
+        const float match = juce::jmax(0.5f, std::exp(-0.5f * perBeat * perBeat));
+        w *= 1.0f + salience * (match - 1.0f);
     }
 
-    float candBpm = juce::jlimit(minBPM, maxBPM, lagToBpm(bestLag));
+    const float prior = std::log2(bpm / priorBpm) / priorOctaves;
+    return w * std::exp(-0.5f * prior * prior);
+}
+
+void BpmTracker::maybeComputeTempo()
+{
+    int minLag = 0, L = 0;
+    if (!computeWindowAcf(minLag, L)) return;
 
-    // Confidence: peak vs. median ACF (robust)
-    std::deque<float> acfCopy;
-    acfCopy.resize(acfBuf.size());
-    for (size_t i = 0; i < acfBuf.size(); ++i) acfCopy[i] = acfBuf[i];
-    const float acfMed = median(acfCopy);
-    float conf = 0.0f;
-    if (acfMed > 1e-6f) conf = juce::jlimit(0.0f, 1.0f, (bestScore - acfMed) / (bestScore + acfMed + 1e-6f));
+    float candBpm = 0.0f, conf = 0.0f;
+    if (!pickTempo(acfBuf, minLag, L, candBpm, conf)) return;
 
+    publishTempo(candBpm, conf);
+}
+
+void BpmTracker::updateIncrementalAcf(float env, float lowEnvVal) noexcept
+{
+    // Same demeaning as the windowed path, against an EMA mean with the same time constant
+    const float lambda = incLambda;
+    incMean = lambda * incMean + (1.0f - lambda) * env;
+    const float y = juce::jmax(0.0f, env - incMean);
+
+    const int H = incCombLag + 1;
+    incPos = (incPos == 0 ? H : incPos) - 1;
+    incHistory[(size_t)incPos] = y;
+    incHistory[(size_t)(incPos + H)] = y;
+
+    incEnergy = lambda * incEnergy + y * y;
+    const float* past = incHistory.data() + incPos + incMinLag;   // y[n - incMinLag], y[n - incMinLag - 1], ...
+    float* r = incAcf.data();
+    const int n = incCombLag - incMinLag + 1;
+    for (int i = 0; i < n; ++i)
+        r[i] = lambda * r[i] + y * past[i];
+
+    // Low-band envelope, tempo range only
+    incLowMean = lambda * incLowMean + (1.0f - lambda) * lowEnvVal;
+    const float z = juce::jmax(0.0f, lowEnvVal - incLowMean);
+
+    const int HL = incMaxLag + 1;
+    incLowPos = (incLowPos == 0 ? HL : incLowPos) - 1;
+    incLowHistory[(size_t)incLowPos] = z;
+    incLowHistory[(size_t)(incLowPos + HL)] = z;
+
+    incLowEnergy = lambda * incLowEnergy + z * z;
+    const float* lowPast = incLowHistory.data() + incLowPos + incMinLag;
+    float* rl = incLowAcf.data();
+    const int nl = incMaxLag - incMinLag + 1;
+    for (int i = 0; i < nl; ++i)
+        rl[i] = lambda * rl[i] + z * lowPast[i];
+
+    ++incFrames;
+}
+
+void BpmTracker::computeTempoIncremental()
+{
+    // Same warm-up as the windowed path
+    if (incFrames < (int)(2.5 * envRate) || incEnergy <= 1e-12f)
+        return;
+
+    // Normalise by lag 0 into the shared ACF buffer (within reserved capacity). The
+    // window ACF sums N - lag products, so apply the same taper: both methods then
+    // rank octave candidates alike
+    acfBuf.resize(incAcf.size());
+    const float inv = 1.0f / incEnergy;
+    for (size_t i = 0; i < incAcf.size(); ++i)
+        acfBuf[i] = incAcf[i] * inv * incTaper[i];
+
+    lowAcfBuf.resize(incLowAcf.size());
+    const float lowInv = incLowEnergy > 1e-12f ? 1.0f / incLowEnergy : 0.0f;
+    for (size_t i = 0; i < incLowAcf.size(); ++i)
+        lowAcfBuf[i] = incLowAcf[i] * lowInv * incTaper[i];
+    lowOnsetRate = (float)(lowOnsets.mean() * envRate);
+    lowShare = onsetEnv.mean() > 0.0f ? lowEnv.mean() / onsetEnv.mean() : 0.0f;
+
+    float candBpm = 0.0f, conf = 0.0f;
+    if (!pickTempo(acfBuf, incMinLag, incMaxLag, candBpm, conf)) return;
+
+    publishTempo(candBpm, conf);
+}
+
+void BpmTracker::publishTempo(float candBpm, float conf)
+{
     // Debounce via short median
-    bpmHistory.push_back(candBpm);
-    if ((int)bpmHistory.size() > bpmHistLen) bpmHistory.pop_front();
-    const float smoothBpm = median(bpmHistory);
+    bpmHistory.push(candBpm);
+    bpmHistory.copyTo(medianScratch.data());
+    const float smoothBpm = medianInPlace(medianScratch.data(), bpmHistory.size());
 
     currentBpm.store(smoothBpm);
     currentConf.store(conf);
+    hypotheses.store(pickHypotheses);
+}
+
+void BpmTracker::accumulateOfflineAcf()
+{
+    int minLag = 0, L = 0;
+    if (!computeWindowAcf(minLag, L)) return;
+
+    if (globalAcfCount == 0)
+    {
+        globalMinLag = minLag;
+        globalMaxLag = L;
+        globalAcf.assign(acfBuf.size(), 0.0);   // within reserved capacity
+        globalLowAcf.assign(lowAcfBuf.size(), 0.0);
+    }
+    // Windows shorter than the first one (tail of a short file) do not line up
+    if (minLag != globalMinLag || L != globalMaxLag || acfBuf.size() != globalAcf.size()
+        || lowAcfBuf.size() != globalLowAcf.size())
+        return;
+
+    for (size_t i = 0; i < acfBuf.size(); ++i)
+        globalAcf[i] += (double)acfBuf[i];
+    for (size_t i = 0; i < lowAcfBuf.size(); ++i)
+        globalLowAcf[i] += (double)lowAcfBuf[i];
+    ++globalAcfCount;
+}
+
+void BpmTracker::finishOffline()
+{
+    // Short input: nothing filled a whole window, use what there is
+    if (globalAcfCount == 0)
+        accumulateOfflineAcf();
+    if (globalAcfCount == 0) return;
+
+    acfBuf.resize(globalAcf.size());   // within reserved capacity
+    const double inv = 1.0 / (double)globalAcfCount;
+    for (size_t i = 0; i < globalAcf.size(); ++i)
+        acfBuf[i] = (float)(globalAcf[i] * inv);
+    lowAcfBuf.resize(globalLowAcf.size());
+    for (size_t i = 0; i < globalLowAcf.size(); ++i)
+        lowAcfBuf[i] = (float)(globalLowAcf[i] * inv);
+    lowOnsetRate = offlineFrames > 0.0 ? (float)(offlineLowOnsets / offlineFrames * envRate) : 0.0f;
+    lowShare = offlineEnvSum > 0.0 ? (float)(offlineLowSum / offlineEnvSum) : 0.0f;
+
+    float bpm = 0.0f, conf = 0.0f;
+    if (!pickTempo(acfBuf, globalMinLag, globalMaxLag, bpm, conf)) return;
+
+    currentBpm.store(bpm);
+    currentConf.store(conf);
+    hypotheses.store(pickHypotheses);
+}
+
+bool BpmTracker::getOfflineTempoCurve(float minBpm, float stepBpm, float* out, int numPoints) const noexcept
+{
+    if (out == nullptr || numPoints <= 0) return false;
+    std::fill(out, out + numPoints, 0.0f);
+    if (globalAcfCount == 0 || globalAcf.empty()) return false;
+
+    // Linear interpolation between integer lags of the averaged ACF
+    const double inv = 1.0 / (double)globalAcfCount;
+    for (int i = 0; i < numPoints; ++i)
+    {
+        const double bpm = (double)minBpm + (double)i * (double)stepBpm;
+        if (bpm <= 0.0) continue;
+
+        const double lag = 60.0 * envRate / bpm;
+        const int l0 = (int)std::floor(lag);
+        if (l0 < globalMinLag || l0 + 1 > globalMaxLag) continue;
+
+        const double t = lag - (double)l0;
+        const size_t idx = (size_t)(l0 - globalMinLag);
+        out[i] = (float)(((1.0 - t) * globalAcf[idx] + t * globalAcf[idx + 1]) * inv);
+    }
+    return true;
 }
 
 void BpmTracker::computeAcf(const std::vector<float>& x, int minLag, int maxLag, std::vector<float>& out)
@@ -359,6 +728,15 @@ void BpmTracker::computeAcf(const std::vector<float>& x, int minLag, int maxLag,
     for (int i = 0; i < N; ++i) denom += (double)x[(size_t)i] * (double)x[(size_t)i];
     if (denom < 1e-12) return;
 
+    if (acfMethod != AcfMethod::direct && acfFft && 2 * N <= acfFft->getSize())
+        computeAcfFft(x, l0, L, out);
+    else
+        computeAcfDirect(x, l0, L, denom, out);
+}
+
+void BpmTracker::computeAcfDirect(const std::vector<float>& x, int l0, int L, double denom, std::vector<float>& out)
+{
+    const int N = (int)x.size();
     for (int lag = l0; lag <= L; ++lag)
     {
         double s = 0.0;
@@ -371,20 +749,48 @@ void BpmTracker::computeAcf(const std::vector<float>& x, int minLag, int maxLag,
     }
 }
 
-float BpmTracker::combScoreAtLag(const std::vector<float>& acf, int idx)
+void BpmTracker::computeAcfFft(const std::vector<float>& x, int l0, int L, std::vector<float>& out)
 {
-    // Combine fundamental + first 3 harmonics with decaying weights
-    const int N = (int)acf.size();
-    const int i1 = idx;
-    const int i2 = (idx >= 0) ? (idx * 2) : -1;
-    const int i3 = (idx >= 0) ? (idx * 3) : -1;
+    // Wiener-Khinchin: acf = IFFT(|FFT(x)|^2), zero padding makes it linear
+    const int N = (int)x.size();
+    const int size = acfFft->getSize();
+    float* buf = acfFftBuf.data();
+
+    std::memcpy(buf, x.data(), (size_t)N * sizeof(float));
+    std::fill(buf + N, buf + 2 * size, 0.0f);
+
+    acfFft->performRealOnlyForwardTransform(buf, true);
+
+    for (int k = 0; k <= size / 2; ++k)
+    {
+        const float re = buf[2 * k];
+        const float im = buf[2 * k + 1];
+        buf[2 * k] = re * re + im * im;
+        buf[2 * k + 1] = 0.0f;
+    }
+
+    acfFft->performRealOnlyInverseTransform(buf);
+
+    // Normalize by lag 0 (same as the direct path's energy term, any IFFT scaling cancels)
+    const float r0 = buf[0];
+    if (r0 <= 0.0f) return;
+    const float inv = 1.0f / r0;
+    for (int lag = l0; lag <= L; ++lag)
+        out[(size_t)(lag - l0)] = buf[lag] * inv;
+}
 
-    auto valAt = [&](int i)->float { return (i >= 0 && i < N) ? acf[(size_t)i] : 0.0f; };
+float BpmTracker::combScoreAtLag(const std::vector<float>& acf, int lag, int minLag) const noexcept
+{
+    // Fundamental + the ACF at twice and three times the lag, with decaying weights.
+    // Harmonics take the best of +-1 lag: an integer lag's multiples drift off the peak
+    const int N = (int)acf.size();
+    auto valAt = [&](int l)->float { const int i = l - minLag; return (i >= 0 && i < N) ? acf[(size_t)i] : 0.0f; };
+    auto nearAt = [&](int l)->float { return juce::jmax(valAt(l - 1), valAt(l), valAt(l + 1)); };
 
     const float s =
-        1.00f * valAt(i1) +
-        0.50f * valAt(i2) +
-        0.33f * valAt(i3);
+        1.00f * valAt(lag) +
+        0.50f * nearAt(2 * lag) +
+        0.33f * nearAt(3 * lag);
 
     return s / (1.0f + 0.5f + 0.33f);
 }
@@ -1,10 +1,14 @@
 #pragma once
 #include <JuceHeader.h>
 #include <vector>
-#include <deque>
+#include <array>
 #include <atomic>
 #include <cmath>
 #include <algorithm>
+#include "SpectralFrontEnd.h"
+#include "RunningWindow.h"
+#include "BeatTracker.h"
+#include "SeqLock.h"
 
 // Pipeline (per hop):
 //   STFT (Hann) -> Mel-like triangular bands (log-compressed)
@@ -12,31 +16,120 @@
 //   -> Whitening (subtract moving average) & smoothing (EMA)
 //   -> Autocorrelation over recent envelope (≈ 8–12 s)
 //   -> Peak picking + comb-filter verification (harmonics & subharmonics)
-//   -> Debounced BPM estimate + confidence
-class BpmTracker
+//   -> Octave stage: peaks and their double / half tempi rescored with low-band
+//      (kick / bass) onset periodicity, low-band onset density and a tempo prior
+//   -> Debounced BPM estimate + confidence, ranked tempo hypotheses
+class BpmTracker : public SpectralFrontEnd::Consumer
 {
 public:
-    explicit BpmTracker(double sampleRate);
-    ~BpmTracker() = default;
+    // Autocorrelation kernel: direct O(N*L) loop or FFT (Wiener-Khinchin) O(N log N)
+    // over the window every reestimateEvery, or (live only) a running lag accumulator
+    // with exponential forgetting, O(L) per envelope frame, re-estimated every hop.
+    // Offline windows use the FFT kernel when incremental is selected.
+    enum class AcfMethod { direct, fft, incremental };
 
-    // Single reset with default argument (no overload, avoid ambiguity)
+    struct Settings
+    {
+        float minBPM = 60.0f;
+        float maxBPM = 200.0f;
+        float analysisSeconds = 10.0f;   // ACF window (FFT path keeps 20-30 s cheap)
+        float reestimateEvery = 0.25f;   // seconds between ACF runs (windowed methods)
+        AcfMethod acfMethod = AcfMethod::incremental;
+        float forgetSeconds = 5.0f;      // incremental ACF time constant
+
+        // Offline (file) analysis: no per-hop estimates; windowed ACFs
+        // (50% overlap) are summed into one global ACF read by finishOffline()
+        bool offline = false;
+
+        // Rescore octave-related candidates with low-band onset evidence and a tempo
+        // prior; off ranks them by the comb score alone
+        bool resolveOctaves = true;
+
+        // Live only: beat phase / downbeat events from the envelope and tempo
+        BeatTracker::Settings beats;
+    };
+
+    // One tempo reading; score is its share of the combined evidence over the set
+    struct TempoHypothesis
+    {
+        float bpm = 0.0f;
+        float score = 0.0f;
+    };
+    static constexpr int maxHypotheses = 4;
+    using Hypotheses = std::array<TempoHypothesis, maxHypotheses>;
+
+    explicit BpmTracker(double sampleRate, const Settings& s = {});
+    ~BpmTracker() override = default;
+
+    // Single reset with default argument (no overload, avoid ambiguity).
+    // hard = false keeps the offline aggregate and last estimate, so a new,
+    // non-contiguous region of the same file can be appended.
     void reset(bool hard = true);
 
-    // Feed time-domain mono samples
+    // Feed time-domain mono samples (standalone use, own front-end)
     void processMono(const float* samples, int numSamples);
 
+    // Take spectra from a shared front-end instead of the private one.
+    // The front-end must run at this tracker's sample rate.
+    void attachTo(SpectralFrontEnd& frontEnd);
+
+    // One STFT frame (frameSize/2 + 1 linear magnitudes) per hop
+    void processSpectrum(const std::vector<float>& spectrum) override;
+
+    // Silence-gated frame: envelope and tempo hold their pre-gap state (the estimate
+    // resumes at once instead of re-learning from a noise floor) while the incremental
+    // ACF keeps forgetting; the beat grid is dropped and re-acquired after the gap
+    void processSilentFrame() override;
+
+    // Feature capture / replay (FeatureFile): each envelope frame appends two values to
+    // out, the onset envelope and the low-band envelope (nullptr = off; reserve up front,
+    // the analysis path must not allocate), and processEnvelope() runs only the tempo
+    // stages on a stored frame pair at getEnvelopeRate()
+    void setEnvelopeCapture(std::vector<float>* out) noexcept { envelopeCapture = out; }
+    void processEnvelope(float env, float lowEnvVal);
+    double getEnvelopeRate() const noexcept { return envRate; }
+    int getHopSize() const noexcept { return hopSize; }
+
+    // Switch ACF kernel at runtime (both paths are preallocated) to compare accuracy
+    void setAcfMethod(AcfMethod m) noexcept { acfMethod = m; }
+    AcfMethod getAcfMethod() const noexcept { return acfMethod; }
+
+    // Live mode: pick the tempo every n envelope frames (incremental) or every
+    // n * reestimateEvery (windowed). The envelope, accumulator and beat PLL still
+    // run every frame. Analysis thread.
+    void setTempoInterval(int frames) noexcept { tempoInterval = juce::jlimit(1, 64, frames); }
+    int getTempoInterval() const noexcept { return tempoInterval; }
+
+    // Offline mode: estimate tempo from the accumulated ACF (sets getBpm/getConfidence)
+    void finishOffline();
+    // Offline mode: drop the accumulated ACF but keep the envelope warm
+    void resetOfflineAggregate() noexcept;
+    // Offline mode: accumulated ACF sampled at numPoints tempi minBpm + i * stepBpm
+    // (compact tempo feature, 0 outside the lag range); false before any window
+    bool getOfflineTempoCurve(float minBpm, float stepBpm, float* out, int numPoints) const noexcept;
+    // Offline mode: ACF windows in the aggregate (finishOffline needs at least one for a stable lag range)
+    int getOfflineWindowCount() const noexcept { return globalAcfCount; }
+
+    // Live mode: online beat tracker fed every envelope frame (route its events with setOutput)
+    BeatTracker& getBeatTracker() noexcept { return beatTracker; }
+
     // Results (thread-safe)
     float getBpm() const noexcept { return currentBpm.load(); }
     float getConfidence() const noexcept { return currentConf.load(); }
+    // Candidates of the latest tempo pick, strongest first (bpm 0 = unused slot).
+    // Live mode publishes every pick; getBpm() is the median over recent picks
+    Hypotheses getHypotheses() const noexcept { return hypotheses.load(); }
 
     // Exposed so helper functions
     struct Tri { int a, b, c; };
 
 private:
+    friend class KernelBench;   // BenchMain.cpp times the private stages
+
     // ---------------- Config ----------------
     double sr = 44100.0;
-    int frameSize = 2048;        // STFT size
-    int hopSize = 512;         // hop; envRate ≈ sr/hop
+    int frameSize = 2048;        // STFT size at 44.1 kHz (scaled with sr)
+    int hopSize = 512;         // hop at 44.1 kHz; envRate ≈ sr/hop
     int fftOrder = 11;          // 2^11 = 2048
     int numBands = 6;           // mel-like bands for flux
     float logCompression = 1.0f; // log1p(lambda*x), lambda=1
@@ -47,57 +140,139 @@ private:
     float maxBPM = 200.0f;
     float analysisSeconds = 10.0f; // ACF window
     float reestimateEvery = 0.25f; // seconds between ACF runs
+    float forgetSeconds = 5.0f;    // incremental ACF time constant
     int   topPeaks = 5;
+    float lowWeight = 1.0f;        // octave stage: score * (1 + w * low-band ACF)
+    float lowShareFloor = 0.15f;   // low / onset envelope mean where the low band starts to count (full at 2x)
+    float densityOctaves = 1.0f;   // width of the onset-density match (octaves)
+    float priorBpm = 120.0f;       // log-normal tempo prior, centre and width (octaves)
+    float priorOctaves = 2.0f;
+    AcfMethod acfMethod = AcfMethod::incremental;
+    bool  offline = false;
+    bool  resolveOctaves = true;
 
     // ---------------- State ----------------
-    // FFT
-    juce::dsp::FFT fft;
-    juce::HeapBlock<float> window;       // Hann
-    juce::HeapBlock<float> fftBuffer;    // 2*frameSize for in-place JUCE FFT
-    std::vector<float> inFrame;          // time-domain frame
-    std::vector<float> mag;              // magnitude spectrum
-
-    std::vector<Tri> bands;
-    std::vector<float> bandMag, prevBandMag;
+    // STFT comes from a SpectralFrontEnd (own one until attachTo is called)
+    std::unique_ptr<SpectralFrontEnd> ownFrontEnd;
+    std::vector<float> mag;              // log-compressed magnitude spectrum
 
-    // Input FIFO to form overlapping frames
-    std::vector<float> fifo;
-    int fifoFill = 0;
+    // Band layout, fixed by rate / frame size / band count (shared via AnalysisTables)
+    struct BandLayout
+    {
+        std::vector<Tri> bands;
+        std::vector<float> weights;      // per band: normalised triangle over bins [a, c], concatenated
+        std::vector<int> weightOffset;   // start of each band in weights
+        int lo = 0, hi = 0;              // bin range covered by the bands (and the low band)
+        int lowLo = 0, lowHi = 0;        // bins of the low-band flux
+    };
+    std::shared_ptr<const BandLayout> layout;
+    std::vector<float> bandMag, prevBandMag;
+    float prevLowMag = 0.0f;
 
-    // Spectral flux & envelope
+    // Spectral flux & envelope (fixed-capacity windows, O(1) running stats)
     double envRate = 0.0;                // sr / hop
-    std::deque<float> fluxRaw;           // last N fluxes
-    std::deque<float> fluxMA;            // moving average for whitening
-    std::deque<float> onsetEnv;          // whitened + smoothed
+    RunningWindow fluxRaw;               // ≈ 1.5 s of fluxes for the adaptive threshold
+    RunningWindow fluxMA;                // moving average for whitening
+    RunningWindow onsetEnv;              // whitened + smoothed
+    RunningWindow lowFluxRaw, lowFluxMA; // low-band threshold / whitening, as above
+    RunningWindow lowEnv;                // low-band envelope, same length as onsetEnv
+    RunningWindow lowOnsets;             // 1 where a low-band onset peaks (density)
     int maLen = 1;                       // samples for moving average in env domain
+    int adaptLen = 1;                    // samples for adaptive threshold
     int envMaxLen = 1;                   // analysis window length (frames)
     float emaState = 0.0f;
+    float lowEmaState = 0.0f;
+    float lowPrev = 0.0f;                // last low-band envelope value (peak detection)
+    float lowPeakMax = 0.0f;             // strongest recent peak, decays over analysisSeconds
+    float lowPeakDecay = 1.0f;
+    bool  lowRising = false;
     double lastACFTime = 0.0;            // in env frames
+    int tempoInterval = 1;               // quality scaling: tempo picks are spaced this many times wider
+    int framesSinceTempo = 0;
 
-    // ACF buffer reused
+    // ACF buffers reused (reserved up front so the tempo path never allocates).
+    // acfBuf spans lags [minLag, 3 * maxLag] so every candidate's comb reads the same
+    // harmonics; lowAcfBuf (low-band envelope) spans the tempo range [minLag, maxLag]
+    std::vector<float> envScratch;       // demeaned copy of onsetEnv
     std::vector<float> acfBuf;
+    std::vector<float> lowAcfBuf;
+    std::vector<float> medianScratch;
+    float lowOnsetRate = 0.0f;           // low-band onsets per second read with lowAcfBuf
+    float lowShare = 0.0f;               // low / onset envelope mean: tonal low bands only ripple
+
+    struct AcfPeak { int lag; float val; };
+    std::vector<AcfPeak> peakBuf;
+    struct Candidate { int lag; float comb, score; };
+    std::vector<Candidate> candBuf;
+
+    // FFT ACF: zero-padded to >= 2*envMaxLen so circular wrap never reaches the lags we read
+    std::unique_ptr<juce::dsp::FFT> acfFft;
+    std::vector<float> acfFftBuf;        // 2*size for in-place JUCE real FFT
+
+    // Offline aggregate: sum of per-window ACFs from lag globalMinLag (tempo range up
+    // to globalMaxLag, comb harmonics beyond), low-band ACFs and low-band onset counts
+    std::vector<double> globalAcf, globalLowAcf;
+    int globalAcfCount = 0;
+    int globalMinLag = 0, globalMaxLag = 0;
+    double offlineLowOnsets = 0.0, offlineFrames = 0.0;
+    double offlineEnvSum = 0.0, offlineLowSum = 0.0;
+    int offlineHop = 1;                  // env frames between aggregated windows
+    int framesSinceAggregate = 0;
+
+    // Incremental ACF (live): r[l] <- lambda * r[l] + y[n] * y[n - l], y = demeaned envelope.
+    // incHistory is mirrored and written backwards, so y[n - l] = incHistory[incPos + l]
+    // is contiguous over the lag range. The low-band envelope runs a second accumulator
+    // over the tempo range only.
+    std::vector<float> incHistory;       // 2 * (incCombLag + 1)
+    std::vector<float> incAcf;           // lags [incMinLag, incCombLag]
+    std::vector<float> incTaper;         // (N - lag) / N of the windowed estimator, N = envMaxLen
+    std::vector<float> incLowHistory;    // 2 * (incMaxLag + 1)
+    std::vector<float> incLowAcf;        // lags [incMinLag, incMaxLag]
+    float incEnergy = 0.0f;              // lag 0
+    float incMean = 0.0f;                // EMA of the envelope for demeaning
+    float incLowEnergy = 0.0f, incLowMean = 0.0f;
+    float incLambda = 1.0f;
+    int incMinLag = 0, incMaxLag = 0, incCombLag = 0, incPos = 0, incLowPos = 0, incFrames = 0;
 
     // Debounce / history
-    std::deque<float> bpmHistory;        // small median filter
+    RunningWindow bpmHistory;            // small median filter
     int bpmHistLen = 8;
 
+    // Beat phase (live)
+    BeatTracker beatTracker;
+
+    std::vector<float>* envelopeCapture = nullptr;
+
     // Results
     std::atomic<float> currentBpm{ 0.0f };
     std::atomic<float> currentConf{ 0.0f };
+    SeqLock<Hypotheses> hypotheses;
+    Hypotheses pickHypotheses{};         // written by pickTempo, published with the estimate
 
     // ---------------- Impl helpers ----------------
-    void buildWindow();
-    void buildBands();
-    void ensureFifoCapacity(int needed);
-    void pushEnvelope(float fluxVal);
+    static BandLayout buildBands(double sampleRate, int fftSize, int count);
+    void pushEnvelope(float fluxVal, float lowFluxVal);
     void maybeComputeTempo(); // runs ACF at intervals
+    void updateIncrementalAcf(float env, float lowEnvVal) noexcept;
+    void computeTempoIncremental();   // per hop from the running accumulator
+    void publishTempo(float candBpm, float conf);
+    void accumulateOfflineAcf();
+
+    // ACF of the current envelope window into acfBuf; false until a few seconds are buffered
+    bool computeWindowAcf(int& minLag, int& maxLag);
+    // Peak picking + comb scoring on an ACF from minLag (tempo range up to maxLag), then
+    // the octave stage on lowAcfBuf / lowOnsetRate; fills pickHypotheses
+    bool pickTempo(const std::vector<float>& acf, int minLag, int maxLag, float& bpmOut, float& confOut);
+    // Octave stage weight of a candidate (1 with resolveOctaves off)
+    float octaveEvidence(int lag, int minLag) const noexcept;
 
-    static float median(std::deque<float> v);
-    static float mean(const std::deque<float>& v);
-    static float stddev(const std::deque<float>& v, float m);
+    // Median by selection; reorders v in place, no allocation
+    static float medianInPlace(float* v, int n) noexcept;
 
     void computeAcf(const std::vector<float>& x, int minLag, int maxLag, std::vector<float>& out);
-    float combScoreAtLag(const std::vector<float>& acf, int idx); // idx is (lag - minLag)
+    void computeAcfDirect(const std::vector<float>& x, int l0, int L, double denom, std::vector<float>& out);
+    void computeAcfFft(const std::vector<float>& x, int l0, int L, std::vector<float>& out);
+    float combScoreAtLag(const std::vector<float>& acf, int lag, int minLag) const noexcept;
     float lagToBpm(int lag) const { return (float)(60.0 * envRate / (double)lag); }
     int   bpmToLag(float bpm) const
     {
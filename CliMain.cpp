@@ -0,0 +1,394 @@
+// Headless entry point: analyse files / folders and print JSON or CSV.
+// Compiled only with CANONKEY_BUILD_CLI=1, so a build that takes every source
+// still links the app alone. Build the console target (juce_add_console_app or a
+// console exporter) from every source except MainComponent.cpp, AudioEngine.cpp
+// and WasapiLoopback.cpp, defining CANONKEY_BUILD_CLI=1: that also compiles
+// Main.cpp's app entry out.
+// No audio device or window is created, so start-up is just format registration.
+//
+//   canonkey-cli [--format json|csv] [--output <file>] [--threads N] [--no-recursive]
+//                [--cache <dir> | --no-cache]
+//                [--early-exit [--probe-windows N] [--max-seconds S]]
+//                [--emit-features <dir>] [--telemetry <file>] <file|dir>...
+//   canonkey-cli --rescore [--key-profile krumhansl|temperley] [--min-bpm B] [--max-bpm B]
+//                [--no-octave-stage] [--format json|csv] [--output <file>] <file.ckf|dir>...
+//
+// Results are cached by content hash (default: the app's AnalysisCache folder),
+// so rescans of an unchanged library skip decoding.
+//
+// --early-exit stops decoding a file once BPM and key have converged (optionally
+// reading N probe windows spread over the track); analysedSec reports how much
+// audio was read.
+//
+// --telemetry writes per-stage timing histograms (STFT, envelope, ACF, HPCP,
+// Viterbi) gathered over the whole run as JSON.
+//
+// JSON output lists up to four ranked tempo hypotheses per file (tempoHypotheses:
+// BPM and share of the evidence), typically the estimate and its octave neighbours.
+//
+// --emit-features also writes each file's per-frame onset envelopes and chroma to
+// <dir>/<content key>.ckf (full linear decode, no cache lookup). --rescore reads
+// those files instead of audio and re-runs only the tempo and key scoring, so key
+// profiles, tempo ranges and the tempo octave stage can be compared over a library
+// without decoding it again.
+//
+// Exit codes: 0 = all files analysed, 1 = at least one decode error, 2 = bad usage.
+
+#ifndef CANONKEY_BUILD_CLI
+ #define CANONKEY_BUILD_CLI 0
+#endif
+
+#if CANONKEY_BUILD_CLI
+
+#include <JuceHeader.h>
+#include "BatchAnalyzer.h"
+#include "AnalysisCache.h"
+#include "Telemetry.h"
+#include "FeatureFile.h"
+#include <atomic>
+#include <cstdio>
+#include <map>
+
+namespace
+{
+    struct Options
+    {
+        bool csv = false;
+        bool recursive = true;
+        bool useCache = true;
+        bool earlyExit = false;
+        FileAnalysis::EarlyExitOptions earlyExitOptions;
+        int threads = 0;
+        juce::File cacheDir = AnalysisCache::getDefaultDirectory();
+        juce::File output;
+        juce::File telemetry;
+        juce::File featureDir;
+        bool rescore = false;
+        BpmTracker::Settings rescoreBpm;
+        KeyDetector::Settings rescoreKey;
+        juce::Array<juce::File> inputs;
+    };
+
+    void printUsage()
+    {
+        std::fputs("usage: canonkey-cli [--format json|csv] [--output <file>] [--threads N] [--no-recursive]\n"
+                   "                    [--cache <dir> | --no-cache]\n"
+                   "                    [--early-exit [--probe-windows N] [--max-seconds S]]\n"
+                   "                    [--emit-features <dir>] [--telemetry <file>] <file|dir>...\n"
+                   "       canonkey-cli --rescore [--key-profile krumhansl|temperley] [--min-bpm B] [--max-bpm B]\n"
+                   "                    [--no-octave-stage] [--format json|csv] [--output <file>] <file.ckf|dir>...\n", stderr);
+    }
+
+    bool parseArgs(const juce::ArgumentList& args, Options& opt)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto a = args[i].text;
+            const bool hasValue = i + 1 < args.size();
+
+            if (a == "--format" && hasValue)
+            {
+                const auto f = args[++i].text.toLowerCase();
+                if (f != "json" && f != "csv") return false;
+                opt.csv = (f == "csv");
+            }
+            else if (a == "--output" && hasValue)  opt.output = args[++i].resolveAsFile();
+            else if (a == "--threads" && hasValue) opt.threads = juce::jmax(0, args[++i].text.getIntValue());
+            else if (a == "--no-recursive")        opt.recursive = false;
+            else if (a == "--cache" && hasValue)   opt.cacheDir = args[++i].resolveAsFile();
+            else if (a == "--no-cache")            opt.useCache = false;
+            else if (a == "--early-exit")          opt.earlyExit = true;
+            else if (a == "--probe-windows" && hasValue) opt.earlyExitOptions.numWindows = juce::jmax(1, args[++i].text.getIntValue());
+            else if (a == "--max-seconds" && hasValue)   opt.earlyExitOptions.maxSeconds = juce::jmax(0.0, args[++i].text.getDoubleValue());
+            else if (a == "--telemetry" && hasValue)     opt.telemetry = args[++i].resolveAsFile();
+            else if (a == "--emit-features" && hasValue) opt.featureDir = args[++i].resolveAsFile();
+            else if (a == "--rescore")                   opt.rescore = true;
+            else if (a == "--key-profile" && hasValue)
+            {
+                const auto p = args[++i].text.toLowerCase();
+                if (p == "krumhansl")      opt.rescoreKey.profile = KeyDetector::Profile::krumhansl;
+                else if (p == "temperley") opt.rescoreKey.profile = KeyDetector::Profile::temperley;
+                else return false;
+            }
+            else if (a == "--min-bpm" && hasValue) opt.rescoreBpm.minBPM = (float)args[++i].text.getDoubleValue();
+            else if (a == "--max-bpm" && hasValue) opt.rescoreBpm.maxBPM = (float)args[++i].text.getDoubleValue();
+            else if (a == "--no-octave-stage")     opt.rescoreBpm.resolveOctaves = false;
+            else if (a.startsWith("--"))           return false;
+            else                                   opt.inputs.add(args[i].resolveAsFile());
+        }
+        opt.rescoreBpm.offline = opt.rescoreKey.offline = true;
+        if (opt.rescoreBpm.minBPM <= 0.0f || opt.rescoreBpm.maxBPM <= opt.rescoreBpm.minBPM) return false;
+        return !opt.inputs.isEmpty();
+    }
+
+    juce::Array<juce::File> collectFeatureFiles(const juce::Array<juce::File>& filesOrDirs, bool recursive)
+    {
+        juce::Array<juce::File> out;
+        for (const auto& f : filesOrDirs)
+        {
+            if (f.isDirectory())
+            {
+                for (const auto& entry : juce::RangedDirectoryIterator(f, recursive, juce::String("*") + FeatureFile::fileExtension, juce::File::findFiles))
+                    out.add(entry.getFile());
+            }
+            else if (f.existsAsFile())
+            {
+                out.add(f);
+            }
+        }
+        return out;
+    }
+
+    // Re-score stored features in parallel; results in input order
+    std::vector<FileAnalysis::Result> rescoreAll(const juce::Array<juce::File>& files, const Options& opt)
+    {
+        std::vector<FileAnalysis::Result> results((size_t)files.size());
+        if (files.isEmpty()) return results;
+
+        std::atomic<int> remaining{ files.size() };
+        juce::WaitableEvent allDone;
+        {
+            juce::ThreadPool pool(opt.threads > 0 ? opt.threads : juce::jmax(1, juce::SystemStats::getNumCpus()));
+            for (int i = 0; i < files.size(); ++i)
+            {
+                pool.addJob([&, i]
+                    {
+                        const FeatureFile::Reader reader(files[i]);
+                        auto& r = results[(size_t)i];
+                        r = FeatureFile::rescore(reader, opt.rescoreBpm, opt.rescoreKey);
+                        if (!r.ok && r.file == juce::File()) r.file = files[i];
+
+                        if (remaining.fetch_sub(1) == 1)
+                            allDone.signal();
+                    });
+            }
+            allDone.wait();
+        }   // pool joins here
+        return results;
+    }
+
+    juce::String csvField(const juce::String& s)
+    {
+        if (!s.containsAnyOf(",\"\n\r")) return s;
+        return "\"" + s.replace("\"", "\"\"") + "\"";
+    }
+
+    juce::String toCsv(const std::vector<FileAnalysis::Result>& results)
+    {
+        juce::String out = "file,ok,bpm,bpm_confidence,key,key_index,minor,key_confidence,duration_sec,analysed_sec,error\n";
+        for (const auto& r : results)
+        {
+            out << csvField(r.file.getFullPathName()) << ','
+                << (r.ok ? "1" : "0") << ','
+                << juce::String(r.bpm, 2) << ','
+                << juce::String(r.bpmConfidence, 3) << ','
+                << FileAnalysis::keyName(r.keyIndex, r.isMinor) << ','
+                << r.keyIndex << ','
+                << (r.isMinor ? "1" : "0") << ','
+                << juce::String(r.keyConfidence, 3) << ','
+                << juce::String(r.durationSec, 3) << ','
+                << juce::String(r.analysedSec, 3) << ','
+                << csvField(r.error) << '\n';
+        }
+        return out;
+    }
+
+    juce::String toJson(const std::vector<FileAnalysis::Result>& results)
+    {
+        juce::Array<juce::var> items;
+        for (const auto& r : results)
+        {
+            auto* o = new juce::DynamicObject();
+            o->setProperty("file", r.file.getFullPathName());
+            o->setProperty("ok", r.ok);
+            if (r.ok)
+            {
+                o->setProperty("bpm", r.bpm);
+                o->setProperty("bpmConfidence", r.bpmConfidence);
+
+                juce::Array<juce::var> hyps;
+                for (const auto& h : r.tempoHypotheses)
+                {
+                    if (h.bpm <= 0.0f) break;
+                    auto* ho = new juce::DynamicObject();
+                    ho->setProperty("bpm", h.bpm);
+                    ho->setProperty("score", h.score);
+                    hyps.add(juce::var(ho));
+                }
+                if (!hyps.isEmpty()) o->setProperty("tempoHypotheses", hyps);
+
+                o->setProperty("key", r.keyIndex >= 0 ? juce::var(FileAnalysis::keyName(r.keyIndex, r.isMinor)) : juce::var());
+                o->setProperty("keyIndex", r.keyIndex);
+                o->setProperty("minor", r.isMinor);
+                o->setProperty("keyConfidence", r.keyConfidence);
+                o->setProperty("tuningCents", r.tuningCents);
+                o->setProperty("sampleRate", r.sampleRate);
+                o->setProperty("durationSec", r.durationSec);
+                o->setProperty("analysedSec", r.analysedSec);
+                o->setProperty("earlyExit", r.earlyExit);
+                o->setProperty("converged", r.converged);
+                o->setProperty("cached", r.fromCache);
+            }
+            else
+            {
+                o->setProperty("error", r.error);
+            }
+
+            if (!r.segments.empty())
+            {
+                juce::Array<juce::var> timeline;
+                for (const auto& seg : r.segments)
+                {
+                    auto* so = new juce::DynamicObject();
+                    so->setProperty("startSec", seg.startSec);
+                    so->setProperty("endSec", seg.endSec);
+                    so->setProperty("bpm", seg.bpm);
+                    so->setProperty("bpmConfidence", seg.bpmConfidence);
+                    so->setProperty("key", seg.keyIndex >= 0 ? juce::var(FileAnalysis::keyName(seg.keyIndex, seg.isMinor)) : juce::var());
+                    so->setProperty("keyConfidence", seg.keyConfidence);
+                    timeline.add(juce::var(so));
+                }
+                o->setProperty("segments", timeline);
+            }
+            items.add(juce::var(o));
+        }
+        return juce::JSON::toString(juce::var(items)) + "\n";
+    }
+
+    // To --output or stdout
+    bool writeResults(const juce::String& text, const Options& opt)
+    {
+        if (opt.output == juce::File())
+        {
+            std::fputs(text.toRawUTF8(), stdout);
+            return true;
+        }
+        if (opt.output.replaceWithText(text)) return true;
+        std::fprintf(stderr, "canonkey-cli: cannot write %s\n", opt.output.getFullPathName().toRawUTF8());
+        return false;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // Message manager for JUCE internals only; no window is ever created
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    Options opt;
+    if (!parseArgs(juce::ArgumentList(argc, argv), opt))
+    {
+        printUsage();
+        return 2;
+    }
+
+    if (opt.rescore)
+    {
+        const auto featureFiles = collectFeatureFiles(opt.inputs, opt.recursive);
+        if (featureFiles.isEmpty())
+        {
+            std::fputs("canonkey-cli: no feature files found\n", stderr);
+            return 2;
+        }
+
+        const auto results = rescoreAll(featureFiles, opt);
+        int numFailed = 0;
+        for (const auto& r : results)
+        {
+            if (r.ok) continue;
+            ++numFailed;
+            std::fprintf(stderr, "canonkey-cli: %s: %s\n", r.file.getFullPathName().toRawUTF8(), r.error.toRawUTF8());
+        }
+        return writeResults(opt.csv ? toCsv(results) : toJson(results), opt) && numFailed == 0 ? 0 : 1;
+    }
+
+    const auto files = BatchAnalyzer::collectAudioFiles(opt.inputs, opt.recursive);
+    if (files.isEmpty())
+    {
+        std::fputs("canonkey-cli: no supported audio files found\n", stderr);
+        return 2;
+    }
+
+    // Results arrive in completion order; report them in input order
+    std::map<juce::String, FileAnalysis::Result> byPath;
+    juce::CriticalSection lock;
+
+    auto report = [&](const FileAnalysis::Result& r)
+        {
+            if (!r.ok)
+                std::fprintf(stderr, "canonkey-cli: %s: %s\n",
+                    r.file.getFullPathName().toRawUTF8(), r.error.toRawUTF8());
+
+            const juce::ScopedLock sl(lock);
+            byPath[r.file.getFullPathName()] = r;
+        };
+
+    // Profile every analysis thread (the app records live threads only)
+    Telemetry::setRecordAllThreads(opt.telemetry != juce::File());
+
+    std::unique_ptr<AnalysisCache> cache;
+    if (opt.useCache)
+        cache = std::make_unique<AnalysisCache>(opt.cacheDir);
+
+    const bool emitFeatures = opt.featureDir != juce::File();
+    if (emitFeatures && !opt.featureDir.createDirectory())
+    {
+        std::fprintf(stderr, "canonkey-cli: cannot create %s\n", opt.featureDir.getFullPathName().toRawUTF8());
+        return 1;
+    }
+
+    if (files.size() == 1 && !emitFeatures)
+    {
+        // A single file gets all the cores through segment-parallel analysis
+        FileAnalysis::SegmentOptions so;
+        so.numThreads = opt.threads;
+        auto analyse = [&]
+            {
+                return opt.earlyExit ? FileAnalysis::analyzeFileEarlyExit(files[0], opt.earlyExitOptions)
+                                     : FileAnalysis::analyzeFileSegmented(files[0], so);
+            };
+        report(cache ? cache->getOrAnalyze(files[0], analyse, opt.earlyExit) : analyse());
+    }
+    else
+    {
+        BatchAnalyzer batch(opt.threads);
+        batch.setCache(cache.get());
+        batch.setEarlyExit(opt.earlyExit, opt.earlyExitOptions);
+        if (emitFeatures) batch.setFeatureOutput(opt.featureDir);
+        batch.start(files, report);
+        batch.waitForCompletion();
+    }
+
+    if (cache)
+        std::fprintf(stderr, "canonkey-cli: cache %d hits, %d misses\n", cache->getHits(), cache->getMisses());
+
+    int numFailed = 0;
+    double audioSec = 0.0, decodedSec = 0.0;
+
+    std::vector<FileAnalysis::Result> results;
+    results.reserve((size_t)files.size());
+    for (const auto& f : files)
+    {
+        auto it = byPath.find(f.getFullPathName());
+        if (it != byPath.end())
+        {
+            results.push_back(it->second);
+            if (!it->second.ok) ++numFailed;
+            audioSec += it->second.durationSec;
+            if (!it->second.fromCache) decodedSec += it->second.analysedSec;
+        }
+    }
+
+    if (opt.earlyExit && audioSec > 0.0)
+        std::fprintf(stderr, "canonkey-cli: decoded %.1f of %.1f s (%.0f%%)\n",
+            decodedSec, audioSec, 100.0 * decodedSec / audioSec);
+
+    if (opt.telemetry != juce::File() && !Telemetry::writeJson(opt.telemetry))
+        std::fprintf(stderr, "canonkey-cli: cannot write %s\n", opt.telemetry.getFullPathName().toRawUTF8());
+
+    if (!writeResults(opt.csv ? toCsv(results) : toJson(results), opt))
+        return 1;
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+#endif // CANONKEY_BUILD_CLI
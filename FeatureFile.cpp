@@ -0,0 +1,176 @@
+#include "FeatureFile.h"
+#include "AnalysisCache.h"
+#include <cmath>
+#include <cstring>
+
+namespace FeatureFile
+{
+    namespace
+    {
+        constexpr char magicBytes[4] = { 'C', 'K', 'F', 'T' };
+        constexpr int valuesPerChromaFrame = 13;
+
+        static_assert(sizeof(Header) == 72, "Header layout is part of the file format");
+        static_assert(sizeof(KeyFrame) == 26, "KeyFrame layout is part of the file format");
+
+        constexpr uint64_t align16(uint64_t n) noexcept { return (n + 15) & ~(uint64_t)15; }
+    }
+
+    bool write(const Features& f, const juce::File& file)
+    {
+        const auto path = f.sourcePath.toUTF8();
+        const auto pathBytes = (uint32_t)std::strlen(path.getAddress());
+        const auto numEnv = (uint32_t)(f.envelope.size() / 2);
+        const auto numKey = (uint32_t)(f.chroma.size() / valuesPerChromaFrame);
+
+        Header h{};
+        std::memcpy(h.magic, magicBytes, sizeof(magicBytes));
+        h.version = formatVersion;
+        h.sourceRate = f.sourceRate;
+        h.analysisRate = f.analysisRate;
+        h.durationSec = f.durationSec;
+        h.envHop = (uint32_t)f.envHop;
+        h.keyHop = (uint32_t)f.keyHop;
+        h.numEnvFrames = numEnv;
+        h.numKeyFrames = numKey;
+        h.pathBytes = pathBytes;
+        h.analysisVersion = (uint32_t)AnalysisCache::analysisVersion;
+        h.envOffset = align16(sizeof(Header) + pathBytes);
+        h.keyOffset = align16(h.envOffset + (uint64_t)numEnv * 2 * sizeof(float));
+
+        juce::MemoryBlock block((size_t)(h.keyOffset + (uint64_t)numKey * sizeof(KeyFrame)), true);
+        auto* base = static_cast<char*>(block.getData());
+        std::memcpy(base, &h, sizeof(Header));
+        std::memcpy(base + sizeof(Header), path.getAddress(), pathBytes);
+        if (numEnv > 0)
+            std::memcpy(base + h.envOffset, f.envelope.data(), (size_t)numEnv * 2 * sizeof(float));
+
+        auto* frames = reinterpret_cast<KeyFrame*>(base + h.keyOffset);
+        for (uint32_t i = 0; i < numKey; ++i)
+        {
+            const float* src = f.chroma.data() + (size_t)i * valuesPerChromaFrame;
+            for (int b = 0; b < 12; ++b)
+                frames[i].chroma[b] = (uint16_t)std::lround(juce::jlimit(0.0f, 1.0f, src[b]) * 65535.0f);
+            frames[i].tuningCentiCents = (int16_t)std::lround(juce::jlimit(-300.0f, 300.0f, src[12]) * 100.0f);
+        }
+
+        juce::TemporaryFile tmp(file);
+        return tmp.getFile().replaceWithData(block.getData(), block.getSize())
+            && tmp.overwriteTargetFileWithTemporary();
+    }
+
+    juce::File getFeatureFile(const juce::File& dir, const juce::File& audioFile)
+    {
+        const auto key = AnalysisCache::computeKey(audioFile);
+        return key.isEmpty() ? juce::File() : dir.getChildFile(key + fileExtension);
+    }
+
+    Reader::Reader(const juce::File& file)
+        : map(std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly))
+    {
+        const auto size = (uint64_t)map->getSize();
+        const auto* h = static_cast<const Header*>(map->getData());
+        if (h == nullptr || size < sizeof(Header))
+        {
+            error = "Cannot map feature file.";
+            return;
+        }
+        if (std::memcmp(h->magic, magicBytes, sizeof(magicBytes)) != 0 || h->version != formatVersion)
+        {
+            error = "Not a feature file of this version.";
+            return;
+        }
+        if (h->analysisVersion != (uint32_t)AnalysisCache::analysisVersion)
+        {
+            error = "Features are from an older analyzer; extract them again.";
+            return;
+        }
+        if (sizeof(Header) + (uint64_t)h->pathBytes > h->envOffset || h->envOffset % 16 != 0
+            || h->envOffset + (uint64_t)h->numEnvFrames * 2 * sizeof(float) > h->keyOffset
+            || h->keyOffset + (uint64_t)h->numKeyFrames * sizeof(KeyFrame) > size)
+        {
+            error = "Truncated feature file.";
+            return;
+        }
+        header = h;
+    }
+
+    juce::String Reader::getSourcePath() const
+    {
+        if (header == nullptr) return {};
+        const auto* p = reinterpret_cast<const char*>(header) + sizeof(Header);
+        return juce::String::fromUTF8(p, (int)header->pathBytes);
+    }
+
+    const float* Reader::getEnvelope() const noexcept
+    {
+        return header != nullptr ? reinterpret_cast<const float*>(reinterpret_cast<const char*>(header) + header->envOffset) : nullptr;
+    }
+
+    const KeyFrame* Reader::getKeyFrames() const noexcept
+    {
+        return header != nullptr ? reinterpret_cast<const KeyFrame*>(reinterpret_cast<const char*>(header) + header->keyOffset) : nullptr;
+    }
+
+    FileAnalysis::Result rescore(const Reader& features, const BpmTracker::Settings& bpmSettings,
+        const KeyDetector::Settings& keySettings)
+    {
+        FileAnalysis::Result res;
+        if (!features.isValid())
+        {
+            res.error = features.getError();
+            return res;
+        }
+
+        const double t0 = juce::Time::getMillisecondCounterHiRes();
+        const auto& h = features.getHeader();
+        res.file = juce::File(features.getSourcePath());
+        res.sampleRate = h.sourceRate;
+        res.durationSec = h.durationSec;
+
+        BpmTracker bpm(h.analysisRate, bpmSettings);
+        KeyDetector key(h.analysisRate, keySettings);
+        if (bpm.getHopSize() != (int)h.envHop || key.getHopSize() != (int)h.keyHop)
+        {
+            res.error = "Settings change the framing of the stored features.";
+            return res;
+        }
+
+        const float* env = features.getEnvelope();
+        for (uint32_t i = 0; i < h.numEnvFrames; ++i)
+            bpm.processEnvelope(env[2 * i], env[2 * i + 1]);
+
+        const KeyFrame* frames = features.getKeyFrames();
+        std::array<float, 12> chroma{ {} };
+        for (uint32_t i = 0; i < h.numKeyFrames; ++i)
+        {
+            for (int b = 0; b < 12; ++b)
+                chroma[(size_t)b] = (float)frames[i].chroma[b] * (1.0f / 65535.0f);
+            key.processChroma(chroma, 0.01f * (float)frames[i].tuningCentiCents);
+        }
+
+        if (bpmSettings.offline) bpm.finishOffline();
+        if (keySettings.offline) key.finishOffline();
+
+        const auto k = key.getLast();
+        res.bpm = bpm.getBpm();
+        res.bpmConfidence = bpm.getConfidence();
+        res.tempoHypotheses = bpm.getHypotheses();
+        res.keyIndex = k.keyIndex;
+        res.isMinor = k.isMinor;
+        res.keyConfidence = k.confidence;
+
+        // Same compact features as a decoded analysis
+        res.tuningCents = key.getTuningCents();
+        res.chroma = key.getOfflineChroma();
+        res.tempoCurve.assign((size_t)FileAnalysis::tempoCurvePoints, 0.0f);
+        if (!bpm.getOfflineTempoCurve(FileAnalysis::tempoCurveMinBpm, FileAnalysis::tempoCurveStepBpm,
+                res.tempoCurve.data(), FileAnalysis::tempoCurvePoints))
+            res.tempoCurve.clear();
+
+        res.analysedSec = 0.0;   // nothing decoded
+        res.ok = true;
+        res.wallSec = (juce::Time::getMillisecondCounterHiRes() - t0) * 0.001;
+        return res;
+    }
+}
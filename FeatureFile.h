@@ -0,0 +1,98 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "FileAnalysis.h"
+#include "BpmTracker.h"
+#include "KeyDetector.h"
+
+// Persisted per-frame analysis features of one file, for re-scoring without decoding.
+// Holds the onset and low-band envelopes (two floats per BPM hop) and the per-frame
+// 12-bin chroma with its tuning estimate (one record per key frame): everything the
+// tempo (ACF / comb / octave) and key (score24 / Viterbi) stages read, at about
+// 1.4 KB per second of audio.
+// Settings that shape the features themselves (KeyDetector peaks, gamma, kernelWidth,
+// framing; the BPM bands) need a fresh decode.
+//
+// File layout (little-endian, sections 16-byte aligned, read through a memory map):
+//   Header | source path (UTF-8) | float envelope[2 * numEnvFrames] | KeyFrame keyFrames[numKeyFrames]
+// with envelope frames stored as (onset, low-band) pairs.
+namespace FeatureFile
+{
+    constexpr uint32_t formatVersion = 2;
+    static const char* const fileExtension = ".ckf";
+
+    struct Header
+    {
+        char     magic[4];          // "CKFT"
+        uint32_t version;           // formatVersion
+        double   sourceRate;        // file sample rate
+        double   analysisRate;      // rate the analyzers ran at (after decimation)
+        double   durationSec;
+        uint32_t envHop;            // analysis-rate samples per envelope value
+        uint32_t keyHop;            // analysis-rate samples per key frame
+        uint32_t numEnvFrames;
+        uint32_t numKeyFrames;
+        uint32_t pathBytes;
+        uint32_t analysisVersion;   // AnalysisCache::analysisVersion of the extractor
+        uint64_t envOffset;         // byte offsets from the start of the file
+        uint64_t keyOffset;
+    };
+
+    // Chroma quantised to 1/65535 (frames are L2-normalised, so bins are 0..1)
+    struct KeyFrame
+    {
+        uint16_t chroma[12];        // C..B
+        int16_t  tuningCentiCents;  // tuning estimate the frame was folded with, 1/100 cent
+    };
+
+    // In-memory features as captured during decoding
+    struct Features
+    {
+        juce::String sourcePath;
+        double sourceRate = 0.0, analysisRate = 0.0, durationSec = 0.0;
+        int envHop = 0, keyHop = 0;
+        std::vector<float> envelope;   // onset, low-band envelope pairs, one per envHop
+        std::vector<float> chroma;     // 13 per key frame: 12 bins (C..B), tuning cents
+    };
+
+    // Replace file with f (via a temporary, so readers never map half a file)
+    bool write(const Features& f, const juce::File& file);
+
+    // <dir>/<content key>.ckf for audioFile (AnalysisCache::computeKey), empty if unreadable
+    juce::File getFeatureFile(const juce::File& dir, const juce::File& audioFile);
+
+    // Read-only view of a feature file; arrays point straight into the mapping
+    class Reader
+    {
+    public:
+        explicit Reader(const juce::File& file);
+
+        // Mapped, well-formed and written by the current extractor
+        bool isValid() const noexcept { return header != nullptr; }
+        juce::String getError() const { return error; }
+
+        const Header& getHeader() const noexcept { return *header; }
+        juce::String getSourcePath() const;
+
+        const float* getEnvelope() const noexcept;   // 2 * numEnvFrames values
+        const KeyFrame* getKeyFrames() const noexcept;
+
+    private:
+        std::unique_ptr<juce::MemoryMappedFile> map;
+        const Header* header = nullptr;
+        juce::String error;
+
+        JUCE_DECLARE_NON_COPYABLE(Reader)
+    };
+
+    // Tempo and key from stored features: only the tempo and key scoring stages run.
+    // offline = true in both settings gives the whole-track scores of analyzeFile;
+    // offline = false replays the live path (Viterbi, dwell and margin gating) and
+    // reports its last published key. The framing must match the stored hops.
+    FileAnalysis::Result rescore(const Reader& features,
+        const BpmTracker::Settings& bpmSettings,
+        const KeyDetector::Settings& keySettings);
+}
@@ -0,0 +1,682 @@
+#include "FileAnalysis.h"
+#include "AnalysisChain.h"
+#include "PrefetchDecoder.h"
+#include "FeatureFile.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <utility>
+
+namespace FileAnalysis
+{
+    static const char* const supportedExtensions[] = { ".wav", ".mp3", ".aiff", ".aif", ".flac", ".ogg", ".m4a" };
+
+    bool isSupportedAudioFile(const juce::File& file)
+    {
+        for (auto* ext : supportedExtensions)
+            if (file.hasFileExtension(ext))
+                return true;
+        return false;
+    }
+
+    juce::String getSupportedWildcard()
+    {
+        juce::StringArray parts;
+        for (auto* ext : supportedExtensions)
+            parts.add(juce::String("*") + ext);
+        return parts.joinIntoString(";");
+    }
+
+    juce::String keyName(int keyIndex, bool isMinor)
+    {
+        static const char* names[12] = { "C","C#","D","D#","E","F","F#","G","G#","A","A#","B" };
+        if (keyIndex < 0 || keyIndex >= 12) return {};
+        return juce::String(names[keyIndex]) + (isMinor ? "m" : "");
+    }
+
+    namespace
+    {
+        constexpr int decodeBlock = 32768; // ~0.74s @ 44.1k per read
+
+        enum class DecodeStatus { ok, cancelled, readError };
+
+        std::unique_ptr<juce::AudioFormatReader> openReader(const juce::File& file)
+        {
+            return PrefetchDecoder::openReader(file);
+        }
+
+        double readerRate(const juce::AudioFormatReader& reader)
+        {
+            return reader.sampleRate > 8000.0 ? reader.sampleRate : 44100.0;
+        }
+
+        // Files are scored from whole-range aggregates, not the live publishing path
+        BpmTracker::Settings offlineBpmSettings()
+        {
+            BpmTracker::Settings s;
+            s.offline = true;
+            return s;
+        }
+
+        KeyDetector::Settings offlineKeySettings()
+        {
+            KeyDetector::Settings s;
+            s.offline = true;
+            return s;
+        }
+
+        // Idle offline chains, handed to the next file at the same rate. A worker takes one
+        // per file (or segment) and gives it back reset, so a batch pool builds its stream
+        // history, envelope windows and ACF scratch once per worker and rate, not per file.
+        class ChainPool
+        {
+        public:
+            struct Release
+            {
+                void operator()(AnalysisChain* c) const noexcept { instance().release(c); }
+            };
+            using Handle = std::unique_ptr<AnalysisChain, Release>;
+
+            static Handle acquire(double sampleRate)
+            {
+                auto& p = instance();
+                {
+                    const juce::ScopedLock sl(p.lock);
+                    for (auto it = p.idle.begin(); it != p.idle.end(); ++it)
+                    {
+                        if ((*it)->getSampleRate() == sampleRate)
+                        {
+                            Handle h(it->release());
+                            p.idle.erase(it);
+                            return h;
+                        }
+                    }
+                }
+                return Handle(new AnalysisChain(sampleRate, offlineBpmSettings(), offlineKeySettings()));
+            }
+
+        private:
+            ChainPool() : maxIdle(2 * juce::jmax(1, juce::SystemStats::getNumCpus()))
+            {
+                idle.reserve((size_t)maxIdle);
+            }
+
+            static ChainPool& instance()
+            {
+                static ChainPool p;
+                return p;
+            }
+
+            void release(AnalysisChain* c) noexcept
+            {
+                std::unique_ptr<AnalysisChain> owned(c);
+                owned->setFeatureCapture(nullptr, nullptr);
+                owned->reset();
+
+                const juce::ScopedLock sl(lock);
+                if ((int)idle.size() < maxIdle)
+                    idle.push_back(std::move(owned));
+            }
+
+            const int maxIdle;
+            juce::CriticalSection lock;
+            std::vector<std::unique_ptr<AnalysisChain>> idle;
+        };
+
+        // Decode [start, end) as a mono downmix into the chain.
+        // prefetch overlaps decoding with analysis on a second thread; segment jobs
+        // already run in parallel and decode inline.
+        // onBlock(endPosOfBlock, blockSamples) runs after every block.
+        template <typename ShouldStop, typename OnBlock>
+        DecodeStatus decodeRange(juce::AudioFormatReader& reader, AnalysisChain& chain,
+            juce::int64 start, juce::int64 end, bool prefetch, ShouldStop&& shouldStop, OnBlock&& onBlock)
+        {
+            PrefetchDecoder decoder(reader, start, end, prefetch, decodeBlock);
+            PrefetchDecoder::Block block;
+
+            while (!shouldStop())
+            {
+                if (!decoder.next(block))
+                    return decoder.hasFailed() ? DecodeStatus::readError : DecodeStatus::ok;
+
+                chain.processMono(block.samples, block.numSamples);
+                onBlock(block.endPos, block.numSamples);
+            }
+            return DecodeStatus::cancelled;
+        }
+
+        // Whole-range features of a finished offline chain
+        struct Features
+        {
+            std::array<float, 12> chroma{ {} };
+            std::vector<float> tempoCurve;
+            float tuningCents = 0.0f;
+        };
+
+        Features collectFeatures(AnalysisChain& chain)
+        {
+            Features f;
+            f.chroma = chain.getKeyDetector().getOfflineChroma();
+            f.tuningCents = chain.getKeyDetector().getTuningCents();
+            f.tempoCurve.assign((size_t)tempoCurvePoints, 0.0f);
+            if (!chain.getBpmTracker().getOfflineTempoCurve(tempoCurveMinBpm, tempoCurveStepBpm,
+                    f.tempoCurve.data(), tempoCurvePoints))
+                f.tempoCurve.clear();
+            return f;
+        }
+
+        // Estimates + features of a finished chain into res
+        void takeEstimates(AnalysisChain& chain, Result& res)
+        {
+            const auto keyRes = chain.getKeyDetector().getLast();
+            res.bpm = chain.getBpmTracker().getBpm();
+            res.bpmConfidence = chain.getBpmTracker().getConfidence();
+            res.tempoHypotheses = chain.getBpmTracker().getHypotheses();
+            res.keyIndex = keyRes.keyIndex;
+            res.isMinor = keyRes.isMinor;
+            res.keyConfidence = keyRes.confidence;
+
+            auto feat = collectFeatures(chain);
+            res.chroma = feat.chroma;
+            res.tempoCurve = std::move(feat.tempoCurve);
+            res.tuningCents = feat.tuningCents;
+        }
+
+        //==============================================================================
+        // Early exit: [from, to) ranges to read, in file order
+        std::vector<std::pair<juce::int64, juce::int64>> probeRegions(juce::int64 total, double sr,
+            const EarlyExitOptions& options)
+        {
+            const auto len = (juce::int64)(juce::jmax(20.0, options.windowSeconds) * sr);
+            const int n = options.numWindows;
+
+            // Windows centred at i / (n + 1) of the track; if they would touch, read linearly
+            if (n <= 1 || (juce::int64)(n + 1) * len > total)
+                return { { 0, total } };
+
+            std::vector<std::pair<juce::int64, juce::int64>> regions;
+            for (int i = 0; i < n; ++i)
+            {
+                const auto centre = total * (i + 1) / (n + 1);
+                const auto from = juce::jlimit<juce::int64>(0, total - len, centre - len / 2);
+                regions.push_back({ from, from + len });
+            }
+            return regions;
+        }
+
+        // Interim estimates from the aggregate so far; converged once stableChecks
+        // consecutive checks give the same key and BPM within tolerance
+        class ConvergenceCheck
+        {
+        public:
+            explicit ConvergenceCheck(const EarlyExitOptions& o) : options(o) {}
+
+            bool update(AnalysisChain& chain)
+            {
+                // An interim read before the first full ACF window would fix a short lag range
+                if (chain.getBpmTracker().getOfflineWindowCount() == 0)
+                    return false;
+
+                chain.finishOffline();   // non-destructive: the aggregates keep growing
+                const float bpm = chain.getBpmTracker().getBpm();
+                const float bpmConf = chain.getBpmTracker().getConfidence();
+                const auto k = chain.getKeyDetector().getLast();
+                const int keyState = k.keyIndex < 0 ? -1 : k.keyIndex + (k.isMinor ? 12 : 0);
+
+                const bool confident = bpm > 0.0f && keyState >= 0
+                    && bpmConf >= options.minBpmConfidence && k.confidence >= options.minKeyConfidence;
+                const bool same = keyState == lastKeyState && std::abs(bpm - lastBpm) <= options.bpmTolerance;
+
+                run = confident ? (same ? run + 1 : 1) : 0;
+                lastBpm = bpm;
+                lastKeyState = keyState;
+                return run >= juce::jmax(1, options.stableChecks);
+            }
+
+        private:
+            const EarlyExitOptions& options;
+            float lastBpm = 0.0f;
+            int lastKeyState = -1;
+            int run = 0;
+        };
+
+        //==============================================================================
+        // Merging segment estimates. A vote is one estimate covering `seconds` of audio.
+        struct TempoVote { float bpm, confidence; double seconds; };
+        struct KeyVote   { int state; float confidence; double seconds; };  // state 0..23 (12.. = minor)
+
+        constexpr float mergeMinBpm = 60.0f, mergeMaxBpm = 200.0f;
+        constexpr float foldLo = 80.0f;          // votes are folded into [80, 160)
+        constexpr float foldTol = 0.02f;         // relative agreement inside one octave
+        constexpr float octaveTol = 0.04f;       // relative agreement when picking the octave
+
+        float foldTempo(float bpm) noexcept
+        {
+            while (bpm >= 2.0f * foldLo) bpm *= 0.5f;
+            while (bpm < foldLo)         bpm *= 2.0f;
+            return bpm;
+        }
+
+        // Confidence-weighted tempo with octave folding: find the folded peak,
+        // then pick the octave most votes actually reported.
+        void mergeTempo(const std::vector<TempoVote>& votes, float& bpmOut, float& confOut)
+        {
+            bpmOut = 0.0f; confOut = 0.0f;
+
+            constexpr float binWidth = 0.5f;
+            constexpr int numBins = (int)(foldLo / binWidth);
+            std::array<double, numBins> hist{ {} };
+
+            double totalSec = 0.0;
+            for (const auto& v : votes)
+            {
+                totalSec += v.seconds;
+                if (v.bpm <= 0.0f || v.confidence <= 0.0f) continue;
+
+                const int b = juce::jlimit(0, numBins - 1, (int)((foldTempo(v.bpm) - foldLo) / binWidth));
+                const double w = (double)v.confidence * v.seconds;
+                hist[(size_t)b] += w;
+                hist[(size_t)((b + 1) % numBins)] += 0.5 * w;   // the fold range is circular
+                hist[(size_t)((b + numBins - 1) % numBins)] += 0.5 * w;
+            }
+            if (totalSec <= 0.0) return;
+
+            const int peak = (int)(std::max_element(hist.begin(), hist.end()) - hist.begin());
+            if (hist[(size_t)peak] <= 0.0) return;
+            const float folded = foldLo + ((float)peak + 0.5f) * binWidth;
+
+            // Octave candidates of the folded peak inside the tracker range
+            float bestBpm = 0.0f;
+            double bestW = -1.0, agreeW = 0.0;
+            for (float cand = folded * 0.25f; cand <= mergeMaxBpm; cand *= 2.0f)
+            {
+                if (cand < mergeMinBpm) continue;
+
+                double w = 0.0, sum = 0.0;
+                for (const auto& v : votes)
+                {
+                    if (v.bpm <= 0.0f || std::abs(v.bpm - cand) > octaveTol * cand) continue;
+                    const double vw = (double)v.confidence * v.seconds;
+                    w += vw;
+                    sum += vw * v.bpm;
+                }
+                if (w > bestW)
+                {
+                    bestW = w;
+                    bestBpm = w > 0.0 ? (float)(sum / w) : cand;
+                }
+            }
+
+            // Agreement is measured on folded tempi, so octave errors still count
+            for (const auto& v : votes)
+                if (v.bpm > 0.0f && std::abs(foldTempo(v.bpm) - foldTempo(bestBpm)) <= foldTol * foldTempo(bestBpm))
+                    agreeW += (double)v.confidence * v.seconds;
+
+            bpmOut = bestBpm;
+            confOut = (float)juce::jlimit(0.0, 1.0, agreeW / totalSec);
+        }
+
+        void mergeKey(const std::vector<KeyVote>& votes, int& keyOut, bool& minorOut, float& confOut)
+        {
+            keyOut = -1; minorOut = false; confOut = 0.0f;
+
+            std::array<double, 24> score{ {} };
+            double totalSec = 0.0;
+            for (const auto& v : votes)
+            {
+                totalSec += v.seconds;
+                if (v.state >= 0 && v.state < 24)
+                    score[(size_t)v.state] += (double)v.confidence * v.seconds;
+            }
+
+            const int best = (int)(std::max_element(score.begin(), score.end()) - score.begin());
+            if (totalSec <= 0.0 || score[(size_t)best] <= 0.0) return;
+
+            keyOut = best % 12;
+            minorOut = best >= 12;
+            confOut = (float)juce::jlimit(0.0, 1.0, score[(size_t)best] / totalSec);
+        }
+
+        //==============================================================================
+        // One segment: decode warm-up, then aggregate the counted range only
+        class SegmentJob : public juce::ThreadPoolJob
+        {
+        public:
+            SegmentJob(const juce::File& f, juce::int64 decodeFrom, juce::int64 countFrom, juce::int64 countTo,
+                Segment& out, Features& feat, DecodeStatus& status, std::atomic<bool>& cancel,
+                std::atomic<juce::int64>& samplesDone, std::atomic<int>& remaining, juce::WaitableEvent& done)
+                : juce::ThreadPoolJob("Segment"), file(f), from(decodeFrom), countStart(countFrom), to(countTo),
+                segment(out), features(feat), result(status), cancelFlag(cancel), progressSamples(samplesDone),
+                jobsRemaining(remaining), allDone(done) {}
+
+            JobStatus runJob() override
+            {
+                run();
+                if (jobsRemaining.fetch_sub(1) == 1)
+                    allDone.signal();
+                return jobHasFinished;
+            }
+
+        private:
+            void run()
+            {
+                auto reader = openReader(file);
+                if (!reader) { result = DecodeStatus::readError; return; }
+
+                const double sr = readerRate(*reader);
+                const auto pooled = ChainPool::acquire(sr);
+                auto& chain = *pooled;
+
+                auto shouldStop = [this] { return cancelFlag.load() || shouldExit(); };
+                auto onBlock = [this](juce::int64, int n) { progressSamples.fetch_add(n); };
+
+                // Warm-up settles envelope / chroma state, then only the counted range is aggregated
+                result = decodeRange(*reader, chain, from, countStart, false, shouldStop, onBlock);
+                if (result != DecodeStatus::ok) return;
+                chain.resetOfflineAggregate();
+
+                result = decodeRange(*reader, chain, countStart, to, false, shouldStop, onBlock);
+                if (result != DecodeStatus::ok) return;
+                chain.finishOffline();
+
+                const auto k = chain.getKeyDetector().getLast();
+                segment.startSec = (double)countStart / sr;
+                segment.endSec = (double)to / sr;
+                segment.bpm = chain.getBpmTracker().getBpm();
+                segment.bpmConfidence = chain.getBpmTracker().getConfidence();
+                segment.keyIndex = k.keyIndex;
+                segment.isMinor = k.isMinor;
+                segment.keyConfidence = k.confidence;
+                features = collectFeatures(chain);
+            }
+
+            juce::File file;
+            juce::int64 from, countStart, to;
+            Segment& segment;
+            Features& features;
+            DecodeStatus& result;
+            std::atomic<bool>& cancelFlag;
+            std::atomic<juce::int64>& progressSamples;
+            std::atomic<int>& jobsRemaining;
+            juce::WaitableEvent& allDone;
+        };
+    }
+
+    Result analyzeFile(const juce::File& file, const ShouldExitFn& shouldExit, const ProgressFn& progress,
+        FeatureFile::Features* features)
+    {
+        Result res;
+        res.file = file;
+        const double t0 = juce::Time::getMillisecondCounterHiRes();
+
+        auto reader = openReader(file);
+        if (!reader)
+        {
+            res.error = "Unsupported or unreadable audio file.";
+            return res;
+        }
+
+        const double sr = readerRate(*reader);
+        const auto pooled = ChainPool::acquire(sr);
+        auto& chain = *pooled;
+
+        const juce::int64 total = reader->lengthInSamples;
+        res.sampleRate = sr;
+        res.durationSec = (double)total / sr;
+
+        if (features != nullptr)
+        {
+            // Sized up front: the analysis path must not allocate
+            auto& bpm = chain.getBpmTracker();
+            auto& key = chain.getKeyDetector();
+            const double analysed = (double)total * chain.getAnalysisRate() / sr;
+            *features = {};
+            features->sourcePath = file.getFullPathName();
+            features->sourceRate = sr;
+            features->analysisRate = chain.getAnalysisRate();
+            features->durationSec = res.durationSec;
+            features->envHop = bpm.getHopSize();
+            features->keyHop = key.getHopSize();
+            features->envelope.reserve(2 * ((size_t)(analysed / bpm.getHopSize()) + 2));
+            features->chroma.reserve(13 * ((size_t)(analysed / key.getHopSize()) + 2));
+            chain.setFeatureCapture(&features->envelope, &features->chroma);
+        }
+
+        const auto status = decodeRange(*reader, chain, 0, total, true,
+            [&] { return shouldExit && shouldExit(); },
+            [&](juce::int64 pos, int)
+            {
+                if (progress) progress((float)((double)pos / (double)total));
+            });
+
+        if (status == DecodeStatus::cancelled)
+        {
+            res.cancelled = true;
+            res.error = "Cancelled";
+            return res;
+        }
+        if (status == DecodeStatus::readError)
+        {
+            res.error = "Read failed during decoding.";
+            return res;
+        }
+
+        chain.finishOffline();
+        takeEstimates(chain, res);
+        res.analysedSec = res.durationSec;
+        res.ok = true;
+        res.wallSec = (juce::Time::getMillisecondCounterHiRes() - t0) * 0.001;
+        return res;
+    }
+
+    Result analyzeFileEarlyExit(const juce::File& file, const EarlyExitOptions& options,
+        const ShouldExitFn& shouldExit, const ProgressFn& progress)
+    {
+        Result res;
+        res.file = file;
+        const double t0 = juce::Time::getMillisecondCounterHiRes();
+
+        auto reader = openReader(file);
+        if (!reader)
+        {
+            res.error = "Unsupported or unreadable audio file.";
+            return res;
+        }
+
+        const double sr = readerRate(*reader);
+        const auto pooled = ChainPool::acquire(sr);
+        auto& chain = *pooled;
+
+        const juce::int64 total = reader->lengthInSamples;
+        res.sampleRate = sr;
+        res.durationSec = (double)total / sr;
+
+        const auto regions = probeRegions(total, sr, options);
+        const juce::int64 budget = options.maxSeconds > 0.0
+            ? std::min(total, (juce::int64)(options.maxSeconds * sr)) : total;
+        juce::int64 planned = 0;
+        for (const auto& r : regions) planned += r.second - r.first;
+        planned = juce::jmax<juce::int64>(1, std::min(planned, budget));
+
+        ConvergenceCheck convergence(options);
+        const auto checkEvery = (juce::int64)(juce::jmax(0.5, options.checkSeconds) * sr);
+        juce::int64 nextCheck = juce::jmax(checkEvery, (juce::int64)(options.minSeconds * sr));
+        juce::int64 analysed = 0;
+        bool converged = false, userCancelled = false;
+
+        for (size_t w = 0; w < regions.size() && !converged && analysed < budget; ++w)
+        {
+            if (w > 0)
+                chain.restartOfflineStream();
+
+            const juce::int64 from = regions[w].first;
+            const juce::int64 to = std::min(regions[w].second, from + (budget - analysed));
+
+            const auto status = decodeRange(*reader, chain, from, to, true,
+                [&]
+                {
+                    userCancelled = shouldExit && shouldExit();
+                    return userCancelled || converged;
+                },
+                [&](juce::int64, int n)
+                {
+                    analysed += n;
+                    if (analysed >= nextCheck)
+                    {
+                        nextCheck += checkEvery;
+                        converged = convergence.update(chain);
+                    }
+                    if (progress) progress((float)juce::jmin(1.0, (double)analysed / (double)planned));
+                });
+
+            if (userCancelled)
+            {
+                res.cancelled = true;
+                res.error = "Cancelled";
+                return res;
+            }
+            if (status == DecodeStatus::readError)
+            {
+                res.error = "Read failed during decoding.";
+                return res;
+            }
+        }
+
+        chain.finishOffline();
+        takeEstimates(chain, res);
+        res.analysedSec = (double)analysed / sr;
+        res.earlyExit = analysed < total;
+        res.converged = converged;
+        res.ok = true;
+        res.wallSec = (juce::Time::getMillisecondCounterHiRes() - t0) * 0.001;
+        return res;
+    }
+
+    Result analyzeFileSegmented(const juce::File& file, const SegmentOptions& options,
+        const ShouldExitFn& shouldExit, const ProgressFn& progress)
+    {
+        const double t0 = juce::Time::getMillisecondCounterHiRes();
+
+        juce::int64 total = 0;
+        double sr = 44100.0;
+        {
+            auto reader = openReader(file);
+            if (!reader)
+            {
+                Result res;
+                res.file = file;
+                res.error = "Unsupported or unreadable audio file.";
+                return res;
+            }
+            total = reader->lengthInSamples;
+            sr = readerRate(*reader);
+        }
+
+        const auto segLen = (juce::int64)(juce::jmax(10.0, options.segmentSeconds) * sr);
+        const auto warmup = (juce::int64)(juce::jmax(0.0, options.warmupSeconds) * sr);
+
+        if ((double)total / sr < options.minFileSeconds || total < 2 * segLen)
+            return analyzeFile(file, shouldExit, progress);
+
+        Result res;
+        res.file = file;
+        res.sampleRate = sr;
+        res.durationSec = (double)total / sr;
+
+        const int numSegments = (int)((total + segLen - 1) / segLen);
+        res.segments.resize((size_t)numSegments);
+        std::vector<DecodeStatus> status((size_t)numSegments, DecodeStatus::ok);
+        std::vector<Features> features((size_t)numSegments);
+
+        std::atomic<bool> cancel{ false };
+        std::atomic<juce::int64> samplesDone{ 0 };
+        std::atomic<int> remaining{ numSegments };
+        juce::WaitableEvent allDone;
+        juce::int64 workSamples = 0;
+
+        const int numThreads = options.numThreads > 0 ? options.numThreads : juce::SystemStats::getNumCpus();
+        {
+            juce::ThreadPool pool(juce::jlimit(1, numSegments, numThreads));
+
+            for (int i = 0; i < numSegments; ++i)
+            {
+                const juce::int64 countFrom = (juce::int64)i * segLen;
+                const juce::int64 countTo = std::min(total, countFrom + segLen);
+                const juce::int64 decodeFrom = std::max<juce::int64>(0, countFrom - warmup);
+                workSamples += countTo - decodeFrom;
+
+                pool.addJob(new SegmentJob(file, decodeFrom, countFrom, countTo,
+                    res.segments[(size_t)i], features[(size_t)i], status[(size_t)i], cancel, samplesDone, remaining, allDone), true);
+            }
+
+            // Poll cancellation and report progress from the calling thread
+            while (!allDone.wait(50))
+            {
+                if (shouldExit && shouldExit())
+                    cancel.store(true);
+                if (progress)
+                    progress((float)juce::jlimit(0.0, 1.0, (double)samplesDone.load() / (double)workSamples));
+            }
+        }   // pool joins here
+
+        for (auto st : status)
+        {
+            if (st == DecodeStatus::cancelled || cancel.load())
+            {
+                res.cancelled = true;
+                res.error = "Cancelled";
+                return res;
+            }
+            if (st == DecodeStatus::readError)
+            {
+                res.error = "Read failed during decoding.";
+                return res;
+            }
+        }
+        if (progress) progress(1.0f);
+        res.analysedSec = (double)samplesDone.load() / sr;
+
+        std::vector<TempoVote> tempoVotes;
+        std::vector<KeyVote> keyVotes;
+        for (const auto& seg : res.segments)
+        {
+            const double sec = seg.endSec - seg.startSec;
+            tempoVotes.push_back({ seg.bpm, seg.bpmConfidence, sec });
+            keyVotes.push_back({ seg.keyIndex < 0 ? -1 : seg.keyIndex + (seg.isMinor ? 12 : 0), seg.keyConfidence, sec });
+        }
+        mergeTempo(tempoVotes, res.bpm, res.bpmConfidence);
+        mergeKey(keyVotes, res.keyIndex, res.isMinor, res.keyConfidence);
+
+        // Features: duration-weighted mean over segments
+        double totalSec = 0.0, curveSec = 0.0;
+        std::vector<double> curve;
+        for (size_t i = 0; i < features.size(); ++i)
+        {
+            const double sec = res.segments[i].endSec - res.segments[i].startSec;
+            totalSec += sec;
+            for (int c = 0; c < 12; ++c)
+                res.chroma[(size_t)c] += (float)(sec * features[i].chroma[(size_t)c]);
+            res.tuningCents += (float)(sec * features[i].tuningCents);
+
+            if (features[i].tempoCurve.size() == (size_t)tempoCurvePoints)
+            {
+                curve.resize((size_t)tempoCurvePoints, 0.0);
+                curveSec += sec;
+                for (int b = 0; b < tempoCurvePoints; ++b)
+                    curve[(size_t)b] += sec * features[i].tempoCurve[(size_t)b];
+            }
+        }
+        if (totalSec > 0.0)
+        {
+            for (auto& c : res.chroma) c = (float)(c / totalSec);
+            res.tuningCents = (float)(res.tuningCents / totalSec);
+            for (double v : curve) res.tempoCurve.push_back((float)(v / curveSec));
+        }
+
+        res.ok = true;
+        res.wallSec = (juce::Time::getMillisecondCounterHiRes() - t0) * 0.001;
+        return res;
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <functional>
+#include <vector>
+#include "BpmTracker.h"
+
+namespace FeatureFile { struct Features; }
+
+// Offline decode + BPM/Key analysis of one audio file.
+// Shared by the UI file card, the batch pool and the headless entry point;
+// no GUI or audio device is touched, so it is safe on any worker thread.
+// Analysis chains are pooled by sample rate and reset between files, so the
+// per-file setup cost in a batch is a lookup, not a rebuild.
+namespace FileAnalysis
+{
+    // Result::tempoCurve layout: ACF strength at tempoCurveMinBpm + i * tempoCurveStepBpm
+    constexpr float tempoCurveMinBpm = 60.0f;
+    constexpr float tempoCurveStepBpm = 1.0f;
+    constexpr int   tempoCurvePoints = 141;   // 60..200 BPM
+
+    // One entry of the per-segment timeline (segmented analysis only)
+    struct Segment
+    {
+        double startSec = 0.0, endSec = 0.0;
+        float  bpm = 0.0f;
+        float  bpmConfidence = 0.0f;
+        int    keyIndex = -1;
+        bool   isMinor = false;
+        float  keyConfidence = 0.0f;
+    };
+
+    struct Result
+    {
+        juce::File   file;
+        bool         ok = false;
+        bool         cancelled = false;
+        juce::String error;
+
+        float  bpm = 0.0f;
+        float  bpmConfidence = 0.0f;
+        int    keyIndex = -1;     // 0..11 = C..B, -1 unknown
+        bool   isMinor = false;
+        float  keyConfidence = 0.0f;
+        float  tuningCents = 0.0f;
+
+        double sampleRate = 0.0;
+        double durationSec = 0.0; // audio length
+        double wallSec = 0.0;     // time spent decoding + analysing
+        double analysedSec = 0.0; // audio decoded for the estimate (segmented: including warm-ups)
+        bool   earlyExit = false; // stopped before the end of the file (see EarlyExitOptions)
+        bool   converged = false; // early exit because BPM and key were stable
+        bool   fromCache = false; // served by AnalysisCache without decoding
+
+        // Compact features (whole-track): normalised chroma and tempo curve
+        std::array<float, 12> chroma{ {} };
+        std::vector<float>    tempoCurve;   // tempoCurvePoints values, empty if too short
+        BpmTracker::Hypotheses tempoHypotheses{};   // ranked tempo readings (not for segmented analysis)
+
+        std::vector<Segment> segments;
+    };
+
+    struct SegmentOptions
+    {
+        double segmentSeconds = 60.0;   // counted length of each segment
+        double warmupSeconds = 15.0;    // decoded before a segment, not counted (envelope + chroma EMA)
+        double minFileSeconds = 300.0;  // shorter files use the linear path
+        int    numThreads = 0;          // 0 = one worker per CPU core
+    };
+
+    // Partial decode for library tagging: interim estimates every checkSeconds,
+    // stop once BPM and key agree over stableChecks consecutive checks
+    struct EarlyExitOptions
+    {
+        double minSeconds = 30.0;        // analysed before the first check
+        double checkSeconds = 5.0;       // audio between checks
+        double maxSeconds = 0.0;         // decode budget, 0 = whole file
+        int    stableChecks = 3;         // consecutive checks with the same estimate
+        float  bpmTolerance = 0.5f;      // BPM drift still counted as the same estimate
+        float  minBpmConfidence = 0.1f;
+        float  minKeyConfidence = 0.02f; // leader margin of the chroma histogram
+
+        // > 1: read probe windows spread evenly over the track instead of from
+        // the start (skips intros); the BPM envelope restarts in each window
+        int    numWindows = 1;
+        double windowSeconds = 30.0;
+    };
+
+    using ShouldExitFn = std::function<bool()>;
+    using ProgressFn = std::function<void(float progress01)>;
+
+    // Decode and analyse a whole file. shouldExit is polled between blocks;
+    // a cancelled run returns ok = false, cancelled = true. features (optional)
+    // receives the per-frame envelope and chroma for FeatureFile re-scoring.
+    Result analyzeFile(const juce::File& file,
+        const ShouldExitFn& shouldExit = {},
+        const ProgressFn& progress = {},
+        FeatureFile::Features* features = nullptr);
+
+    // Long recordings: split into overlapping segments analysed in parallel,
+    // each with its own reader and chain, then merge per-segment estimates
+    // (confidence weighted, octave folded BPM; key vote) into one result.
+    Result analyzeFileSegmented(const juce::File& file,
+        const SegmentOptions& options = {},
+        const ShouldExitFn& shouldExit = {},
+        const ProgressFn& progress = {});
+
+    // Decode only until the estimates converge (or the budget is spent);
+    // Result::analysedSec reports how much audio was read
+    Result analyzeFileEarlyExit(const juce::File& file,
+        const EarlyExitOptions& options = {},
+        const ShouldExitFn& shouldExit = {},
+        const ProgressFn& progress = {});
+
+    // Extensions the decode path handles (registerBasicFormats)
+    bool isSupportedAudioFile(const juce::File& file);
+    juce::String getSupportedWildcard();   // "*.wav;*.mp3;..."
+
+    // Short key name: "C#", "Am"; empty when unknown
+    juce::String keyName(int keyIndex, bool isMinor);
+}
@@ -1,51 +1,49 @@
 #include "KeyDetector.h"
+#include "RealtimeGuard.h"
+#include "Telemetry.h"
+#include "SimdKernels.h"
 #include <cmath>
-#include <numeric>
 #include <algorithm>
 
 namespace {
     // Krumhansl–Schmuckler (C maj/min), normalized later.
     static const float KS_MAJOR[12] = { 6.35f, 2.23f, 3.48f, 2.33f, 4.38f, 4.09f, 2.52f, 5.19f, 2.39f, 3.66f, 2.29f, 2.88f };
     static const float KS_MINOR[12] = { 6.33f, 2.68f, 3.52f, 5.38f, 2.60f, 3.53f, 2.54f, 4.75f, 3.98f, 2.69f, 3.34f, 3.17f };
+    // Temperley (1999), from the Kostka-Payne corpus
+    static const float TEMPERLEY_MAJOR[12] = { 5.0f, 2.0f, 3.5f, 2.0f, 4.5f, 4.0f, 2.0f, 4.5f, 2.0f, 3.5f, 1.5f, 4.0f };
+    static const float TEMPERLEY_MINOR[12] = { 5.0f, 2.0f, 3.5f, 4.5f, 2.0f, 4.0f, 2.0f, 4.5f, 3.5f, 2.0f, 1.5f, 4.0f };
 
-    inline float cosineSim(const float* a, const float* b, int n) {
-        double ab = 0, aa = 0, bb = 0;
-        for (int i = 0; i < n; ++i) { ab += a[i] * b[i]; aa += a[i] * a[i]; bb += b[i] * b[i]; }
-        if (aa <= 1e-12 || bb <= 1e-12) return 0.0f;
-        return (float)(ab / std::sqrt(aa * bb));
-    }
+    constexpr int numStates = 24;
     inline float cosineKernel(float semitoneDelta, float width) {
         const float x = std::abs(semitoneDelta) / std::max(1e-6f, width);
         if (x >= 1.0f) return 0.0f;
         return 0.5f * (1.0f + std::cos(juce::MathConstants<float>::pi * x));
     }
+    // Settings give sizes at 44.1 kHz; keep the bin width at other (e.g. decimated) rates
+    inline int scaledOrder(int order, double sr) {
+        return std::clamp((int)std::lround((double)order + std::log2(sr / 44100.0)), 8, 16);
+    }
 }
 
 KeyDetector::KeyDetector(double sampleRate, const Settings& s)
     : cfg(s),
     sr(sampleRate > 0.0 ? sampleRate : 44100.0),
-    fftOrder(cfg.fftOrder),
-    fftSize(1 << cfg.fftOrder),
-    hop(cfg.hop),
-    fft(cfg.fftOrder)
+    fftOrder(scaledOrder(cfg.fftOrder, sr)),
+    fftSize(1 << fftOrder),
+    hop(std::max(1, (int)(((juce::int64)cfg.hop << fftOrder) >> cfg.fftOrder)))
 {
-    // normalize KS
-    float sumMaj = std::accumulate(std::begin(KS_MAJOR), std::end(KS_MAJOR), 0.0f);
-    float sumMin = std::accumulate(std::begin(KS_MINOR), std::end(KS_MINOR), 0.0f);
-    for (int i = 0; i < 12; ++i) { profMaj[i] = KS_MAJOR[i] / sumMaj; profMin[i] = KS_MINOR[i] / sumMin; }
-
-    window.resize(fftSize);
-    for (int i = 0; i < fftSize; ++i) window[(size_t)i] = hann(i, fftSize);
-
+    buildModel();
     ensureBuffers();
+    ownFrontEnd = std::make_unique<SpectralFrontEnd>();
+    ownFrontEnd->addConsumer(*this, fftOrder, hop);
+    source = ownFrontEnd.get();
     reset(sr);
 }
 
 void KeyDetector::reset(double newSampleRate) {
     if (newSampleRate > 0.0 && std::abs(newSampleRate - sr) > 1e-6) sr = newSampleRate;
 
-    overlap.assign(fftSize, 0.0f);
-    overlapFill = 0;
+    if (ownFrontEnd) ownFrontEnd->reset();
     chromaEMA.fill(0.0f);
     tuningCentsEMA = 0.0f;
     instScore.fill(0.0f);
@@ -55,79 +53,181 @@ void KeyDetector::reset(double newSampleRate) {
     pendingKey = -1;
     pendingSinceMs = 0.0;
     lastPublishMs = 0.0;
+    hopsAnalysed = 0;
+    resetOfflineAggregate();
     lastResult.store(Result{ -1, false, 0.0f });
 }
 
+void KeyDetector::resetOfflineAggregate() noexcept {
+    chromaHist.fill(0.0);
+}
+
+void KeyDetector::buildModel() {
+    const float* majProf = KS_MAJOR;
+    const float* minProf = KS_MINOR;
+    if (cfg.profile == Profile::temperley) { majProf = TEMPERLEY_MAJOR; minProf = TEMPERLEY_MINOR; }
+    else if (cfg.profile == Profile::custom) { majProf = cfg.customMajor.data(); minProf = cfg.customMinor.data(); }
+
+    // Matching chroma rotated to tonic 0 against the C profile == matching chroma
+    // against the profile rotated to the tonic: template[pc] = prof[pc - key]
+    auto addMode = [&](const float* prof, int base) {
+        double norm = 0.0;
+        for (int i = 0; i < 12; ++i) norm += (double)prof[i] * prof[i];
+        const float inv = norm > 1e-12 ? (float)(1.0 / std::sqrt(norm)) : 0.0f;
+        for (int key = 0; key < 12; ++key)
+            for (int pc = 0; pc < 12; ++pc)
+                templates[(size_t)(pc * numStates + base + key)] = prof[wrap12(pc - key)] * inv;
+    };
+    addMode(majProf, 0);    // 0..11
+    addMode(minProf, 12);   // 12..23
+
+    if ((int)cfg.transitions.size() == numStates * numStates) {
+        std::copy(cfg.transitions.begin(), cfg.transitions.end(), transitionLog.begin());
+        return;
+    }
+    jassert(cfg.transitions.empty());   // wrong size: fall back to the built-in model
+
+    // Prefer stay, allow relatives and IV / V with a small bonus, penalise other jumps
+    auto related = [](int a, int b) {
+        const bool minA = a >= 12, minB = b >= 12;
+        const int  pcA = a % 12, pcB = b % 12;
+        if (!minA && minB && pcB == (pcA + 9) % 12) return true; // rel minor
+        if (minA && !minB && pcB == (pcA + 3) % 12) return true; // rel major
+        if (minA == minB && (pcB == (pcA + 7) % 12 || pcB == (pcA + 5) % 12)) return true; // V, IV
+        return false;
+    };
+    for (int from = 0; from < numStates; ++from)
+        for (int to = 0; to < numStates; ++to)
+            transitionLog[(size_t)(from * numStates + to)] = from == to ? cfg.stayBias
+                : related(from, to) ? cfg.neighborBonus : -cfg.transitionPenalty;
+}
+
 void KeyDetector::ensureBuffers() {
-    fftBuf.assign((size_t)fftSize * 2, 0.0f);
-    magRaw.assign((size_t)fftSize / 2 + 1, 0.0f);
-    mag.assign((size_t)fftSize / 2 + 1, 0.0f);
+    jassert(cfg.gamma > 0.0f);
+    peaks.clear();
+    peaks.reserve((size_t)std::max(1, cfg.maxPeaks));
+    // (m/g)^gamma >= 10^(dB/20)  <=>  m/g >= 10^(dB/(20*gamma))
+    peakThreshLin = std::pow(10.0f, cfg.peakRelThreshDb / (20.0f * std::max(1e-3f, cfg.gamma)));
+}
+
+void KeyDetector::attachTo(SpectralFrontEnd& frontEnd) {
+    ownFrontEnd.reset();
+    frontEnd.addConsumer(*this, fftOrder, hop);
+    frontEnd.setFrameStride(*this, frameStride);
+    source = &frontEnd;
+}
+
+void KeyDetector::setFrameStride(int stride) noexcept {
+    frameStride = std::clamp(stride, 1, 64);
+    if (source) source->setFrameStride(*this, frameStride);
 }
 
 void KeyDetector::processMono(const float* samples, int numSamples) {
     if (!samples || numSamples <= 0) return;
-    int idx = 0;
-    while (idx < numSamples) {
-        const int need = fftSize - overlapFill;
-        const int take = std::min(need, numSamples - idx);
-        std::memcpy(overlap.data() + overlapFill, samples + idx, (size_t)take * sizeof(float));
-        overlapFill += take; idx += take;
-        if (overlapFill == fftSize) {
-            analyzeFrame();
-            // slide
-            const int remain = fftSize - hop;
-            std::memmove(overlap.data(), overlap.data() + hop, (size_t)remain * sizeof(float));
-            overlapFill = remain;
-        }
+    RealtimeGuard::ScopedRealtimeSection rt;
+    // Attached detectors are driven by the shared front-end
+    jassert(ownFrontEnd != nullptr);
+    if (ownFrontEnd) ownFrontEnd->processMono(samples, numSamples);
+}
+
+void KeyDetector::processSpectrum(const std::vector<float>& spectrum) {
+    RealtimeGuard::ScopedRealtimeSection rt;
+    jassert((int)spectrum.size() == fftSize / 2 + 1);
+    analyzeFrame(spectrum);
+}
+
+void KeyDetector::analyzeFrame(const std::vector<float>& spectrum) {
+    const float peakMag = SimdKernels::maxValue(spectrum.data(), fftSize / 2 + 1);
+
+    {
+        Telemetry::ScopedStage timer(Telemetry::Stage::hpcp);
+        computePeaksAndHpcp(spectrum, std::max(1e-12f, peakMag));
+    }
+    if (chromaCapture) {
+        chromaCapture->insert(chromaCapture->end(), frameChroma.begin(), frameChroma.end());
+        chromaCapture->push_back(tuningCentsEMA);
     }
+    scoreFrame();
+}
+
+void KeyDetector::processChroma(const std::array<float, 12>& chroma, float tuningCents) {
+    frameChroma = chroma;
+    tuningCentsEMA = tuningCents;
+    smoothChroma();
+    scoreFrame();
 }
 
-void KeyDetector::analyzeFrame() {
-    for (int i = 0; i < fftSize; ++i) {
-        fftBuf[(size_t)(2 * i)] = overlap[(size_t)i] * window[(size_t)i];
-        fftBuf[(size_t)(2 * i + 1)] = 0.0f;
+void KeyDetector::scoreFrame() {
+    hopsAnalysed += frameStride;
+
+    if (cfg.offline) {
+        for (int i = 0; i < 12; ++i) chromaHist[(size_t)i] += frameChroma[(size_t)i];
+        return;
     }
-    fft.performRealOnlyForwardTransform(fftBuf.data());
 
-    const int bins = fftSize / 2;
-    double peakMag = 0.0;
-    for (int k = 0; k <= bins; ++k) {
-        const float re = fftBuf[(size_t)(2 * k)];
-        const float im = fftBuf[(size_t)(2 * k + 1)];
-        const float m = std::sqrt(re * re + im * im);
-        magRaw[(size_t)k] = m;
-        if (m > peakMag) peakMag = m;
-    }
-    const float g = std::max(1e-12f, (float)peakMag);
-    for (int k = 0; k <= bins; ++k) {
-        const float m = magRaw[(size_t)k] / g;
-        mag[(size_t)k] = std::pow(m, cfg.gamma);
-    }
-
-    computePeaksAndHpcp();
-    score24();
-    viterbiStep();
+    {
+        Telemetry::ScopedStage timer(Telemetry::Stage::viterbi);   // template scores + decode step
+        score24(chromaEMA.data());
+        viterbiStep();
+    }
     maybePublish();
 }
 
-void KeyDetector::computePeaksAndHpcp() {
+KeyDetector::Result KeyDetector::finishOffline() {
+    float chroma[12];
+    for (int i = 0; i < 12; ++i) chroma[i] = (float)chromaHist[(size_t)i];
+    score24(chroma);
+
+    int best = -1; float sBest = 0.0f, sSecond = 0.0f;
+    for (int k = 0; k < 24; ++k) {
+        const float s = instScore[(size_t)k];
+        if (s > sBest) { sSecond = sBest; sBest = s; best = k; }
+        else if (s > sSecond) sSecond = s;
+    }
+
+    Result r;
+    if (best >= 0) {
+        r.keyIndex = best % 12;
+        r.isMinor = best >= 12;
+        r.confidence = clamp01(sBest - sSecond);
+    }
+    lastResult.store(r);
+    if (onResult) onResult(r);
+    return r;
+}
+
+std::array<float, 12> KeyDetector::getOfflineChroma() const noexcept {
+    std::array<float, 12> out{ {} };
+    double sum = 0.0;
+    for (double v : chromaHist) sum += v;
+    if (sum <= 0.0) return out;
+
+    for (int i = 0; i < 12; ++i) out[(size_t)i] = (float)(chromaHist[(size_t)i] / sum);
+    return out;
+}
+
+void KeyDetector::computePeaksAndHpcp(const std::vector<float>& spectrum, float peakMag) {
     std::fill(frameChroma.begin(), frameChroma.end(), 0.0f);
     const int bins = fftSize / 2;
     const double binHz = sr / (double)fftSize;
 
-    const float thr = std::pow(10.0f, cfg.peakRelThreshDb / 20.0f);
-    struct Peak { int bin; float m; double hz; };
-    std::vector<Peak> peaks; peaks.reserve((size_t)cfg.maxPeaks);
+    // Pick peaks on the linear spectrum, compress (m/g)^gamma only where needed
+    const float* raw = spectrum.data();
+    const float thr = peakThreshLin * peakMag;
+    const float invG = 1.0f / peakMag;
+    auto compress = [&](float m) { return std::pow(m * invG, cfg.gamma); };
+    peaks.clear();
 
     for (int k = 2; k < bins - 2; ++k) {
-        const float m0 = mag[(size_t)k];
-        if (m0 < thr) continue;
-        if (m0 > mag[(size_t)k - 1] && m0 > mag[(size_t)k + 1] && m0 > mag[(size_t)k - 2] && m0 > mag[(size_t)k + 2]) {
-            const float m1 = mag[(size_t)k - 1], m2 = mag[(size_t)k + 1];
-            const float denom = std::max(1e-12f, 2.0f * (m1 - 2.0f * m0 + m2));
-            const float delta = juce::jlimit(-0.5f, 0.5f, (m1 - m2) / denom);
+        const float r0 = raw[k];
+        if (r0 < thr) continue;
+        if (r0 > raw[k - 1] && r0 > raw[k + 1] && r0 > raw[k - 2] && r0 > raw[k + 2]) {
+            const float m0 = compress(r0), m1 = compress(raw[k - 1]), m2 = compress(raw[k + 1]);
+            // Parabolic interpolation; curvature is negative at a peak
+            const float denom = 2.0f * (m1 - 2.0f * m0 + m2);
+            const float delta = std::abs(denom) > 1e-12f ? juce::jlimit(-0.5f, 0.5f, (m1 - m2) / denom) : 0.0f;
             const double hz = (k + delta) * binHz;
-            peaks.push_back({ k, m0, hz });
+            peaks.push_back({ k, m0, hz });   // within reserved capacity
             if ((int)peaks.size() >= cfg.maxPeaks) break;
         }
     }
@@ -140,8 +240,7 @@ void KeyDetector::computePeaksAndHpcp() {
             if (std::isfinite(cents)) { sumC += cents; ++n; }
         }
         if (n > 0) {
-            const double hopSec = (double)hop / sr;
-            const double a = std::clamp(hopSec / cfg.tuningDecaySec, 0.01, 0.2);
+            const double a = std::clamp(frameSec() / cfg.tuningDecaySec, 0.01, 0.2);
             tuningCentsEMA = (float)((1.0 - a) * tuningCentsEMA + a * (sumC / (double)n));
         }
     }
@@ -164,57 +263,53 @@ void KeyDetector::computePeaksAndHpcp() {
     // L2 norm + EMA
     double s2 = 0.0; for (float v : frameChroma) s2 += (double)v * v;
     if (s2 > 1e-12) for (auto& v : frameChroma) v = (float)(v / std::sqrt(s2));
-    const double hopSec = (double)hop / sr;
-    const double a = std::clamp(hopSec / cfg.chromaDecaySec, 0.02, 0.25);
+    smoothChroma();
+}
+
+void KeyDetector::smoothChroma() {
+    const double a = std::clamp(frameSec() / cfg.chromaDecaySec, 0.02, 0.25);
     for (int i = 0; i < 12; ++i) chromaEMA[i] = (float)((1.0 - a) * chromaEMA[i] + a * frameChroma[i]);
 }
 
-void KeyDetector::score24() {
-    float rot[12];
-    auto scoreMode = [&](const float* tmpl, int base) {
-        for (int key = 0; key < 12; ++key) {
-            for (int i = 0; i < 12; ++i) rot[i] = chromaEMA[(size_t)wrap12(i - key)];
-            instScore[(size_t)(base + key)] = cosineSim(rot, tmpl, 12);
-        }
-        };
-    scoreMode(profMaj.data(), 0);   // 0..11
-    scoreMode(profMin.data(), 12);  // 12..23
+void KeyDetector::score24(const float* chroma) {
+    // Cosine similarity: templates are unit length, so only the chroma norm is left
+    float norm2 = 0.0f;
+    for (int i = 0; i < 12; ++i) norm2 += chroma[i] * chroma[i];
+    if (norm2 <= 1e-12f) { instScore.fill(0.0f); return; }
+    const float inv = 1.0f / std::sqrt(norm2);
+
+    // 24x12 matrix-vector product, one 24-wide row per pitch class
+    float s[numStates] = {};
+    for (int pc = 0; pc < 12; ++pc) {
+        const float c = chroma[pc] * inv;
+        const float* row = templates.data() + pc * numStates;
+        for (int k = 0; k < numStates; ++k) s[k] += c * row[k];
+    }
+    std::copy(s, s + numStates, instScore.begin());
 }
 
 void KeyDetector::viterbiStep() {
-    // Transition model: prefer stay, allow neighbors/relatives with small bonus.
-    std::array<float, 24> next{};
     int best = -1; float bestVal = -1e9f;
 
-    auto related = [&](int a, int b)->bool {
-        const bool minA = a >= 12, minB = b >= 12;
-        const int  pcA = a % 12, pcB = b % 12;
-        if (a == b) return true;
-        if (!minA && minB && pcB == (pcA + 9) % 12) return true; // rel minor
-        if (minA && !minB && pcB == (pcA + 3) % 12) return true; // rel major
-        if (minA == minB && (pcB == (pcA + 7) % 12 || pcB == (pcA + 5) % 12)) return true; // V, IV
-        return false;
-        };
-
     if (!vitInit) {
         // Cold-start with current inst scores
         for (int k = 0; k < 24; ++k) viterbi[(size_t)k] = instScore[(size_t)k];
         vitInit = true;
     }
     else {
-        for (int k = 0; k < 24; ++k) {
-            float bestPrev = -1e9f;
-            for (int p = 0; p < 24; ++p) {
-                float t = 0.0f;
-                if (k == p) t += cfg.stayBias;
-                else if (related(p, k)) t += cfg.neighborBonus;
-                else t -= cfg.transitionPenalty;
-                const float cand = viterbi[(size_t)p] + t;
-                if (cand > bestPrev) bestPrev = cand;
+        // Max-plus matrix-vector step: next[to] = max_from(viterbi[from] + T[from][to]) + inst[to],
+        // swept row by row so the inner loop is a 24-wide max over contiguous floats
+        float next[numStates];
+        std::fill(next, next + numStates, -1e9f);
+        for (int from = 0; from < numStates; ++from) {
+            const float v = viterbi[(size_t)from];
+            const float* row = transitionLog.data() + from * numStates;
+            for (int to = 0; to < numStates; ++to) {
+                const float cand = v + row[to];
+                next[to] = cand > next[to] ? cand : next[to];
             }
-            next[(size_t)k] = bestPrev + instScore[(size_t)k];
         }
-        viterbi = next;
+        for (int k = 0; k < numStates; ++k) viterbi[(size_t)k] = next[k] + instScore[(size_t)k];
     }
     for (int k = 0; k < 24; ++k) if (viterbi[(size_t)k] > bestVal) { bestVal = viterbi[(size_t)k]; best = k; }
 
@@ -232,7 +327,7 @@ void KeyDetector::maybePublish() {
     }
     const float margin = (sSecond <= 1e-6f) ? 1.0f : (sBest - sSecond);
 
-    const double now = nowMs();
+    const double now = streamMs();
     if (pendingKey != best) { pendingKey = best; pendingSinceMs = now; }
 
     const bool dwellOK = (now - pendingSinceMs) >= cfg.dwellRequiredSec * 1000.0;
@@ -4,10 +4,13 @@
 #include <atomic>
 #include <functional>
 #include <vector>
+#include <memory>
+#include "SpectralFrontEnd.h"
+#include "SeqLock.h"
 
 // 24-key real-time detector (C maj..B maj, C min..B min)
 // HPCP from spectral peaks + online Viterbi smoothing + dwell/margin gating
-class KeyDetector {
+class KeyDetector : public SpectralFrontEnd::Consumer {
 public:
     struct Result {
         int   keyIndex = -1;   // 0..11=C..B (C-based), -1 unknown
@@ -15,9 +18,13 @@ public:
         float confidence = 0.0f; // 0..1 (margin)
     };
 
+    // Key profiles (C-based pitch-class weights). Krumhansl-Kessler probe-tone
+    // ratings or Temperley's corpus-derived weights; custom takes Settings::customMajor/Minor.
+    enum class Profile { krumhansl, temperley, custom };
+
     struct Settings {
         // FFT / framing
-        int    fftOrder = 12;     // 4096
+        int    fftOrder = 12;     // 4096 at 44.1 kHz (scaled with the sample rate)
         int    hop = 2048;   // 50% overlap
         double minHz = 55.0;
         double maxHz = 5000.0;
@@ -40,6 +47,17 @@ public:
         float  stayBias = 0.04f; // prefer staying
         float  neighborBonus = 0.02f; // allow related moves
         float  transitionPenalty = 0.04f; // default penalty for large jumps
+
+        // Scoring model, precomputed once per detector
+        Profile profile = Profile::krumhansl;
+        std::array<float, 12> customMajor{ {} }, customMinor{ {} };   // Profile::custom
+        // Optional 24x24 log-domain transition scores [from * 24 + to] (0..11 maj, 12..23 min);
+        // empty = stay / relative / IV-V model from the three values above
+        std::vector<float> transitions;
+
+        // Offline (file) analysis: no per-frame Viterbi/publishing; a
+        // whole-track chroma histogram is scored once by finishOffline()
+        bool   offline = false;
     };
 
     KeyDetector(double sampleRate, const Settings& s = {});
@@ -48,48 +66,94 @@ public:
     // Feed **mono** audio (any block size). RT-safe.
     void processMono(const float* samples, int numSamples);
 
+    // Take spectra from a shared front-end (fftOrder/hop from Settings)
+    void attachTo(SpectralFrontEnd& frontEnd);
+
+    // One STFT frame (fftSize/2 + 1 linear magnitudes) per hop. Silence-gated frames
+    // are ignored: chroma, Viterbi and dwell timing pause across the gap.
+    void processSpectrum(const std::vector<float>& spectrum) override;
+
+    // Analyse only every stride-th frame (1 = every hop); the front-end skips the
+    // other transforms and smoothing / dwell times stay in seconds. Analysis thread.
+    void setFrameStride(int stride) noexcept;
+    int getFrameStride() const noexcept { return frameStride; }
+
+    // Feature capture / replay (FeatureFile): every analysed frame appends its 12
+    // L2-normalised HPCP bins (C..B) and the tuning estimate they were folded with to
+    // out (nullptr = off; reserve up front). processChroma() replays one such frame
+    // through smoothing and scoring only.
+    void setChromaCapture(std::vector<float>* out) noexcept { chromaCapture = out; }
+    void processChroma(const std::array<float, 12>& chroma, float tuningCents);
+    int getHopSize() const noexcept { return hop; }
+
     // Optional callback (called on caller thread)
     void setCallback(std::function<void(const Result&)> cb) { onResult = std::move(cb); }
 
     Result getLast() const { return lastResult.load(); }
 
+    // Current tuning offset estimate in cents (caller thread only)
+    float getTuningCents() const noexcept { return tuningCentsEMA; }
+
+    // Offline mode: score the chroma histogram, publish once (callback + getLast)
+    Result finishOffline();
+    // Offline mode: drop the histogram but keep chroma/tuning state warm
+    void resetOfflineAggregate() noexcept;
+    // Offline mode: accumulated chroma histogram normalised to sum 1 (zeros if empty)
+    std::array<float, 12> getOfflineChroma() const noexcept;
+
 private:
+    friend class KernelBench;   // BenchMain.cpp times the private stages
+
     // pipeline
-    void analyzeFrame();
-    void computePeaksAndHpcp();
-    void score24();            // cosine against KS templates -> instScore[24]
+    void analyzeFrame(const std::vector<float>& spectrum);
+    void computePeaksAndHpcp(const std::vector<float>& spectrum, float peakMag);
+    void smoothChroma();       // frameChroma into chromaEMA
+    void scoreFrame();         // aggregate (offline) or score + Viterbi + publish (live)
+    void score24(const float* chroma); // cosine against KS templates -> instScore[24]
     void viterbiStep();        // online Viterbi update
     void maybePublish();       // dwell/margin/rate-limit to UI
 
     // helpers
     void ensureBuffers();
-    static inline float hann(int n, int N) {
-        return 0.5f * (1.0f - std::cos(2.0f * juce::MathConstants<float>::pi * (float)n / (float)(N - 1)));
-    }
+    void buildModel();         // templates + transition matrix from cfg
     static inline int wrap12(int x) { x %= 12; return x < 0 ? x + 12 : x; }
     static inline float clamp01(float x) { return x < 0.f ? 0.f : (x > 1.f ? 1.f : x); }
-    static double nowMs() { return juce::Time::getMillisecondCounterHiRes(); }
+    // Stream time from hops analysed (deterministic, independent of processing speed)
+    double streamMs() const noexcept { return (double)hopsAnalysed * (double)hop * 1000.0 / sr; }
+    // Seconds between two analysed frames
+    double frameSec() const noexcept { return (double)hop * (double)frameStride / sr; }
 
     // config/state
     Settings cfg;
     double   sr = 44100.0;
     int      fftOrder, fftSize, hop;
 
-    // STFT
-    juce::dsp::FFT fft;
-    std::vector<float> window, overlap;
-    int overlapFill = 0;
-    std::vector<float> fftBuf;   // interleaved re/im
-    std::vector<float> magRaw, mag; // raw & compressed
+    // STFT comes from a SpectralFrontEnd (own one until attachTo is called)
+    std::unique_ptr<SpectralFrontEnd> ownFrontEnd;
+    SpectralFrontEnd* source = nullptr;   // ownFrontEnd or the attached one
+    int frameStride = 1;
+
+    // Spectral peaks (preallocated to cfg.maxPeaks). Magnitude compression
+    // m^gamma is monotonic, so peaks are picked on the linear spectrum and
+    // only peak bins (and their neighbours) are compressed.
+    struct Peak { int bin; float m; double hz; };
+    std::vector<Peak> peaks;
+    float peakThreshLin = 0.0f;  // peakRelThreshDb mapped back through gamma
 
     // HPCP
     std::array<float, 12> frameChroma{ {} };
     std::array<float, 12> chromaEMA{ {} }; // smoothed
     float tuningCentsEMA = 0.0f;
 
-    // KS profiles (normalized)
-    std::array<float, 12> profMaj{ {} };
-    std::array<float, 12> profMin{ {} };
+    // Offline: sum of per-frame chroma (each frame L2-normalised)
+    std::array<double, 12> chromaHist{ {} };
+    juce::int64 hopsAnalysed = 0;   // a strided frame counts frameStride hops
+
+    // 24 rotated, L2-normalised key templates, pitch-class major: [pc * 24 + state],
+    // so scoring is 12 multiply-adds of 24-wide rows
+    std::array<float, 12 * 24> templates{ {} };
+    // Transition scores [from * 24 + to], added to the Viterbi path per frame
+    std::array<float, 24 * 24> transitionLog{ {} };
 
     // 24 instantaneous scores (0..11 maj, 12..23 min)
     std::array<float, 24> instScore{ {} }; // ~0..1 cosine
@@ -104,7 +168,9 @@ private:
     double pendingSinceMs = 0.0;
     double lastPublishMs = 0.0;
 
-    // output
-    std::atomic<Result> lastResult{};
+    // output (seqlock: std::atomic<Result> is not lock-free on common ABIs)
+    SeqLock<Result> lastResult;
     std::function<void(const Result&)> onResult;
+
+    std::vector<float>* chromaCapture = nullptr;
 };
@@ -1,13 +1,17 @@
 #include "LiveAnalyzer.h"
+#include "Telemetry.h"
 #include <cmath>
 #include <numeric>
 
 LiveAnalyzer::LiveAnalyzer(RingBuffer& fifo,
     std::atomic<double>& sampleRateRef,
+    ResultChannel& resultChannel,
     const Settings& s)
     : settings(s),
     rb(fifo),
-    srRef(sampleRateRef)
+    srRef(sampleRateRef),
+    results(resultChannel),
+    governor(s.governor)
 {
     // Defer constructing analyzers until we know a valid sample rate in start()
 }
@@ -20,10 +24,12 @@ LiveAnalyzer::~LiveAnalyzer()
 void LiveAnalyzer::start()
 {
     if (running.exchange(true)) return;
+    streamPos.store(0, std::memory_order_relaxed);
 
     worker = std::thread([this]
         {
             juce::Thread::setCurrentThreadName("LiveAnalyzer");
+            Telemetry::ScopedThreadRecording recording;
 
             // Wait for a sane sample rate
             double sr = 0.0;
@@ -36,19 +42,7 @@ void LiveAnalyzer::start()
             if (sr < 8000.0) sr = 44100.0; // fallback
 
             // Construct analyzers at current SR
-            bpm = std::make_unique<BpmTracker>(sr);   // uses its own internal settings  
-            key = std::make_unique<KeyDetector>(sr);  // default KeyDetector::Settings  
-
-            // Key publishing directly via callback to preserve real-time feel
-            key->setCallback([this](const KeyDetector::Result& r)
-                {
-                    if (onKey && r.keyIndex >= 0)
-                        onKey(r.keyIndex, r.isMinor, r.confidence);
-                });
-
-            // Work buffers
-            constexpr int chunk = 1024;           // pop in ~20–23ms sips @ 44.1/48k
-            std::vector<float> mono((size_t)chunk);
+            buildChain(sr);
 
             const double periodMs = 1000.0 / std::max(0.5f, settings.updateHz);
             double nextUi = juce::Time::getMillisecondCounterHiRes();
@@ -60,50 +54,55 @@ void LiveAnalyzer::start()
                 if (nowSr >= 8000.0 && std::abs(nowSr - sr) > 1.0)
                 {
                     sr = nowSr;
-                    if (bpm) bpm->reset(sr);   // rebuild internals for new SR  
-                    if (key) key->reset(sr);   // retune chroma bins / EMAs     
+                    buildChain(sr);   // band/bin layout depends on SR
                     bpmEMA = 0.0;
+                    clearPublished();
                 }
 
                 // Honor reset requests (Stop Listening)
                 if (resetRequested.exchange(false))
                 {
-                    if (bpm) bpm->reset(sr);
-                    if (key) key->reset(sr);
+                    governor.reset();
+                    buildChain(sr);
                     bpmEMA = 0.0;
+                    clearPublished();
                 }
 
-                // Consume audio
-                const size_t got = rb.pop(mono.data(), (size_t)chunk); // lock-free pop  
-                if (got == 0)
-                {
-                    juce::Thread::sleep(2);
-                }
-                else
+                // Sleep until a hop's worth of audio is ready (or stop/reset wakes us),
+                // then analyse it in place from ring storage
+                const size_t hop = (size_t)std::max(1, chain ? chain->getHopSize() : 512);
+                if (rb.waitForSamples(hop, waitTimeoutMs))
                 {
-                    // Feed analyzers (mono)
-                    if (bpm) bpm->processMono(mono.data(), (int)got);   // RT-safe API  
-                    if (key) key->processMono(mono.data(), (int)got);   // RT-safe API  
+                    const auto t0 = Telemetry::nowNanos();
+                    const auto span = rb.peek(rb.capacity());
+                    if (chain)
+                    {
+                        chain->processMono(span.first, (int)span.firstSize);
+                        chain->processMono(span.second, (int)span.secondSize);
+                    }
+                    rb.consume(span.size());
+                    streamPos.fetch_add((juce::int64)span.size(), std::memory_order_relaxed);
+
+                    // Backlog found on waking + time to clear it = how far analysis trails the input
+                    const double audioSec = (double)span.size() / sr;
+                    const double busySec = 1.0e-9 * (double)(Telemetry::nowNanos() - t0);
+                    const double lagMs = 1000.0 * (audioSec + busySec);
+                    Telemetry::setGauge(Telemetry::Gauge::ringFill, (double)span.size() / (double)rb.capacity());
+                    Telemetry::setGauge(Telemetry::Gauge::analyzerLagMs, lagMs);
+
+                    // Falling behind: trade analysis detail for keeping up (and back when it eases)
+                    if (governor.update(audioSec, busySec, lagMs, rb.droppedSamples()) && chain)
+                        chain->setQualityTier(governor.getTier());
+                    Telemetry::setGauge(Telemetry::Gauge::analyzerLoad, governor.getLoad());
+                    Telemetry::setGauge(Telemetry::Gauge::qualityTier, (double)governor.getTier());
                 }
+                Telemetry::setGauge(Telemetry::Gauge::droppedSamples, (double)rb.droppedSamples());
 
                 // Publish at UI cadence
                 const double t = juce::Time::getMillisecondCounterHiRes();
                 if (t >= nextUi)
                 {
-                    if (onBpm && bpm)
-                    {
-                        const float raw = bpm->getBpm();      // stable/locked output  
-                        const float conf = bpm->getConfidence();
-
-                        if (raw > 0.0f)
-                        {
-                            if (bpmEMA <= 0.0) bpmEMA = raw;
-                            bpmEMA = settings.bpmSmoothingEMA * bpmEMA
-                                + (1.0 - settings.bpmSmoothingEMA) * (double)raw;
-
-                            onBpm(bpmEMA, (double)conf);
-                        }
-                    }
+                    publish();
                     nextUi = t + periodMs;
                 }
             }
@@ -113,15 +112,60 @@ void LiveAnalyzer::start()
 void LiveAnalyzer::stop()
 {
     if (!running.exchange(false)) return;
+    rb.wakeConsumer();
     if (worker.joinable()) worker.join();
 
-    // Drop analyzers to free FFT memory
-    bpm.reset();
-    key.reset();
+    // The analyzers stay: a restart at the same rate only resets them
     bpmEMA = 0.0;
+    clearPublished();
+}
+
+void LiveAnalyzer::buildChain(double sampleRate)
+{
+    // Same rate (restart, reset request): keep every buffer, clear the analysis state
+    if (chain && chain->getSampleRate() == sampleRate)
+        chain->reset();
+    else
+        chain = std::make_unique<AnalysisChain>(sampleRate);   // default KeyDetector::Settings
+    chain->setBeatOutput(&beatEvents, streamPos.load(std::memory_order_relaxed));
+    chain->setQualityTier(governor.getTier());
+    chain->setSilenceGate(settings.silenceGate, settings.silenceGateDb);
+}
+
+void LiveAnalyzer::publish()
+{
+    if (!chain) return;
+
+    const float raw = chain->getBpmTracker().getBpm();      // stable/locked output
+    if (raw > 0.0f)
+    {
+        if (bpmEMA <= 0.0) bpmEMA = raw;
+        bpmEMA = settings.bpmSmoothingEMA * bpmEMA
+            + (1.0 - settings.bpmSmoothingEMA) * (double)raw;
+    }
+
+    ResultChannel::Snapshot snap;
+    snap.state = ResultChannel::State::running;
+    snap.bpm = (float)bpmEMA;
+    snap.bpmConfidence = raw > 0.0f ? chain->getBpmTracker().getConfidence() : 0.0f;
+
+    const auto k = chain->getKeyDetector().getLast();
+    snap.keyIndex = k.keyIndex;
+    snap.isMinor = k.isMinor;
+    snap.keyConfidence = k.keyIndex >= 0 ? k.confidence : 0.0f;
+    snap.tuningCents = chain->getKeyDetector().getTuningCents();
+    snap.qualityTier = chain->getQualityTier();
+
+    results.publish(ResultChannel::Source::live, snap);
 }
 
 void LiveAnalyzer::requestReset()
 {
     resetRequested.store(true, std::memory_order_relaxed);
+    rb.wakeConsumer();
+}
+
+void LiveAnalyzer::clearPublished() noexcept
+{
+    results.publish(ResultChannel::Source::live, {});
 }
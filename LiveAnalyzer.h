@@ -3,10 +3,11 @@
 #include <atomic>
 #include <thread>
 #include <vector>
-#include <functional>
 #include "RingBuffer.h"
-#include "BpmTracker.h"
-#include "KeyDetector.h"
+#include "ResultChannel.h"
+#include "BeatEventQueue.h"
+#include "AnalysisChain.h"
+#include "LoadGovernor.h"
 
 //------------------------------------------------------------------------------
 class LiveAnalyzer
@@ -15,14 +16,20 @@ public:
     struct Settings
     {
         // UI cadence and BPM smoothing only (BpmTracker has its own config)
-        float updateHz = 2.0f;   // how often to publish to UI
+        float updateHz = 2.0f;   // how often to publish to the result channel
         float bpmSmoothingEMA = 0.70f;  // extra tiny EMA on displayed BPM
-    };
 
-    using BpmCallback = std::function<void(double bpm, double confidence)>;
-    using KeyCallback = std::function<void(int keyIndex, bool isMinor, double confidence)>;
+        // Frames peaking below silenceGateDb skip analysis; results hold through the gap
+        bool  silenceGate = true;
+        float silenceGateDb = -60.0f;
+
+        // Quality tiers under CPU pressure (reported in the live snapshot)
+        LoadGovernor::Settings governor;
+    };
 
-    LiveAnalyzer(RingBuffer& fifo, std::atomic<double>& sampleRateRef, const Settings& s = {});
+    // Results go to results' Source::live slot (drained by the UI timer)
+    LiveAnalyzer(RingBuffer& fifo, std::atomic<double>& sampleRateRef, ResultChannel& results,
+        const Settings& s = {});
     ~LiveAnalyzer();
 
     void start();
@@ -32,33 +39,48 @@ public:
     // Ask the worker to clear all internal state on the next loop (fresh session)
     void requestReset();
 
-    // UI hooks
-    void setBpmCallback(BpmCallback cb) { onBpm = std::move(cb); }
-    void setKeyCallback(KeyCallback cb) { onKey = std::move(cb); }
+    // Beat / downbeat events for one consumer thread; in the app that is the message
+    // thread, which drains them into MainComponent's beat indicator. samplePos counts
+    // mono device samples analysed since start(); compare with getStreamPosition().
+    BeatEventQueue& getBeatEvents() noexcept { return beatEvents; }
+    juce::int64 getStreamPosition() const noexcept { return streamPos.load(std::memory_order_relaxed); }
 
 private:
     void threadFunc();
 
+    // Upper bound on one wait, keeps SR-change checks and UI publishing alive without audio
+    static constexpr int waitTimeoutMs = 100;
+
     // config
     Settings            settings;
 
     // I/O
     RingBuffer& rb;      // mono producer → consumer FIFO (float)  
     std::atomic<double>& srRef;  // live device sample-rate
+    ResultChannel& results;
 
     // thread
     std::thread         worker;
     std::atomic<bool>   running{ false };
     std::atomic<bool>   resetRequested{ false };
 
-    // analyzers
-    std::unique_ptr<BpmTracker> bpm;   // refined tracker  
-    std::unique_ptr<KeyDetector> key;  // HPCP+Viterbi    
+    // analyzers: shared STFT front-end -> BpmTracker + KeyDetector (HPCP+Viterbi),
+    // kept across stop() / start() at the same rate
+    std::unique_ptr<AnalysisChain> chain;
+
+    // New chain at sampleRate, or the current one reset if the rate is unchanged
+    void buildChain(double sampleRate);
+
+    // quality scaling, worker thread only
+    LoadGovernor governor;
+
+    // beat output, continuous across chain rebuilds and resets
+    BeatEventQueue beatEvents;
+    std::atomic<juce::int64> streamPos{ 0 };
 
     // light UI smoothing
     double bpmEMA = 0.0;
 
-    // callbacks
-    BpmCallback         onBpm;
-    KeyCallback         onKey;
+    void publish();
+    void clearPublished() noexcept;
 };
@@ -0,0 +1,49 @@
+#include "LoadGovernor.h"
+
+LoadGovernor::LoadGovernor(const Settings& s)
+    : settings(s)
+{
+    settings.maxTier = juce::jmax(0, settings.maxTier);
+    settings.loadSmoothingSec = juce::jmax(0.01, settings.loadSmoothingSec);
+}
+
+void LoadGovernor::reset() noexcept
+{
+    tier = 0;
+    load = 0.0;
+    pressureSec = headroomSec = sinceChangeSec = 0.0;
+    primed = false;
+}
+
+bool LoadGovernor::update(double audioSec, double busySec, double lagMs, size_t droppedTotal) noexcept
+{
+    if (!settings.enabled || audioSec <= 0.0) return false;
+
+    // Drops that happened before the first pass (or a ring reset) are not ours to react to
+    const bool newDrops = primed && droppedTotal > lastDropped;
+    lastDropped = droppedTotal;
+    primed = true;
+
+    const double a = juce::jmin(1.0, audioSec / settings.loadSmoothingSec);
+    load += a * (juce::jmax(0.0, busySec) / audioSec - load);
+    sinceChangeSec += audioSec;
+
+    const bool pressure = newDrops || lagMs > settings.lagHighMs || load > settings.stepDownLoad;
+    const bool headroom = !pressure && lagMs < 0.5 * settings.lagHighMs && load < settings.stepUpLoad;
+    pressureSec = pressure ? pressureSec + audioSec : 0.0;
+    headroomSec = headroom ? headroomSec + audioSec : 0.0;
+
+    int next = tier;
+    if (tier < settings.maxTier
+        && (pressureSec >= settings.stepDownHoldSec || (newDrops && sinceChangeSec >= settings.stepDownHoldSec)))
+        ++next;
+    else if (tier > 0 && headroomSec >= settings.stepUpHoldSec)
+        --next;
+
+    if (next == tier) return false;
+
+    // Every step waits for a full hold at the new tier before the next one
+    tier = next;
+    pressureSec = headroomSec = sinceChangeSec = 0.0;
+    return true;
+}
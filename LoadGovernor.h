@@ -0,0 +1,49 @@
+#pragma once
+#include <JuceHeader.h>
+#include <cstddef>
+
+// Picks the live analysis quality tier from how hard the analyzer is working.
+// Fed once per analysis pass with the audio it consumed and the wall time that
+// took (so a CPU starved by other work reads as load too), the resulting lag and
+// the ring's cumulative drop count. Sustained load, lag or any new drop steps one
+// tier down; a long stretch of headroom steps one tier back up. Hold times count
+// audio seconds, so the decisions do not depend on how often the worker wakes.
+// Tier 0 is full quality; AnalysisChain::setQualityTier maps tiers to settings.
+class LoadGovernor
+{
+public:
+    struct Settings
+    {
+        bool   enabled = true;
+        int    maxTier = 3;
+        double stepDownLoad = 0.75;      // busy / audio time that counts as pressure
+        double stepUpLoad = 0.3;         // ... and as headroom (below half of stepDownLoad: a tier roughly halves the work)
+        double lagHighMs = 250.0;        // analysis trailing the input by more than this is pressure
+        double stepDownHoldSec = 1.0;    // pressure must last this long (drops act after it since the last change)
+        double stepUpHoldSec = 8.0;      // headroom must last this long
+        double loadSmoothingSec = 1.0;   // load EMA time constant
+    };
+
+    explicit LoadGovernor(const Settings& s = {});
+
+    // Back to tier 0, forget the load history
+    void reset() noexcept;
+
+    // One analysis pass: audioSec of input took busySec to analyse, leaving lagMs of
+    // backlog; droppedTotal is the ring's cumulative drop count. True if the tier changed.
+    bool update(double audioSec, double busySec, double lagMs, size_t droppedTotal) noexcept;
+
+    int getTier() const noexcept { return tier; }
+    // Smoothed busy / audio time (1 = analysis only just keeps up)
+    double getLoad() const noexcept { return load; }
+
+private:
+    Settings settings;
+    int    tier = 0;
+    double load = 0.0;
+    double pressureSec = 0.0, headroomSec = 0.0, sinceChangeSec = 0.0;
+    size_t lastDropped = 0;
+    bool   primed = false;   // lastDropped holds a real count
+
+    JUCE_DECLARE_NON_COPYABLE(LoadGovernor)
+};
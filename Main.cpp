@@ -1,3 +1,8 @@
+// GUI app entry. The console tools bring their own main() and are built with
+// CANONKEY_BUILD_CLI=1 (CliMain.cpp) or CANONKEY_BUILD_BENCH=1 (BenchMain.cpp),
+// which leave this file empty.
+#if !CANONKEY_BUILD_CLI && !CANONKEY_BUILD_BENCH
+
 #include <JuceHeader.h>
 #include "MainComponent.h"
 
@@ -52,3 +57,5 @@ private:
 };
 
 START_JUCE_APPLICATION(CanonkeyApplication)
+
+#endif
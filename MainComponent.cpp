@@ -4,9 +4,35 @@
 #include <cmath>
 #include <cstdint> // int64_t
 
-#include "BpmTracker.h"
-#include "KeyDetector.h"
+#include "FileAnalysis.h"
+#include "SimdKernels.h"
+#include "Telemetry.h"
 
+namespace
+{
+    constexpr int uiHz = 20, reducedUiHz = 5;
+    constexpr int meterHz = 60, reducedMeterHz = 20;
+
+    // Decks mode: at most four channel groups; menu ids above the base pick a device for it
+    constexpr int maxDecks = 4;
+    constexpr int deckMenuIdBase = 10000;       // stereo-pair decks
+    constexpr int monoDeckMenuIdBase = 20000;   // one deck per input
+
+    ResultChannel::Snapshot snapshotOf(const FileAnalysis::Result& r)
+    {
+        ResultChannel::Snapshot s;
+        s.state = r.ok ? ResultChannel::State::done
+                       : (r.cancelled ? ResultChannel::State::cancelled : ResultChannel::State::failed);
+        s.bpm = r.bpm;
+        s.bpmConfidence = r.bpmConfidence;
+        s.keyIndex = r.keyIndex;
+        s.isMinor = r.isMinor;
+        s.keyConfidence = r.keyConfidence;
+        s.tuningCents = r.tuningCents;
+        s.progress = 1.0f;
+        return s;
+    }
+}
 
 // Offline File Analyzer
 class MainComponent::FileAnalyzerThread : public juce::Thread
@@ -18,86 +44,34 @@ public:
     void run() override
     {
         owner.fileAnalyzing.store(true);
-        owner.fileProgress.store(0.0f);
-
-        juce::AudioFormatManager fm; fm.registerBasicFormats();
-        std::unique_ptr<juce::AudioFormatReader> reader(fm.createReaderFor(file));
-        if (!reader)
-        {
-            postError("Unsupported or unreadable audio file.");
-            owner.fileAnalyzing.store(false);
-            return;
-        }
-
-        const double sr = reader->sampleRate > 8000.0 ? reader->sampleRate : 44100.0;
-        BpmTracker bpm((double)sr);
-        KeyDetector kd((double)sr);
 
-        const int64_t total = static_cast<int64_t>(reader->lengthInSamples);
-        const int     block = 32768; // ~0.74s @ 44.1k per read
-        juce::AudioBuffer<float> buf((int)std::min<int>(reader->numChannels, 2), block);
-        std::vector<float> mono((size_t)block, 0.0f);
+        ResultChannel::Snapshot running;
+        running.state = ResultChannel::State::running;
+        owner.results.publish(ResultChannel::Source::file, running);
 
-        int64_t pos = 0;
-        while (!threadShouldExit() && pos < total)
-        {
-            const int toRead = (int)std::min<int64_t>((int64_t)block, total - pos);
-            if (!reader->read(&buf, 0, toRead, pos, true, true))
+        // Long mixes are split into segments across all cores; short files run linearly.
+        // Progress only overwrites the channel slot; the UI timer picks it up at its own rate.
+        const auto res = owner.analysisCache.getOrAnalyze(file, [this]
             {
-                postError("Read failed during decoding.");
-                owner.fileAnalyzing.store(false);
-                return;
-            }
-
-            const int numCh = buf.getNumChannels();
-            const float* L = buf.getReadPointer(0);
-            const float* R = (numCh > 1 ? buf.getReadPointer(1) : L);
-
-            for (int i = 0; i < toRead; ++i)
-                mono[(size_t)i] = 0.5f * (L[i] + R[i]);
-
-            bpm.processMono(mono.data(), toRead);
-            kd.processMono(mono.data(), toRead);
-
-            pos += toRead;
-            owner.fileProgress.store((float)((double)pos / (double)total));
-
-            juce::MessageManager::callAsync([this]
-                {
-                    owner.dropZone.setText("Analyzing: " + owner.currentFile.getFileName()
-                        + juce::String::formatted("  (%.0f%%)", owner.fileProgress.load() * 100.0f),
-                        juce::dontSendNotification);
-                    owner.fileResultBpm.setText("Analyzing…", juce::dontSendNotification);
-                    owner.fileResultKey.setText("-", juce::dontSendNotification);
-                });
-        }
+                return FileAnalysis::analyzeFileSegmented(file, {},
+                    [this] { return threadShouldExit(); },
+                    [this](float progress)
+                    {
+                        owner.results.update(ResultChannel::Source::file,
+                            [progress](ResultChannel::Snapshot& s) { s.progress = progress; });
+                    });
+            });
 
-        if (threadShouldExit())
+        if (res.cancelled || threadShouldExit())
         {
             owner.fileAnalyzing.store(false);
             return;
         }
 
-        const float outBpm = bpm.getBpm();
-        const auto  keyRes = kd.getLast();
-
-        juce::MessageManager::callAsync([this, outBpm, keyRes]
-            {
-                if (threadShouldExit()) return;
-
-                if (outBpm > 0.0f)
-                    owner.fileResultBpm.setText(juce::String((int)std::round(outBpm)) + " BPM", juce::dontSendNotification);
-                else
-                    owner.fileResultBpm.setText("BPM -", juce::dontSendNotification);
-
-                if (keyRes.keyIndex >= 0)
-                    owner.fileResultKey.setText(owner.keyIndexToString(keyRes.keyIndex, keyRes.isMinor),
-                        juce::dontSendNotification);
-                else
-                    owner.fileResultKey.setText("Key -", juce::dontSendNotification);
+        owner.results.publish(ResultChannel::Source::file, snapshotOf(res));
 
-                owner.dropZone.setText("Drop audio file", juce::dontSendNotification);
-            });
+        if (!res.ok)
+            postError(res.error);
 
         owner.fileAnalyzing.store(false);
     }
@@ -106,6 +80,7 @@ public:
     {
         juce::MessageManager::callAsync([this, msg]
             {
+                owner.forgetShownValues();
                 owner.dropZone.setText("Error: " + msg, juce::dontSendNotification);
                 owner.fileResultBpm.setText("BPM -", juce::dontSendNotification);
                 owner.fileResultKey.setText("Key -", juce::dontSendNotification);
@@ -135,8 +110,23 @@ MainComponent::MainComponent()
 
             if (analyzer) analyzer->requestReset();
 
-            juce::MessageManager::callAsync([this]
+            juce::MessageManager::callAsync([this, sr]
                 {
+                    // Deck chains are built for one rate: reopen the device at the new one
+                    if (decksActive.load() && sr > 0.0 && sr != decks->getSampleRate())
+                    {
+                        juce::String err;
+                        if (!startDecks(decksDevice, decksChannelsPerDeck, err))
+                        {
+                            audio->stop();
+                            listening = false;
+                            startListeningButton.setButtonText("Start Listening");
+                            liveMeter.setLevels(0.0f, 0.0f);
+                            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Decks",
+                                err.isEmpty() ? "Failed to restart the decks." : err);
+                        }
+                    }
+
                     if (listening)
                     {
                         liveResultBpm.setText("Listening...", juce::dontSendNotification);
@@ -148,9 +138,6 @@ MainComponent::MainComponent()
                         liveResultKey.setText("-", juce::dontSendNotification);
                     }
                 });
-
-            bpm = std::make_unique<BpmTracker>(sr);
-            keydet = std::make_unique<KeyDetector>(sr);
         };
 
     audio->onAudioBlock = [this](const float* const* input, int numCh, int numSamples, double sr)
@@ -159,69 +146,64 @@ MainComponent::MainComponent()
 
             if (numCh <= 0 || numSamples <= 0 || input == nullptr) return;
 
-            monoFifo.pushPlanarToMono(input, numCh, numSamples);
-
-            float l = 0.0f, r = 0.0f;
-            if (numCh == 1)
+            if (decksActive.load(std::memory_order_acquire))
             {
-                const float* ch = input[0];
-                for (int i = 0; i < numSamples; ++i)
-                    l = juce::jmax(l, std::abs(ch[i]));
-                r = l;
+                decks->pushBlock(input, numCh, numSamples);
             }
             else
             {
-                const float* ch0 = input[0];
-                const float* ch1 = input[1];
-                for (int i = 0; i < numSamples; ++i)
-                {
-                    l = juce::jmax(l, std::abs(ch0[i]));
-                    r = juce::jmax(r, std::abs(ch1[i]));
-                }
+                Telemetry::ScopedStage timer(Telemetry::Stage::downmixPush);
+                monoFifo.pushPlanarToMono(input, numCh, numSamples);
             }
 
+            float l = SimdKernels::absMaxValue(input[0], numSamples);
+            float r = numCh > 1 ? SimdKernels::absMaxValue(input[1], numSamples) : l;
+
             l = juce::jmin(l, 1.0f);
             r = juce::jmin(r, 1.0f);
             liveMeter.setLevels(l, r);
 
-            static std::vector<float> monoScratch;
-            monoScratch.resize((size_t)numSamples);
+            // All BPM/Key DSP runs on the LiveAnalyzer thread; the label is refreshed by the timer
+            ++liveBlockCounter;
+        };
 
-            const float* L = input[0];
-            const float* R = (numCh > 1 ? input[1] : input[0]);
-            for (int i = 0; i < numSamples; ++i)
-                monoScratch[(size_t)i] = 0.5f * (L[i] + R[i]);
+    // Native loopback packets: one downmix pass straight into the ring, any channel count
+    audio->onInterleavedBlock = [this](const void* frames, SimdKernels::SampleFormat format, int numCh, int numFrames, double sr)
+        {
+            currentSampleRate.store(sr, std::memory_order_relaxed);
 
-            if (bpm)    bpm->processMono(monoScratch.data(), numSamples);
-            if (keydet) keydet->processMono(monoScratch.data(), numSamples);
+            if (numCh <= 0 || numFrames <= 0) return;
 
-            auto n = ++liveBlockCounter;
-            if ((n % 30) == 0)
-                juce::MessageManager::callAsync([this, n]
-                    {
-                        liveFrames.setText(juce::String(n) + " blocks", juce::dontSendNotification);
-                    });
+            float l = 0.0f, r = 0.0f;
+            if (frames == nullptr)
+            {
+                monoFifo.pushSilence(numFrames);
+            }
+            else
+            {
+                {
+                    Telemetry::ScopedStage timer(Telemetry::Stage::downmixPush);
+                    monoFifo.pushInterleavedToMono(frames, format, numCh, numFrames);
+                }
+                l = juce::jmin(SimdKernels::absMaxInterleaved(frames, format, numCh, 0, numFrames), 1.0f);
+                r = numCh > 1 ? juce::jmin(SimdKernels::absMaxInterleaved(frames, format, numCh, 1, numFrames), 1.0f) : l;
+            }
+            liveMeter.setLevels(l, r);
+
+            ++liveBlockCounter;
         };
 
-    // UI update timer
-    startTimerHz(20);
+    // UI update timer (and meter rate)
+    setReducedRefresh(juce::SystemStats::getEnvironmentVariable("CANONKEY_REDUCED_REFRESH", {}) == "1");
 
-    // Analyzer thread for legacy live callbacks (optional)
-    analyzer = std::make_unique<LiveAnalyzer>(monoFifo, currentSampleRate);
-    analyzer->setBpmCallback([this](double bpmVal, double /*conf*/)
-        {
-            juce::MessageManager::callAsync([this, bpmVal]
-                {
-                    liveResultBpm.setText(juce::String((int)std::round(bpmVal)) + " BPM", juce::dontSendNotification);
-                });
-        });
-    analyzer->setKeyCallback([this](int keyIndex, bool isMinor, double /*conf*/)
-        {
-            juce::MessageManager::callAsync([this, keyIndex, isMinor]
-                {
-                    liveResultKey.setText(keyIndexToString(keyIndex, isMinor), juce::dontSendNotification);
-                });
-        });
+    // Diagnostics: overlay hidden until toggled; optional JSON file for monitoring to scrape
+    addChildComponent(telemetryOverlay);
+    const auto telemetryPath = juce::SystemStats::getEnvironmentVariable("CANONKEY_TELEMETRY_JSON", {});
+    if (juce::File::isAbsolutePath(telemetryPath))
+        telemetryFile = juce::File(telemetryPath);
+
+    // Single live analysis pipeline (owns the only BpmTracker/KeyDetector pair)
+    analyzer = std::make_unique<LiveAnalyzer>(monoFifo, currentSampleRate, results);
 
     // ----- Live card -----
     liveTitle.setText("Live Analysis", juce::dontSendNotification);
@@ -240,6 +222,11 @@ MainComponent::MainComponent()
     liveFrames.setJustificationType(juce::Justification::centredRight);
     addAndMakeVisible(liveFrames);
 
+    beatIndicator.setFont(juce::Font(16.0f));
+    beatIndicator.setColour(juce::Label::textColourId, CanonkeyTheme::subtitle());
+    beatIndicator.setJustificationType(juce::Justification::centredRight);
+    addAndMakeVisible(beatIndicator);
+
     startListeningButton.setColour(juce::TextButton::buttonColourId, CanonkeyTheme::accent());
     startListeningButton.setColour(juce::TextButton::textColourOnId, juce::Colours::white);
     startListeningButton.setColour(juce::TextButton::textColourOffId, juce::Colours::white);
@@ -253,19 +240,19 @@ MainComponent::MainComponent()
                     listening = true;
                     startListeningButton.setButtonText("Stop Listening");
                     liveBlockCounter.store(0);
+                    forgetShownValues();
                     liveFrames.setText("0 blocks", juce::dontSendNotification);
+                    Telemetry::reset();
                     currentSource.setText(audio->getCurrentDeviceInfo().inputName, juce::dontSendNotification);
 
                     if (analyzer)
                     {
                         analyzer->requestReset();
+                        analyzer->getBeatEvents().clear();
                         if (!analyzer->isRunning())
                             analyzer->start();
                     }
 
-                    if (bpm)    bpm->reset();
-                    if (keydet) keydet->reset();
-
                     liveResultBpm.setText("Listening...", juce::dontSendNotification);
                     liveResultKey.setText("-", juce::dontSendNotification);
                 }
@@ -280,6 +267,7 @@ MainComponent::MainComponent()
             else
             {
                 audio->stop();
+                stopDecks();
                 listening = false;
                 startListeningButton.setButtonText("Start Listening");
 
@@ -289,9 +277,6 @@ MainComponent::MainComponent()
                     analyzer->stop();
                 }
 
-                if (bpm)    bpm->reset();
-                if (keydet) keydet->reset();
-
                 liveMeter.setLevels(0.0f, 0.0f);
                 liveResultBpm.setText("-", juce::dontSendNotification);
                 liveResultKey.setText("-", juce::dontSendNotification);
@@ -304,7 +289,7 @@ MainComponent::MainComponent()
         {
             auto devices = audio->enumerateDevices();
 
-            juce::PopupMenu root, outputsMenu, inputsMenu;
+            juce::PopupMenu root, outputsMenu, inputsMenu, decksMenu, monoDecksMenu;
 
             int itemId = 1;
             struct Item { int id; AudioEngine::DeviceEntry entry; };
@@ -317,7 +302,12 @@ MainComponent::MainComponent()
                     label = "[ASIO] " + label;
 
                 if (d.isLoopback) outputsMenu.addItem(itemId, label);
-                else              inputsMenu.addItem(itemId, label);
+                else
+                {
+                    inputsMenu.addItem(itemId, label);
+                    decksMenu.addItem(deckMenuIdBase + itemId, label);
+                    monoDecksMenu.addItem(monoDeckMenuIdBase + itemId, label);
+                }
 
                 idMap.add({ itemId, d });
                 ++itemId;
@@ -327,38 +317,62 @@ MainComponent::MainComponent()
                 outputsMenu.addItem(9001, "(no loopback devices)", false, false);
             if (inputsMenu.getNumItems() == 0)
                 inputsMenu.addItem(9002, "(no inputs)", false, false);
+            if (decksMenu.getNumItems() == 0)
+                decksMenu.addItem(9003, "(no inputs)", false, false);
+            if (monoDecksMenu.getNumItems() == 0)
+                monoDecksMenu.addItem(9004, "(no inputs)", false, false);
 
             root.addSubMenu("Outputs (Loopback)", outputsMenu);
             root.addSubMenu("Inputs", inputsMenu);
+            root.addSubMenu("Decks (stereo pairs)", decksMenu);
+            root.addSubMenu("Decks (one per input)", monoDecksMenu);
 
             root.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(audioSourceButton),
                 [this, idMap](int chosenId)
                 {
                     if (chosenId <= 0) return;
 
+                    const bool asMonoDecks = chosenId > monoDeckMenuIdBase;
+                    const bool asDecks = asMonoDecks || chosenId > deckMenuIdBase;
+                    const int deviceId = asMonoDecks ? chosenId - monoDeckMenuIdBase
+                                       : asDecks     ? chosenId - deckMenuIdBase : chosenId;
+
                     for (auto& it : idMap)
                     {
-                        if (it.id == chosenId)
+                        if (it.id == deviceId)
                         {
                             juce::String err;
-                            if (audio->startWithDevice(it.entry, err))
+                            bool ok = false;
+                            if (asDecks)
+                            {
+                                ok = startDecks(it.entry, asMonoDecks ? 1 : 2, err);
+                            }
+                            else
+                            {
+                                stopDecks();
+                                ok = audio->startWithDevice(it.entry, err);
+                            }
+
+                            if (ok)
                             {
                                 listening = true;
                                 startListeningButton.setButtonText("Stop Listening");
-                                currentSource.setText(it.entry.name, juce::dontSendNotification);
+                                currentSource.setText(asDecks ? it.entry.name + "  |  " + juce::String(decks->getNumStreams()) + " decks"
+                                                              : it.entry.name,
+                                    juce::dontSendNotification);
                                 liveBlockCounter.store(0);
+                                forgetShownValues();
                                 liveFrames.setText("0 blocks", juce::dontSendNotification);
+                                Telemetry::reset();
 
-                                if (analyzer)
+                                if (analyzer && !asDecks)
                                 {
                                     analyzer->requestReset();
+                                    analyzer->getBeatEvents().clear();
                                     if (!analyzer->isRunning())
                                         analyzer->start();
                                 }
 
-                                if (bpm)    bpm->reset();
-                                if (keydet) keydet->reset();
-
                                 liveResultBpm.setText("Listening...", juce::dontSendNotification);
                                 liveResultKey.setText("-", juce::dontSendNotification);
                             }
@@ -380,6 +394,12 @@ MainComponent::MainComponent()
     currentSource.setJustificationType(juce::Justification::centredLeft);
     addAndMakeVisible(currentSource);
 
+    // Shown only in decks mode
+    decksInfo.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain));
+    decksInfo.setColour(juce::Label::textColourId, CanonkeyTheme::title());
+    decksInfo.setJustificationType(juce::Justification::topLeft);
+    addChildComponent(decksInfo);
+
     // Live results placeholders
     for (auto* l : { &liveResultBpm, &liveResultKey })
     {
@@ -412,25 +432,29 @@ MainComponent::MainComponent()
     // --- Browse (keep chooser alive while dialog is open) ---
     browseButton.onClick = [this]
         {
-            if (fileAnalyzing.load())
+            if (fileAnalyzing.load() || (batch && batch->isRunning()))
                 cancelFileAnalysis();
 
             fileChooser = std::make_unique<juce::FileChooser>(
-                "Select an audio file",
+                "Select audio files or a folder",
                 juce::File(),
-                "*.wav;*.mp3;*.aiff;*.aif;*.flac;*.ogg;*.m4a");
+                FileAnalysis::getSupportedWildcard());
 
             auto flags = juce::FileBrowserComponent::openMode
-                | juce::FileBrowserComponent::canSelectFiles;
+                | juce::FileBrowserComponent::canSelectFiles
+                | juce::FileBrowserComponent::canSelectDirectories
+                | juce::FileBrowserComponent::canSelectMultipleItems;
 
             fileChooser->launchAsync(flags,
                 [this](const juce::FileChooser& fc)
                 {
-                    auto f = fc.getResult();
+                    auto results = fc.getResults();
                     fileChooser.reset(); // dialog is closed
 
-                    if (f.existsAsFile())
-                        beginFileAnalysis(f);
+                    if (results.size() == 1 && results[0].existsAsFile())
+                        beginFileAnalysis(results[0]);
+                    else if (!results.isEmpty())
+                        beginBatchAnalysis(results);
                 });
         };
     addAndMakeVisible(browseButton);
@@ -453,14 +477,22 @@ MainComponent::MainComponent()
 MainComponent::~MainComponent()
 {
     cancelFileAnalysis(); // ensure any worker is stopped before destruction
+
+    // Close the device before the rings and analyzers its callback feeds go away
+    audio->onSampleRateChanged = nullptr;
+    audio->stop();
+    stopDecks();
 }
 
 // ============ Layout / Paint ============
 void MainComponent::paint(juce::Graphics& g)
 {
-    g.fillAll(CanonkeyTheme::bg());
-    drawCard(g, liveCardBounds);
-    drawCard(g, fileCardBounds);
+    // Labels and the meter repaint small regions many times a second; the static
+    // backdrop behind them is a blit instead of path fills and strokes
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (!background.isValid() || scale != backgroundScale)
+        renderBackground(scale);
+    g.drawImage(background, getLocalBounds().toFloat());
 
     // Optional subtle outline when dragging over window
     if (isDragOver)
@@ -470,8 +502,24 @@ void MainComponent::paint(juce::Graphics& g)
     }
 }
 
+void MainComponent::renderBackground(float scale)
+{
+    backgroundScale = scale;
+    background = juce::Image(juce::Image::RGB,
+        juce::jmax(1, juce::roundToInt((float)getWidth() * scale)),
+        juce::jmax(1, juce::roundToInt((float)getHeight() * scale)), false);
+
+    juce::Graphics g(background);
+    g.addTransform(juce::AffineTransform::scale(scale));
+    g.fillAll(CanonkeyTheme::bg());
+    drawCard(g, liveCardBounds);
+    drawCard(g, fileCardBounds);
+}
+
 void MainComponent::resized()
 {
+    background = {};   // re-rendered at the new size on the next paint
+
     auto area = getLocalBounds().toFloat().reduced((float)CanonkeyTheme::outerPad);
 
     const auto halfHeight = (area.getHeight() - CanonkeyTheme::cardGap) * 0.5f;
@@ -483,9 +531,12 @@ void MainComponent::resized()
     auto live = liveCardBounds.reduced(20.0f);
     auto liveTop = live.removeFromTop(36.0f);
     liveTitle.setBounds(liveTop.removeFromLeft(220.0f).toNearestInt());
+    beatIndicator.setBounds(liveTop.removeFromRight(120.0f).toNearestInt());
     liveSubtitle.setBounds(liveTop.toNearestInt());
 
     auto meterArea = live.removeFromTop(120.0f);
+    if (decksInfo.isVisible())
+        decksInfo.setBounds(meterArea.removeFromRight(meterArea.getWidth() * 0.5f).toNearestInt().reduced(6));
     liveMeter.setBounds(meterArea.toNearestInt().reduced(6));
 
     auto framesBox = meterArea.removeFromTop(20.0f).removeFromRight(140.0f);
@@ -516,6 +567,32 @@ void MainComponent::resized()
     fileResultKey.setBounds(fileBadges.toNearestInt().reduced(6));
 
     dropZone.setBounds(file.toNearestInt().reduced(4));
+
+    telemetryOverlay.setBounds(getLocalBounds().removeFromTop(TelemetryOverlay::getPreferredHeight() + 16)
+        .removeFromRight(500).reduced(8));
+}
+
+bool MainComponent::keyPressed(const juce::KeyPress& key)
+{
+    if (key == juce::KeyPress('d', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0))
+    {
+        telemetryOverlay.setVisible(!telemetryOverlay.isVisible());
+        telemetryOverlay.toFront(false);
+        return true;
+    }
+    if (key == juce::KeyPress('r', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0))
+    {
+        setReducedRefresh(!reducedRefresh);
+        return true;
+    }
+    return false;
+}
+
+void MainComponent::setReducedRefresh(bool shouldReduce)
+{
+    reducedRefresh = shouldReduce;
+    startTimerHz(reducedRefresh ? reducedUiHz : uiHz);
+    liveMeter.setRefreshRate(reducedRefresh ? reducedMeterHz : meterHz);
 }
 
 // ============ OS File Drag & Drop ============
@@ -525,11 +602,11 @@ bool MainComponent::isInterestedInFileDrag(const juce::StringArray& files)
         return true;
 
     for (auto& f : files)
-        if (f.endsWithIgnoreCase(".wav") || f.endsWithIgnoreCase(".mp3") ||
-            f.endsWithIgnoreCase(".aiff") || f.endsWithIgnoreCase(".aif") ||
-            f.endsWithIgnoreCase(".flac") || f.endsWithIgnoreCase(".ogg") ||
-            f.endsWithIgnoreCase(".m4a"))
+    {
+        const juce::File file(f);
+        if (file.isDirectory() || FileAnalysis::isSupportedAudioFile(file))
             return true;
+    }
 
     return false;
 }
@@ -539,6 +616,7 @@ void MainComponent::fileDragEnter(const juce::StringArray& files, int, int)
     if (isInterestedInFileDrag(files))
     {
         isDragOver = true;
+        forgetShownValues();
         dropZone.setColour(juce::Label::backgroundColourId, CanonkeyTheme::dropZoneActive());
         dropZone.setText("Release to analyze…", juce::dontSendNotification);
         repaint();
@@ -554,6 +632,7 @@ void MainComponent::fileDragMove(const juce::StringArray& files, int, int)
 void MainComponent::fileDragExit(const juce::StringArray&)
 {
     isDragOver = false;
+    forgetShownValues();
     dropZone.setColour(juce::Label::backgroundColourId, CanonkeyTheme::dropZone().withAlpha(0.6f));
     dropZone.setText("Drop audio file", juce::dontSendNotification);
     repaint();
@@ -566,9 +645,115 @@ void MainComponent::filesDropped(const juce::StringArray& files, int, int)
     repaint();
 
     if (files.isEmpty()) return;
-    juce::File f(files[0]);
-    if (f.existsAsFile())
-        beginFileAnalysis(f);
+
+    juce::Array<juce::File> inputs;
+    for (auto& f : files)
+        inputs.add(juce::File(f));
+
+    // One file -> single analysis; folders or several files -> batch pool
+    if (inputs.size() == 1 && inputs[0].existsAsFile())
+        beginFileAnalysis(inputs[0]);
+    else
+        beginBatchAnalysis(inputs);
+}
+
+// ============ Decks Mode ============
+bool MainComponent::startDecks(const AudioEngine::DeviceEntry& entry, int channelsPerDeck, juce::String& error)
+{
+    stopDecks();
+    if (analyzer)
+    {
+        analyzer->requestReset();
+        analyzer->stop();
+    }
+
+    // Open every input (up to the deck limit), not the default pair
+    if (!audio->startWithDevice(entry, error, 2 * maxDecks))
+        return false;
+
+    // The callback keeps feeding monoFifo until decksActive is set below
+    const auto info = audio->getCurrentDeviceInfo();
+    if (!decks) decks = std::make_unique<MultiStreamAnalyzer>();
+    decks->setStreams(MultiStreamAnalyzer::makeDeckLayout(info.numIn, channelsPerDeck, maxDecks));
+    if (!decks->start(info.sampleRate, info.numIn))
+    {
+        audio->stop();
+        error = info.numIn > 0 ? "Could not start deck analysis on " + entry.name + "."
+                               : entry.name + " opened without input channels.";
+        return false;
+    }
+
+    decksDevice = entry;
+    decksChannelsPerDeck = channelsPerDeck;
+    decksActive.store(true, std::memory_order_release);
+    forgetShownValues();
+    decksInfo.setVisible(true);
+    resized();
+    return true;
+}
+
+void MainComponent::stopDecks()
+{
+    // The callback falls back to monoFifo; the rings stay alive until the next setStreams,
+    // which only runs with the device reopened
+    decksActive.store(false, std::memory_order_release);
+    if (decks) decks->stop();
+
+    if (decksInfo.isVisible())
+    {
+        decksInfo.setVisible(false);
+        resized();
+    }
+}
+
+void MainComponent::updateDecksInfo()
+{
+    juce::String text = juce::String::formatted("%d decks, %.1f%% of one core",
+        decks->getNumStreams(), 100.0 * decks->getTotalLoad());
+
+    for (int i = 0; i < decks->getNumStreams(); ++i)
+    {
+        const auto r = decks->getResult(i);
+        const auto st = decks->getStats(i);
+        text << "\n" << decks->getStreamName(i).paddedRight(' ', 16)
+             << (r.bpm > 0.0f ? juce::String((int)std::round(r.bpm)) + " BPM" : juce::String("BPM -")).paddedLeft(' ', 8)
+             << "  " << keyIndexToString(r.keyIndex, r.isMinor).paddedRight(' ', 6)
+             << juce::String::formatted("  load %4.1f%%  dropped %lld", 100.0 * st.load(), (long long)st.droppedSamples);
+    }
+
+    if (text != shown.decks)
+    {
+        shown.decks = text;
+        decksInfo.setText(text, juce::dontSendNotification);
+    }
+}
+
+void MainComponent::showBeats()
+{
+    // Drain every pending event so the queue never fills; only the newest is drawn
+    BeatEvent pending[16];
+    int beatInBar = shown.beatInBar;
+    const double nowMs = juce::Time::getMillisecondCounterHiRes();
+    for (int n = 0; (n = analyzer->getBeatEvents().pop(pending, 16)) > 0;)
+    {
+        beatInBar = pending[n - 1].beatInBar;
+        lastBeatMs = nowMs;
+        if (n < 16) break;
+    }
+    if (nowMs - lastBeatMs > 2000.0)
+        beatInBar = -1;   // no beat for a while: the grid is lost
+
+    if (beatInBar == shown.beatInBar)
+        return;
+    shown.beatInBar = beatInBar;
+
+    // One dot per beat of a 4/4 bar, the current one filled; accent on the downbeat
+    juce::String dots;
+    for (int i = 0; i < 4; ++i)
+        dots << juce::String::charToString(i == beatInBar ? (juce::juce_wchar)0x25cf : (juce::juce_wchar)0x25cb) << " ";
+    beatIndicator.setText(beatInBar >= 0 ? dots.trimEnd() : juce::String(), juce::dontSendNotification);
+    beatIndicator.setColour(juce::Label::textColourId,
+        beatInBar == 0 ? CanonkeyTheme::accent() : CanonkeyTheme::subtitle());
 }
 
 // ============ Analysis Control ============
@@ -577,8 +762,8 @@ void MainComponent::beginFileAnalysis(const juce::File& f)
     cancelFileAnalysis();
 
     fileAnalyzing.store(false);
-    fileProgress.store(0.0f);
     currentFile = f;
+    forgetShownValues();
 
     fileResultBpm.setText("Analyzing…", juce::dontSendNotification);
     fileResultKey.setText("-", juce::dontSendNotification);
@@ -589,6 +774,65 @@ void MainComponent::beginFileAnalysis(const juce::File& f)
     cancelButton.setEnabled(true);
 }
 
+void MainComponent::beginBatchAnalysis(const juce::Array<juce::File>& inputs)
+{
+    cancelFileAnalysis();
+
+    auto files = BatchAnalyzer::collectAudioFiles(inputs);
+    if (files.isEmpty())
+    {
+        dropZone.setText("No supported audio files found", juce::dontSendNotification);
+        return;
+    }
+
+    if (!batch)
+    {
+        batch = std::make_unique<BatchAnalyzer>();
+        batch->setCache(&analysisCache);
+    }
+
+    ResultChannel::Snapshot running;
+    running.state = ResultChannel::State::running;
+    running.total = files.size();
+    results.publish(ResultChannel::Source::batch, running);
+    batchWasRunning = true;
+
+    fileResultBpm.setText("Analyzing…", juce::dontSendNotification);
+    fileResultKey.setText("-", juce::dontSendNotification);
+    dropZone.setText("Batch: 0/" + juce::String(files.size()) + " files", juce::dontSendNotification);
+
+    // Per-file results arrive on pool threads; the batch slot keeps the latest good one
+    batch->start(files, [this](const FileAnalysis::Result& r)
+        {
+            results.update(ResultChannel::Source::batch, [&r](ResultChannel::Snapshot& s)
+                {
+                    ++s.completed;
+                    if (!r.ok) return;
+
+                    const auto latest = snapshotOf(r);
+                    s.bpm = latest.bpm;
+                    s.bpmConfidence = latest.bpmConfidence;
+                    s.keyIndex = latest.keyIndex;
+                    s.isMinor = latest.isMinor;
+                    s.keyConfidence = latest.keyConfidence;
+                });
+        });
+    cancelButton.setEnabled(true);
+}
+
+void MainComponent::showFileResult(const ResultChannel::Snapshot& r)
+{
+    if (r.bpm > 0.0f)
+        fileResultBpm.setText(juce::String((int)std::round(r.bpm)) + " BPM", juce::dontSendNotification);
+    else
+        fileResultBpm.setText("BPM -", juce::dontSendNotification);
+
+    if (r.keyIndex >= 0)
+        fileResultKey.setText(keyIndexToString(r.keyIndex, r.isMinor), juce::dontSendNotification);
+    else
+        fileResultKey.setText("Key -", juce::dontSendNotification);
+}
+
 void MainComponent::cancelFileAnalysis()
 {
     if (fileWorker)
@@ -597,8 +841,16 @@ void MainComponent::cancelFileAnalysis()
         fileWorker->stopThread(2000);
         fileWorker.reset();
     }
+    if (batch)
+        batch->cancel();
+    batchWasRunning = false;
+
     fileAnalyzing.store(false);
-    fileProgress.store(0.0f);
+    forgetShownValues();
+    ResultChannel::Snapshot cancelled;
+    cancelled.state = ResultChannel::State::cancelled;
+    results.publish(ResultChannel::Source::file, cancelled);
+    results.publish(ResultChannel::Source::batch, cancelled);
 
     dropZone.setText("Drop audio file", juce::dontSendNotification);
     fileResultBpm.setText("BPM -", juce::dontSendNotification);
@@ -629,29 +881,88 @@ void MainComponent::drawCard(juce::Graphics& g, const juce::Rectangle<float>& bo
 // Debug + UI updater: also refreshes BPM/Key labels
 void MainComponent::timerCallback()
 {
-    if (bpm)
+    ResultChannel::Snapshot snap;
+
+    if (results.take(ResultChannel::Source::live, snap))
     {
-        const float b = bpm->getBpm();
-        if (b > 0.0f)
-            liveResultBpm.setText(juce::String((int)std::round(b)) + " BPM", juce::dontSendNotification);
+        if (snap.bpm > 0.0f)
+            liveResultBpm.setText(juce::String((int)std::round(snap.bpm)) + " BPM", juce::dontSendNotification);
         else if (listening)
             liveResultBpm.setText("Listening...", juce::dontSendNotification);
+
+        if (snap.keyIndex >= 0)
+            liveResultKey.setText(keyIndexToString(snap.keyIndex, snap.isMinor), juce::dontSendNotification);
+    }
+
+    if (listening)
+    {
+        // Under CPU pressure the live analysis runs at reduced quality: say so next to the counter
+        const uint64_t blocks = liveBlockCounter.load();
+        const int tier = results.latest(ResultChannel::Source::live).qualityTier;
+        if (blocks != shown.blocks || tier != shown.tier)
+        {
+            shown.blocks = blocks;
+            shown.tier = tier;
+            liveFrames.setText(juce::String(blocks) + " blocks"
+                + (tier > 0 ? "  |  reduced quality " + juce::String(tier) : juce::String()),
+                juce::dontSendNotification);
+        }
+        Telemetry::setGauge(Telemetry::Gauge::xruns, (double)audio->getXRunCount());
+
+        if (decksActive.load())
+            updateDecksInfo();
+        else if (analyzer)
+            showBeats();
     }
 
-    if (keydet)
+    const double nowMs = juce::Time::getMillisecondCounterHiRes();
+    if (telemetryFile != juce::File() && nowMs >= nextTelemetryWriteMs)
     {
-        auto r = keydet->getLast();
-        if (r.keyIndex >= 0)
-            liveResultKey.setText(keyIndexToString(r.keyIndex, r.isMinor), juce::dontSendNotification);
+        Telemetry::writeJson(telemetryFile);
+        nextTelemetryWriteMs = nowMs + 1000.0;
     }
 
     const bool analyzing = fileAnalyzing.load();
-    if (analyzing)
+    if (results.take(ResultChannel::Source::file, snap))
     {
-        const float p = fileProgress.load();
-        dropZone.setText("Analyzing: " + currentFile.getFileName()
-            + juce::String::formatted("  (%.0f%%)", p * 100.0f),
-            juce::dontSendNotification);
+        const int percent = juce::roundToInt(snap.progress * 100.0f);
+        if (snap.state == ResultChannel::State::running && percent != shown.progressPercent)
+        {
+            shown.progressPercent = percent;
+            dropZone.setText("Analyzing: " + currentFile.getFileName()
+                + "  (" + juce::String(percent) + "%)",
+                juce::dontSendNotification);
+            fileResultBpm.setText("Analyzing…", juce::dontSendNotification);
+            fileResultKey.setText("-", juce::dontSendNotification);
+        }
+        else if (snap.state == ResultChannel::State::done)
+        {
+            showFileResult(snap);
+            dropZone.setText("Drop audio file", juce::dontSendNotification);
+        }
     }
-    cancelButton.setEnabled(analyzing);
+
+    const bool batchRunning = batch && batch->isRunning();
+    if (batch && (batchRunning || batchWasRunning))
+    {
+        // Throughput is re-derived per completed file, not per tick
+        const auto st = batch->getStats();
+        if (st.completed != shown.batchCompleted || batchRunning != shown.batchRunning)
+        {
+            shown.batchCompleted = st.completed;
+            shown.batchRunning = batchRunning;
+            dropZone.setText(juce::String(batchRunning ? "Batch: " : "Batch done: ")
+                + juce::String(st.completed) + "/" + juce::String(st.total) + " files"
+                + (st.failed > 0 ? ", " + juce::String(st.failed) + " failed" : juce::String())
+                + juce::String::formatted("  (%.1f files/s, %.0fx realtime)", st.filesPerSecond(), st.realtimeFactor()),
+                juce::dontSendNotification);
+        }
+
+        if (results.take(ResultChannel::Source::batch, snap) && (snap.bpm > 0.0f || snap.keyIndex >= 0))
+            showFileResult(snap);
+
+        batchWasRunning = batchRunning;
+    }
+
+    cancelButton.setEnabled(analyzing || batchRunning);
 }
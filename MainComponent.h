@@ -5,10 +5,13 @@
 
 #include "AudioEngine.h"
 #include "PeakMeter.h"
+#include "TelemetryOverlay.h"
 #include "RingBuffer.h"
 #include "LiveAnalyzer.h"
-#include "BpmTracker.h"
-#include "KeyDetector.h"
+#include "MultiStreamAnalyzer.h"
+#include "BatchAnalyzer.h"
+#include "ResultChannel.h"
+#include "AnalysisCache.h"
 
 namespace CanonkeyTheme
 {
@@ -43,6 +46,14 @@ public:
     void fileDragExit(const juce::StringArray& files) override; // <-- FIXED SIGNATURE
     void filesDropped(const juce::StringArray& files, int x, int y) override;
 
+    // Ctrl/Cmd+Shift+D toggles the telemetry overlay, Ctrl/Cmd+Shift+R reduced refresh
+    bool keyPressed(const juce::KeyPress& key) override;
+
+    // Low-power machines: UI timer 20 -> 5 Hz, meter 60 -> 20 Hz.
+    // Also on at start-up with CANONKEY_REDUCED_REFRESH=1.
+    void setReducedRefresh(bool shouldReduce);
+    bool isReducedRefresh() const noexcept { return reducedRefresh; }
+
 private:
     // -------- Live Audio --------
     std::unique_ptr<AudioEngine> audio;
@@ -52,11 +63,18 @@ private:
     juce::Label     liveFrames{ {}, "0 blocks" };
     std::atomic<uint64_t> liveBlockCounter{ 0 };
 
+    // Bar position of the latest live beat (drains LiveAnalyzer's beat queue)
+    juce::Label     beatIndicator;
+    double          lastBeatMs = 0.0;
+
     juce::Label liveTitle, liveSubtitle;
     juce::TextButton startListeningButton{ "Start Listening" };
     juce::TextButton audioSourceButton{ "Audio Source" };
     juce::Label      currentSource{ {}, "" };
 
+    // Per-deck readout next to the meter while decks mode runs
+    juce::Label      decksInfo;
+
     // File card UI
     juce::Label fileTitle, fileSubtitle;
     juce::Label dropZone;
@@ -70,27 +88,74 @@ private:
     // Card bounds
     juce::Rectangle<float> liveCardBounds, fileCardBounds;
 
+    // Background + cards, rendered once per size and display scale (paint only blits it)
+    juce::Image background;
+    float backgroundScale = 0.0f;
+    void renderBackground(float scale);
+
+    bool reducedRefresh = false;
+
+    // Values the timer last wrote into liveFrames / dropZone: it rebuilds a text only when
+    // its value changes. Code writing those labels directly calls forgetShownValues().
+    struct ShownValues
+    {
+        uint64_t blocks = ~(uint64_t)0;
+        int tier = -1;
+        int progressPercent = -1;
+        int batchCompleted = -1;
+        bool batchRunning = false;
+        juce::String decks;
+        int beatInBar = -2;   // -1 = no beat grid
+    };
+    ShownValues shown;
+    void forgetShownValues() noexcept { shown = {}; }
+
+    // ---- Diagnostics ----
+    TelemetryOverlay telemetryOverlay;
+    juce::File telemetryFile;          // CANONKEY_TELEMETRY_JSON: snapshot rewritten once a second
+    double nextTelemetryWriteMs = 0.0;
+
+    // ---- Results from every analysis producer, drained by timerCallback ----
+    ResultChannel results;
+
     // ---- Live analyzers & FIFO ----
     RingBuffer monoFifo{ 1u << 16 };  // ~65k samples (~1.5 s at 44.1k)
     std::atomic<double> currentSampleRate{ 0.0 };
-    std::unique_ptr<LiveAnalyzer> analyzer;
+    std::unique_ptr<LiveAnalyzer> analyzer;   // sole owner of the live BPM/Key trackers
 
-    std::unique_ptr<BpmTracker> bpm;
-    std::unique_ptr<KeyDetector> keydet;
+    // ---- Decks mode: every channel group of one interface analysed at once ----
+    // While decksActive the device callback feeds `decks` instead of monoFifo and
+    // LiveAnalyzer is stopped. The layout only changes with the device closed.
+    std::unique_ptr<MultiStreamAnalyzer> decks;
+    std::atomic<bool>         decksActive{ false };
+    AudioEngine::DeviceEntry  decksDevice;   // reopened when the device changes rate
+    int                       decksChannelsPerDeck = 2;   // 1 only when mono decks were picked
 
     // ---- Offline (file) analysis ----
     class FileAnalyzerThread;
     std::unique_ptr<FileAnalyzerThread> fileWorker;
     std::atomic<bool>  fileAnalyzing{ false };
-    std::atomic<float> fileProgress{ 0.0f };
     juce::File         currentFile;
 
+    // Re-dropped / rescanned files are served from disk without decoding
+    AnalysisCache analysisCache;
+
+    // ---- Batch (folder / multi-file) analysis ----
+    std::unique_ptr<BatchAnalyzer> batch;
+    bool                           batchWasRunning = false;
+
     // Keep chooser alive during async browse on Windows
     std::unique_ptr<juce::FileChooser> fileChooser;
 
     // Helpers
+    bool startDecks(const AudioEngine::DeviceEntry& entry, int channelsPerDeck, juce::String& error);
+    void stopDecks();
+    void updateDecksInfo();
+    void showBeats();
     void beginFileAnalysis(const juce::File& f);
+    void beginBatchAnalysis(const juce::Array<juce::File>& inputs);
     void cancelFileAnalysis();
+    void showFileResult(const ResultChannel::Snapshot& r);
     static juce::String keyIndexToString(int idx, bool isMinor);
 
     void timerCallback() override;
@@ -0,0 +1,241 @@
+#include "MultiStreamAnalyzer.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <cmath>
+
+MultiStreamAnalyzer::MultiStreamAnalyzer(const Settings& s)
+    : settings(s)
+{
+}
+
+MultiStreamAnalyzer::~MultiStreamAnalyzer()
+{
+    stop();
+}
+
+std::vector<MultiStreamAnalyzer::StreamConfig> MultiStreamAnalyzer::makeDeckLayout(int numDeviceChannels, int channelsPerDeck, int maxStreams)
+{
+    std::vector<StreamConfig> decks;
+    const int width = juce::jlimit(1, juce::jmax(1, numDeviceChannels), channelsPerDeck);
+    for (int ch = 0; ch + width <= numDeviceChannels && (int)decks.size() < maxStreams; ch += width)
+    {
+        StreamConfig c;
+        c.name = "Deck " + juce::String((int)decks.size() + 1)
+            + (width > 1 ? " (in " + juce::String(ch + 1) + "-" + juce::String(ch + width) + ")"
+                         : " (in " + juce::String(ch + 1) + ")");
+        c.firstChannel = ch;
+        c.numChannels = width;
+        decks.push_back(c);
+    }
+    return decks;
+}
+
+void MultiStreamAnalyzer::setStreams(const std::vector<StreamConfig>& configs)
+{
+    stop();
+
+    streams.clear();
+    for (auto c : configs)
+    {
+        c.firstChannel = std::max(0, c.firstChannel);
+        c.numChannels = std::max(1, c.numChannels);
+        streams.push_back(std::make_unique<Stream>(c, settings.ringSize));
+    }
+}
+
+int MultiStreamAnalyzer::getNumChannelsNeeded() const noexcept
+{
+    int n = 0;
+    for (auto& s : streams)
+        n = std::max(n, s->config.firstChannel + s->config.numChannels);
+    return n;
+}
+
+bool MultiStreamAnalyzer::start(double sampleRate, int numDeviceChannels)
+{
+    if (running.load() || streams.empty() || sampleRate < 8000.0) return false;
+    if (getNumChannelsNeeded() > numDeviceChannels) return false;
+
+    sr = sampleRate;
+    for (auto& s : streams)
+    {
+        // A restart at the same rate resets the chain instead of rebuilding it
+        if (s->chain && s->chain->getSampleRate() == sr)
+            s->chain->reset();
+        else
+            s->chain = std::make_unique<AnalysisChain>(sr);
+        s->chain->setSilenceGate(settings.silenceGate, settings.silenceGateDb);
+        s->ring.clear();
+        s->bpmEMA = 0.0;
+        s->nextPublishMs = 0.0;
+        s->resetRequested.store(false);
+        s->result.store({});
+        s->busyTicks.store(0);
+        s->samplesAnalysed.store(0);
+    }
+
+    int n = settings.numWorkers;
+    if (n <= 0)
+        n = juce::jlimit(1, (int)streams.size(), juce::SystemStats::getNumCpus() / 2);
+    n = juce::jlimit(1, (int)streams.size(), n);
+
+    running.store(true);
+    for (int i = 0; i < n; ++i)
+        workers.emplace_back([this, i] { workerLoop(i); });
+    return true;
+}
+
+void MultiStreamAnalyzer::stop()
+{
+    if (!running.exchange(false)) return;
+
+    for (auto& s : streams) s->ring.wakeConsumer();
+    for (auto& w : workers)
+        if (w.joinable()) w.join();
+    workers.clear();
+}
+
+void MultiStreamAnalyzer::requestReset() noexcept
+{
+    for (auto& s : streams)
+    {
+        s->resetRequested.store(true, std::memory_order_relaxed);
+        s->ring.wakeConsumer();
+    }
+}
+
+void MultiStreamAnalyzer::pushBlock(const float* const* input, int numCh, int numSamples) noexcept
+{
+    if (input == nullptr || numSamples <= 0) return;
+    Telemetry::ScopedStage timer(Telemetry::Stage::downmixPush);
+
+    for (auto& s : streams)
+    {
+        const int first = s->config.firstChannel;
+        const int n = std::min(s->config.numChannels, numCh - first);
+        if (n > 0)
+            s->ring.pushPlanarToMono(input + first, n, numSamples);
+    }
+}
+
+void MultiStreamAnalyzer::workerLoop(int workerIndex)
+{
+    juce::Thread::setCurrentThreadName("MultiStream " + juce::String(workerIndex));
+    Telemetry::ScopedThreadRecording recording;
+
+    const int numStreams = (int)streams.size();
+    int next = workerIndex;   // start points differ so workers spread over streams
+
+    while (running.load())
+    {
+        bool didWork = false;
+        for (int k = 0; k < numStreams; ++k)
+            didWork |= serviceStream(*streams[(size_t)((next + k) % numStreams)]);
+        next = (next + 1) % numStreams;
+
+        // Every stream is fed by the same device callback (start() rejects groups the
+        // device lacks), so a hop arriving on "our" stream means the others are ready
+        // too. Worker i waits on stream i (workers <= streams), one consumer per ring.
+        if (!didWork && running.load())
+        {
+            auto& own = *streams[(size_t)workerIndex];
+            own.ring.waitForSamples((size_t)std::max(1, own.chain ? own.chain->getHopSize() : 512), 100);
+        }
+    }
+}
+
+bool MultiStreamAnalyzer::serviceStream(Stream& s)
+{
+    if (!s.chain) return false;
+
+    const bool reset = s.resetRequested.load(std::memory_order_relaxed);
+    const size_t hop = (size_t)std::max(1, s.chain->getHopSize());
+    if (!reset && s.ring.size() < hop) return false;
+
+    if (s.claimed.exchange(true, std::memory_order_acquire)) return false;
+
+    if (s.resetRequested.exchange(false, std::memory_order_relaxed))
+    {
+        s.chain->reset();
+        s.bpmEMA = 0.0;
+        s.result.store({});
+    }
+
+    const auto t0 = juce::Time::getHighResolutionTicks();
+
+    const auto span = s.ring.peek(s.ring.capacity());
+    s.chain->processMono(span.first, (int)span.firstSize);
+    s.chain->processMono(span.second, (int)span.secondSize);
+    s.ring.consume(span.size());
+
+    const double nowMs = juce::Time::getMillisecondCounterHiRes();
+    if (nowMs >= s.nextPublishMs)
+    {
+        publish(s);
+        s.nextPublishMs = nowMs + 1000.0 / std::max(0.5f, settings.updateHz);
+    }
+
+    s.busyTicks.fetch_add(juce::Time::getHighResolutionTicks() - t0, std::memory_order_relaxed);
+    s.samplesAnalysed.fetch_add((juce::int64)span.size(), std::memory_order_relaxed);
+
+    s.claimed.store(false, std::memory_order_release);
+    return span.size() > 0;
+}
+
+void MultiStreamAnalyzer::publish(Stream& s)
+{
+    auto& chain = *s.chain;
+
+    const float raw = chain.getBpmTracker().getBpm();
+    if (raw > 0.0f)
+    {
+        if (s.bpmEMA <= 0.0) s.bpmEMA = raw;
+        s.bpmEMA = settings.bpmSmoothingEMA * s.bpmEMA
+            + (1.0 - settings.bpmSmoothingEMA) * (double)raw;
+    }
+
+    ResultChannel::Snapshot snap;
+    snap.state = ResultChannel::State::running;
+    snap.bpm = (float)s.bpmEMA;
+    snap.bpmConfidence = raw > 0.0f ? chain.getBpmTracker().getConfidence() : 0.0f;
+
+    const auto k = chain.getKeyDetector().getLast();
+    snap.keyIndex = k.keyIndex;
+    snap.isMinor = k.isMinor;
+    snap.keyConfidence = k.keyIndex >= 0 ? k.confidence : 0.0f;
+    snap.tuningCents = chain.getKeyDetector().getTuningCents();
+
+    s.result.store(snap);
+}
+
+ResultChannel::Snapshot MultiStreamAnalyzer::getResult(int stream) const noexcept
+{
+    if (stream < 0 || stream >= (int)streams.size()) return {};
+    return streams[(size_t)stream]->result.load();
+}
+
+MultiStreamAnalyzer::StreamStats MultiStreamAnalyzer::getStats(int stream) const noexcept
+{
+    StreamStats st;
+    if (stream < 0 || stream >= (int)streams.size()) return st;
+
+    const auto& s = *streams[(size_t)stream];
+    st.busySec = juce::Time::highResolutionTicksToSeconds(s.busyTicks.load(std::memory_order_relaxed));
+    st.audioSec = sr > 0.0 ? (double)s.samplesAnalysed.load(std::memory_order_relaxed) / sr : 0.0;
+    st.droppedSamples = s.ring.droppedSamples();
+    return st;
+}
+
+juce::String MultiStreamAnalyzer::getStreamName(int stream) const
+{
+    if (stream < 0 || stream >= (int)streams.size()) return {};
+    return streams[(size_t)stream]->config.name;
+}
+
+double MultiStreamAnalyzer::getTotalLoad() const noexcept
+{
+    double total = 0.0;
+    for (int i = 0; i < (int)streams.size(); ++i)
+        total += getStats(i).load();
+    return total;
+}
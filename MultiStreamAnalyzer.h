@@ -0,0 +1,116 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "RingBuffer.h"
+#include "ResultChannel.h"
+#include "SeqLock.h"
+#include "AnalysisChain.h"
+
+//------------------------------------------------------------------------------
+// Several live inputs at once (e.g. decks on separate ASIO input pairs).
+// Each channel group gets its own ring and AnalysisChain; a small shared pool
+// of workers claims whichever stream has a hop of audio ready, so streams are
+// never tied to a thread. Busy time is accounted per stream.
+class MultiStreamAnalyzer
+{
+public:
+    struct StreamConfig
+    {
+        juce::String name;
+        int firstChannel = 0;   // device input channel of this group
+        int numChannels = 2;    // downmixed to mono
+    };
+
+    struct Settings
+    {
+        int    numWorkers = 0;           // 0 = min(streams, cores / 2), at least 1
+        size_t ringSize = 1u << 16;      // per stream
+        float  updateHz = 2.0f;          // result publishing per stream
+        float  bpmSmoothingEMA = 0.70f;  // same display smoothing as LiveAnalyzer
+        bool   silenceGate = true;       // idle inputs skip analysis (LiveAnalyzer::Settings)
+        float  silenceGateDb = -60.0f;
+    };
+
+    struct StreamStats
+    {
+        double audioSec = 0.0;    // audio analysed
+        double busySec = 0.0;     // worker time spent on it
+        size_t droppedSamples = 0;
+
+        // Fraction of one core needed to keep this stream realtime
+        double load() const noexcept { return audioSec > 0.0 ? busySec / audioSec : 0.0; }
+    };
+
+    explicit MultiStreamAnalyzer(const Settings& s = {});
+    ~MultiStreamAnalyzer();
+
+    // Decks of channelsPerDeck consecutive inputs on a device with numDeviceChannels:
+    // stereo pairs by default (a 2-3 input interface is one deck; a trailing odd input
+    // is left out), 1 for one mono deck per input. At most maxStreams.
+    static std::vector<StreamConfig> makeDeckLayout(int numDeviceChannels, int channelsPerDeck = 2, int maxStreams = 4);
+
+    // Replace the stream layout (stops the workers; call start() again)
+    void setStreams(const std::vector<StreamConfig>& configs);
+    int getNumStreams() const noexcept { return (int)streams.size(); }
+
+    // Input channels a device must provide for every group
+    int getNumChannelsNeeded() const noexcept;
+
+    // Build one chain per stream at sampleRate (kept from the last run and reset if the
+    // rate is unchanged) and launch the workers. Fails if a group needs channels beyond
+    // numDeviceChannels: its ring would never fill and its worker would only time out.
+    bool start(double sampleRate, int numDeviceChannels);
+    void stop();
+    bool isRunning() const noexcept { return running.load(); }
+    double getSampleRate() const noexcept { return sr; }
+
+    // Clear all stream state on the workers' next pass (fresh session)
+    void requestReset() noexcept;
+
+    // Audio thread: fan one device block out to the stream rings (lock-free)
+    void pushBlock(const float* const* input, int numCh, int numSamples) noexcept;
+
+    ResultChannel::Snapshot getResult(int stream) const noexcept;
+    StreamStats getStats(int stream) const noexcept;
+    juce::String getStreamName(int stream) const;
+
+    // Cores busy per second of realtime audio, summed over streams
+    double getTotalLoad() const noexcept;
+
+private:
+    struct Stream
+    {
+        explicit Stream(const StreamConfig& c, size_t ringSize) : config(c), ring(ringSize) {}
+
+        StreamConfig config;
+        RingBuffer ring;
+        std::unique_ptr<AnalysisChain> chain;
+
+        std::atomic<bool> claimed{ false };          // one worker at a time
+        std::atomic<bool> resetRequested{ false };
+
+        // owned by whichever worker holds the claim
+        double bpmEMA = 0.0;
+        double nextPublishMs = 0.0;
+
+        SeqLock<ResultChannel::Snapshot> result;
+        std::atomic<juce::int64> busyTicks{ 0 };
+        std::atomic<juce::int64> samplesAnalysed{ 0 };
+    };
+
+    void workerLoop(int workerIndex);
+    bool serviceStream(Stream& s);   // false if the stream was busy or had no full hop
+    void publish(Stream& s);
+
+    Settings settings;
+    double sr = 0.0;
+    std::vector<std::unique_ptr<Stream>> streams;
+
+    std::vector<std::thread> workers;
+    std::atomic<bool> running{ false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MultiStreamAnalyzer)
+};
@@ -12,14 +12,16 @@
 #include <JuceHeader.h>
 
 // Simple, thread-safe stereo peak meter.
-// Call setLevels() from the audio thread; the component repaints at 60 Hz.
+// Call setLevels() from the audio thread. The timer smooths the levels and repaints
+// only a bar whose fill moved by at least a pixel; at rest it drops to a slow poll
+// and paints nothing.
 class StereoPeakMeter : public juce::Component, private juce::Timer
 {
 public:
     StereoPeakMeter()
     {
         setInterceptsMouseClicks (false, false);
-        startTimerHz (60); // UI refresh
+        startTimerHz (idleHz);
     }
 
     // Audio-thread safe
@@ -29,49 +31,89 @@ public:
         rTarget.store (juce::jlimit (0.0f, 1.0f, right));
     }
 
+    // Refresh rate while a bar is moving (default 60 Hz); the release time stays the same
+    void setRefreshRate (int hz)
+    {
+        refreshHz = juce::jlimit (idleHz, 120, hz);
+        release = std::pow (0.92f, 60.0f / (float) refreshHz);
+        if (active)
+            startTimerHz (refreshHz);
+    }
+
     void paint (juce::Graphics& g) override
     {
-        auto bounds = getLocalBounds().toFloat();
-        auto gap    = 8.0f;
-        auto w      = (bounds.getWidth() - gap) * 0.5f;
-        auto leftR  = bounds.removeFromLeft (w);
-        bounds.removeFromLeft (gap);
-        auto rightR = bounds;
+        juce::Rectangle<float> leftR, rightR;
+        getBars (leftR, rightR);
 
-        drawBar (g, leftR,  lNow);
-        drawBar (g, rightR, rNow);
+        lShown = fillHeight (leftR, lNow);
+        rShown = fillHeight (rightR, rNow);
+        drawBar (g, leftR,  lShown);
+        drawBar (g, rightR, rShown);
     }
 
 private:
+    static constexpr int idleHz = 15;
+
     std::atomic<float> lTarget { 0.0f }, rTarget { 0.0f };
     float lNow = 0.0f, rNow = 0.0f;
+    int lShown = 0, rShown = 0;     // painted fill heights, whole pixels
+    int refreshHz = 60;
+    float release = 0.92f;          // per-tick decay at refreshHz
+    bool active = false;
 
     void timerCallback() override
     {
         // fast attack, slow release
         smoothTo (lNow, lTarget.load());
         smoothTo (rNow, rTarget.load());
-        repaint();
+
+        juce::Rectangle<float> leftR, rightR;
+        getBars (leftR, rightR);
+        if (fillHeight (leftR, lNow) != lShown)   repaint (leftR.getSmallestIntegerContainer());
+        if (fillHeight (rightR, rNow) != rShown)  repaint (rightR.getSmallestIntegerContainer());
+
+        // Poll slowly once both bars have fallen back to zero
+        const bool moving = lNow > 0.0f || rNow > 0.0f;
+        if (moving != active)
+        {
+            active = moving;
+            startTimerHz (active ? refreshHz : idleHz);
+        }
     }
 
-    static void smoothTo (float& now, float target) noexcept
+    void smoothTo (float& now, float target) const noexcept
     {
         if (target > now) now = target;
-        else              now *= 0.92f;
+        else              now *= release;
         if (now < 0.001f) now = 0.0f;
     }
 
-    void drawBar (juce::Graphics& g, juce::Rectangle<float> r, float level)
+    void getBars (juce::Rectangle<float>& leftR, juce::Rectangle<float>& rightR) const
+    {
+        auto bounds = getLocalBounds().toFloat();
+        auto gap    = 8.0f;
+        auto w      = (bounds.getWidth() - gap) * 0.5f;
+        leftR = bounds.removeFromLeft (w);
+        bounds.removeFromLeft (gap);
+        rightR = bounds;
+    }
+
+    static int fillHeight (juce::Rectangle<float> r, float level) noexcept
+    {
+        return juce::roundToInt (r.getHeight() * juce::jlimit (0.0f, 1.0f, level));
+    }
+
+    void drawBar (juce::Graphics& g, juce::Rectangle<float> r, int fillPx)
     {
         g.setColour (juce::Colour (0xffe8eefc));
         g.fillRoundedRectangle (r, 6.0f);
 
-        const float v = juce::jlimit (0.0f, 1.0f, level);
-        auto filled = r.withY (r.getBottom() - r.getHeight() * v)
-                      .withHeight (r.getHeight() * v);
-
-        g.setColour (juce::Colour (0xff2f6df6));
-        g.fillRoundedRectangle (filled, 6.0f);
+        if (fillPx > 0)
+        {
+            const auto h = juce::jmin (r.getHeight(), (float) fillPx);
+            g.setColour (juce::Colour (0xff2f6df6));
+            g.fillRoundedRectangle (r.withTop (r.getBottom() - h), 6.0f);
+        }
 
         g.setColour (juce::Colour (0x14000000));
         g.drawRoundedRectangle (r, 6.0f, 1.0f);
@@ -0,0 +1,96 @@
+#include "PolyphaseDecimator.h"
+#include "SimdKernels.h"
+#include <cmath>
+
+PolyphaseDecimator::PolyphaseDecimator(int factorToUse, int tapsPerPhase)
+    : factor(juce::jmax(1, factorToUse)),
+    numTaps(factor == 1 ? 1 : juce::jmax(8, tapsPerPhase) * factor + 1)
+{
+    taps.assign((size_t)numTaps, 0.0f);
+    if (factor == 1)
+    {
+        taps[0] = 1.0f;
+    }
+    else
+    {
+        // Blackman-windowed sinc, cutoff at the output Nyquist (0.5 / factor cycles per input sample).
+        // The analyzers read nothing above 8 kHz and aliases fold around the output Nyquist,
+        // so the ~-74 dB stopband only has to be reached by outRate - 8 kHz.
+        const double fc = 0.5 / (double)factor;
+        const double mid = 0.5 * (double)(numTaps - 1);
+        double sum = 0.0;
+        for (int n = 0; n < numTaps; ++n)
+        {
+            const double t = (double)n - mid;
+            const double sinc = t == 0.0 ? 2.0 * fc
+                : std::sin(2.0 * juce::MathConstants<double>::pi * fc * t) / (juce::MathConstants<double>::pi * t);
+            const double x = 2.0 * juce::MathConstants<double>::pi * (double)n / (double)(numTaps - 1);
+            const double w = 0.42 - 0.5 * std::cos(x) + 0.08 * std::cos(2.0 * x);
+            taps[(size_t)n] = (float)(sinc * w);
+            sum += sinc * w;
+        }
+        // Unity DC gain
+        for (auto& h : taps) h = (float)((double)h / sum);
+    }
+
+    history.assign((size_t)(2 * numTaps), 0.0f);
+}
+
+int PolyphaseDecimator::chooseFactor(double inputRate, double minOutputRate) noexcept
+{
+    if (inputRate <= 0.0 || minOutputRate <= 0.0) return 1;
+    return juce::jmax(1, (int)(inputRate / minOutputRate));
+}
+
+void PolyphaseDecimator::reset() noexcept
+{
+    std::fill(history.begin(), history.end(), 0.0f);
+    writePos = 0;
+    phase = 0;
+}
+
+int PolyphaseDecimator::process(const float* in, int numSamples, float* out) noexcept
+{
+    if (in == nullptr || numSamples <= 0) return 0;
+
+    if (factor == 1)
+    {
+        std::memcpy(out, in, (size_t)numSamples * sizeof(float));
+        return numSamples;
+    }
+
+    int written = 0;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        history[(size_t)writePos] = in[i];
+        history[(size_t)(writePos + numTaps)] = in[i];
+        if (++writePos == numTaps) writePos = 0;
+
+        // Only the kept outputs are computed: history[writePos ...] is oldest..newest
+        if (++phase == factor)
+        {
+            phase = 0;
+            out[written++] = SimdKernels::dot(history.data() + writePos, taps.data(), numTaps);
+        }
+    }
+    return written;
+}
+
+int PolyphaseDecimator::processSilence(int numSamples, float* out) noexcept
+{
+    if (numSamples <= 0) return 0;
+
+    const int produced = getNumOutputs(numSamples);
+    std::fill(out, out + produced, 0.0f);
+    phase = (phase + numSamples) % factor;
+
+    // Zeros into the history as process() would write them (only the last numTaps matter)
+    const int z = juce::jmin(numSamples, numTaps);
+    writePos = (writePos + numSamples - z) % numTaps;
+    for (int i = 0; i < z; ++i)
+    {
+        history[(size_t)writePos] = history[(size_t)(writePos + numTaps)] = 0.0f;
+        if (++writePos == numTaps) writePos = 0;
+    }
+    return produced;
+}
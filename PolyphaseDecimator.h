@@ -0,0 +1,42 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// Integer-factor decimator: linear-phase windowed-sinc lowpass at the output
+// Nyquist, evaluated only for every factor-th input sample (the polyphase form,
+// factor x fewer MACs than filtering at the input rate). RT-safe after construction.
+class PolyphaseDecimator
+{
+public:
+    explicit PolyphaseDecimator(int factor = 1, int tapsPerPhase = 32);
+
+    // Largest factor that keeps the output at or above minOutputRate
+    static int chooseFactor(double inputRate, double minOutputRate = 20000.0) noexcept;
+
+    void reset() noexcept;
+
+    int getFactor() const noexcept { return factor; }
+
+    // Input index that output m is centred on, minus factor * m (negative: filter delay)
+    double getOutputOffset() const noexcept { return (double)(factor - 1) - 0.5 * (double)(numTaps - 1); }
+
+    // Outputs produced for numSamples inputs (depends on the phase left by earlier calls)
+    int getNumOutputs(int numSamples) const noexcept { return (phase + numSamples) / factor; }
+
+    // Filter + downsample; out needs room for getNumOutputs(numSamples). Returns outputs written.
+    int process(const float* in, int numSamples, float* out) noexcept;
+
+    // Feed numSamples zeros without the filter work: writes zero outputs, which is exact
+    // once the history holds no signal (getNumTaps() quiet inputs). For gated silence.
+    int processSilence(int numSamples, float* out) noexcept;
+
+    int getNumTaps() const noexcept { return numTaps; }
+
+private:
+    int factor;
+    int numTaps;
+    std::vector<float> taps;      // symmetric, so no reversal is needed
+    std::vector<float> history;   // 2 * numTaps, mirrored: the last numTaps inputs are always contiguous
+    int writePos = 0;
+    int phase = 0;                // inputs since the last output
+};
@@ -0,0 +1,190 @@
+#include "PrefetchDecoder.h"
+#include "SimdKernels.h"
+
+namespace
+{
+    // sampleToPointer() is protected; a pointer-to-member taken through a derived
+    // class is the sanctioned way to reach it without copying the mapping logic
+    struct MappedAccess : juce::MemoryMappedAudioFormatReader
+    {
+        static const void* pointerTo(const juce::MemoryMappedAudioFormatReader& r, juce::int64 sample) noexcept
+        {
+            return (r.*(&MappedAccess::sampleToPointer))(sample);
+        }
+    };
+
+    // Interleaved layout of a mapped reader the SIMD downmix understands, -1 otherwise
+    int mappedSampleFormat(const juce::AudioFormatReader& reader)
+    {
+        // AIFF stores big-endian samples; only WAV matches the kernels' byte order
+        if (!reader.getFormatName().containsIgnoreCase("WAV"))
+            return -1;
+
+        if (reader.usesFloatingPointData)
+            return reader.bitsPerSample == 32 ? (int)SimdKernels::SampleFormat::float32 : -1;
+        if (reader.bitsPerSample == 16) return (int)SimdKernels::SampleFormat::int16;
+        if (reader.bitsPerSample == 24) return (int)SimdKernels::SampleFormat::int24;
+        return -1;
+    }
+
+    template <typename Format>
+    std::unique_ptr<juce::AudioFormatReader> openMapped(const juce::File& file)
+    {
+        Format format;
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> r(format.createMemoryMappedReader(file));
+        if (r == nullptr || !r->mapEntireFile())
+            return {};
+        return std::unique_ptr<juce::AudioFormatReader>(r.release());
+    }
+}
+
+std::unique_ptr<juce::AudioFormatReader> PrefetchDecoder::openReader(const juce::File& file)
+{
+    // Mapping fails for huge files on 32-bit address spaces: fall back to streaming
+    if (file.hasFileExtension(".wav"))
+        if (auto r = openMapped<juce::WavAudioFormat>(file))
+            return r;
+
+    if (file.hasFileExtension(".aiff;.aif"))
+        if (auto r = openMapped<juce::AiffAudioFormat>(file))
+            return r;
+
+    juce::AudioFormatManager fm; fm.registerBasicFormats();
+    return std::unique_ptr<juce::AudioFormatReader>(fm.createReaderFor(file));
+}
+
+PrefetchDecoder::PrefetchDecoder(juce::AudioFormatReader& r, juce::int64 start, juce::int64 end,
+    bool prefetch, int blockSizeToUse, int numBlocks)
+    : reader(r),
+    rangeEnd(end),
+    blockSize(juce::jmax(256, blockSizeToUse)),
+    numChannels(juce::jmax(1, (int)r.numChannels)),
+    nextPos(start),
+    threaded(prefetch)
+{
+    if (auto* mm = dynamic_cast<const juce::MemoryMappedAudioFormatReader*>(&reader))
+    {
+        mappedFormat = mappedSampleFormat(reader);
+        if (mappedFormat >= 0)
+            mapped = mm;
+    }
+    if (mapped == nullptr)
+        planar.setSize(numChannels, blockSize);
+
+    slots.resize((size_t)(threaded ? juce::jmax(2, numBlocks) : 1));
+    for (auto& s : slots)
+        s.mono.assign((size_t)blockSize, 0.0f);
+
+    if (threaded)
+        worker = std::thread([this] { producerLoop(); });
+}
+
+PrefetchDecoder::~PrefetchDecoder()
+{
+    if (worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> l(lock);
+            stopRequested.store(true);
+        }
+        cv.notify_all();
+        worker.join();
+    }
+}
+
+bool PrefetchDecoder::decode(juce::int64 pos, int n, float* mono)
+{
+    const float gain = 1.0f / (float)numChannels;
+
+    if (mapped != nullptr && mapped->getMappedSection().contains(juce::Range<juce::int64>(pos, pos + n)))
+    {
+        // One pass from the page cache into mono, no intermediate float buffers
+        SimdKernels::downmixInterleaved(MappedAccess::pointerTo(*mapped, pos),
+            (SimdKernels::SampleFormat)mappedFormat, numChannels, 0, mono, n, gain);
+        return true;
+    }
+
+    if (planar.getNumChannels() != numChannels || planar.getNumSamples() < n)
+        planar.setSize(numChannels, blockSize);
+
+    if (!reader.read(&planar, 0, n, pos, true, true))
+        return false;
+
+    SimdKernels::downmix(planar.getArrayOfReadPointers(), numChannels, 0, mono, n, gain);
+    return true;
+}
+
+void PrefetchDecoder::producerLoop()
+{
+    const auto numSlots = (juce::int64)slots.size();
+
+    while (nextPos < rangeEnd)
+    {
+        {
+            std::unique_lock<std::mutex> l(lock);
+            cv.wait(l, [&] { return stopRequested.load() || produced - consumed < numSlots; });
+            if (stopRequested.load()) break;
+        }
+
+        // Slot (produced % numSlots) is never the one the consumer holds
+        auto& slot = slots[(size_t)(produced % numSlots)];
+        const int n = (int)std::min<juce::int64>((juce::int64)blockSize, rangeEnd - nextPos);
+        if (!decode(nextPos, n, slot.mono.data()))
+        {
+            failed.store(true);
+            break;
+        }
+        nextPos += n;
+        slot.numSamples = n;
+        slot.endPos = nextPos;
+
+        {
+            std::lock_guard<std::mutex> l(lock);
+            ++produced;
+        }
+        cv.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> l(lock);
+        producerDone = true;
+    }
+    cv.notify_all();
+}
+
+bool PrefetchDecoder::next(Block& out)
+{
+    if (!threaded)
+    {
+        if (nextPos >= rangeEnd || failed.load()) return false;
+
+        auto& slot = slots.front();
+        const int n = (int)std::min<juce::int64>((juce::int64)blockSize, rangeEnd - nextPos);
+        if (!decode(nextPos, n, slot.mono.data()))
+        {
+            failed.store(true);
+            return false;
+        }
+        nextPos += n;
+        out = { slot.mono.data(), n, nextPos };
+        return true;
+    }
+
+    std::unique_lock<std::mutex> l(lock);
+    if (holdingBlock)
+    {
+        // Hand the previous block back to the producer
+        ++consumed;
+        holdingBlock = false;
+        cv.notify_all();
+    }
+
+    cv.wait(l, [&] { return produced > consumed || producerDone; });
+    if (produced <= consumed)
+        return false;   // end of range or read error (blocks decoded before it are still delivered)
+
+    const auto& slot = slots[(size_t)(consumed % (juce::int64)slots.size())];
+    holdingBlock = true;
+    out = { slot.mono.data(), slot.numSamples, slot.endPos };
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Decodes [start, end) of a reader into mono blocks.
+// With prefetch, a decode thread runs up to numBlocks ahead of the consumer
+// into pooled buffers, so I/O and decoding overlap the analysis.
+// Memory-mapped little-endian WAV (int16 / int24 / float32) is downmixed
+// straight from the mapped pages; everything else goes through reader.read().
+class PrefetchDecoder
+{
+public:
+    struct Block
+    {
+        const float* samples = nullptr;   // mono, valid until the next call to next()
+        int numSamples = 0;
+        juce::int64 endPos = 0;           // reader position after this block
+    };
+
+    PrefetchDecoder(juce::AudioFormatReader& reader, juce::int64 start, juce::int64 end,
+        bool prefetch = true, int blockSize = 32768, int numBlocks = 4);
+    ~PrefetchDecoder();
+
+    // Consumer: next block in order; false at the end of the range or on a read error
+    bool next(Block& out);
+
+    bool hasFailed() const noexcept { return failed.load(); }
+    bool isReadingMappedData() const noexcept { return mapped != nullptr; }
+
+    // Open a reader, memory-mapping WAV / AIFF where possible (nullptr if unsupported)
+    static std::unique_ptr<juce::AudioFormatReader> openReader(const juce::File& file);
+
+private:
+    bool decode(juce::int64 pos, int n, float* mono);
+    void producerLoop();
+
+    juce::AudioFormatReader& reader;
+    const juce::int64 rangeEnd;
+    const int blockSize;
+    const int numChannels;
+
+    // Mapped fast path: interleaved frames of this format (nullptr = use reader.read)
+    const juce::MemoryMappedAudioFormatReader* mapped = nullptr;
+    int mappedFormat = 0;                 // SimdKernels::SampleFormat
+    juce::AudioBuffer<float> planar;      // reader.read() path only
+
+    // Block pool: slot i % numBlocks holds block i
+    struct Slot
+    {
+        std::vector<float> mono;
+        int numSamples = 0;
+        juce::int64 endPos = 0;
+    };
+    std::vector<Slot> slots;
+    juce::int64 nextPos;                  // producer side
+    juce::int64 produced = 0, consumed = 0;
+    bool holdingBlock = false;            // consumer owns slot (consumed % numBlocks)
+    bool producerDone = false;
+
+    const bool threaded;
+    std::mutex lock;
+    std::condition_variable cv;
+    std::atomic<bool> stopRequested{ false }, failed{ false };
+    std::thread worker;
+
+    JUCE_DECLARE_NON_COPYABLE(PrefetchDecoder)
+};
@@ -0,0 +1,119 @@
+#include <JuceHeader.h>
+#include "RealtimeGuard.h"
+
+#if CANONKEY_RT_GUARD
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    thread_local int      rtDepth = 0;
+    thread_local bool     reporting = false;   // jassert may allocate while logging
+    thread_local uint64_t allocCount = 0;
+
+    void onHeapCall() noexcept
+    {
+        ++allocCount;
+        if (rtDepth > 0 && !reporting)
+        {
+            reporting = true;
+            jassertfalse;   // heap call inside a ScopedRealtimeSection
+            reporting = false;
+        }
+    }
+
+    void* allocOrNull(std::size_t n) noexcept
+    {
+        onHeapCall();
+        return std::malloc(n ? n : 1);
+    }
+
+    void* alignedAllocOrNull(std::size_t n, std::size_t align) noexcept
+    {
+        onHeapCall();
+        if (align < sizeof(void*)) align = sizeof(void*);
+       #if JUCE_WINDOWS
+        return _aligned_malloc(n ? n : 1, align);
+       #else
+        void* p = nullptr;
+        return posix_memalign(&p, align, n ? n : 1) == 0 ? p : nullptr;
+       #endif
+    }
+
+    void release(void* p) noexcept
+    {
+        if (p == nullptr) return;
+        onHeapCall();
+        std::free(p);
+    }
+
+    void alignedRelease(void* p) noexcept
+    {
+        if (p == nullptr) return;
+        onHeapCall();
+       #if JUCE_WINDOWS
+        _aligned_free(p);
+       #else
+        std::free(p);
+       #endif
+    }
+}
+
+namespace RealtimeGuard
+{
+    void enterSection() noexcept { ++rtDepth; }
+    void exitSection() noexcept { --rtDepth; }
+    bool isInSection() noexcept { return rtDepth > 0; }
+    uint64_t threadAllocationCount() noexcept { return allocCount; }
+
+    void assertNotRealtime() noexcept
+    {
+        if (rtDepth > 0 && !reporting)
+        {
+            reporting = true;
+            jassertfalse;   // blocking call inside a ScopedRealtimeSection
+            reporting = false;
+        }
+    }
+}
+
+// ---- Global replacements (only in CANONKEY_RT_GUARD builds) ----
+void* operator new(std::size_t n)
+{
+    if (void* p = allocOrNull(n)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t n)
+{
+    if (void* p = allocOrNull(n)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept   { return allocOrNull(n); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return allocOrNull(n); }
+
+void* operator new(std::size_t n, std::align_val_t a)
+{
+    if (void* p = alignedAllocOrNull(n, (std::size_t)a)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t n, std::align_val_t a)
+{
+    if (void* p = alignedAllocOrNull(n, (std::size_t)a)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept                              { release(p); }
+void operator delete[](void* p) noexcept                            { release(p); }
+void operator delete(void* p, std::size_t) noexcept                 { release(p); }
+void operator delete[](void* p, std::size_t) noexcept               { release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept       { release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept     { release(p); }
+void operator delete(void* p, std::align_val_t) noexcept            { alignedRelease(p); }
+void operator delete[](void* p, std::align_val_t) noexcept          { alignedRelease(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept   { alignedRelease(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { alignedRelease(p); }
+
+#endif // CANONKEY_RT_GUARD
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+
+// Opt-in allocation / lock detector for real-time code paths.
+// Build with CANONKEY_RT_GUARD=1 to replace the global operator new/delete:
+// any heap call made on a thread inside a ScopedRealtimeSection asserts, and
+// assertNotRealtime() flags blocking calls placed at our own lock sites.
+// With the flag off (default) everything here compiles to nothing. The bench
+// build (CANONKEY_BUILD_BENCH=1) turns it on unless told otherwise.
+#ifndef CANONKEY_RT_GUARD
+ #if defined(CANONKEY_BUILD_BENCH) && CANONKEY_BUILD_BENCH
+  #define CANONKEY_RT_GUARD 1
+ #else
+  #define CANONKEY_RT_GUARD 0
+ #endif
+#endif
+
+namespace RealtimeGuard
+{
+#if CANONKEY_RT_GUARD
+    void enterSection() noexcept;
+    void exitSection() noexcept;
+    bool isInSection() noexcept;
+
+    // Heap calls made by the calling thread since it started
+    uint64_t threadAllocationCount() noexcept;
+
+    // Put next to mutex/lock acquisitions that must never run on an RT thread
+    void assertNotRealtime() noexcept;
+#else
+    inline void enterSection() noexcept {}
+    inline void exitSection() noexcept {}
+    inline bool isInSection() noexcept { return false; }
+    inline uint64_t threadAllocationCount() noexcept { return 0; }
+    inline void assertNotRealtime() noexcept {}
+#endif
+
+    // RAII marker for code that must not allocate or lock
+    struct ScopedRealtimeSection
+    {
+        ScopedRealtimeSection() noexcept { enterSection(); }
+        ~ScopedRealtimeSection() noexcept { exitSection(); }
+        ScopedRealtimeSection(const ScopedRealtimeSection&) = delete;
+        ScopedRealtimeSection& operator=(const ScopedRealtimeSection&) = delete;
+    };
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "SeqLock.h"
+
+// Analysis results -> UI, one versioned snapshot per source.
+// Producers overwrite their source's slot, so updates coalesce: there is never
+// more than one outstanding update per source however fast a producer runs.
+// The UI timer drains with take() at its own rate. Readers never block; writers
+// of the same source (batch pool threads) serialise on a tiny spin flag.
+class ResultChannel
+{
+public:
+    enum class Source { live, file, batch };
+    static constexpr int numSources = 3;
+
+    enum class State : int32_t { idle, running, done, failed, cancelled };
+
+    struct Snapshot
+    {
+        State   state = State::idle;
+        float   bpm = 0.0f;
+        float   bpmConfidence = 0.0f;
+        int32_t keyIndex = -1;        // 0..11 = C..B, -1 unknown
+        bool    isMinor = false;
+        float   keyConfidence = 0.0f;
+        float   tuningCents = 0.0f;
+        float   progress = 0.0f;      // 0..1 for file sources
+        int32_t completed = 0;        // batch counters
+        int32_t total = 0;
+        int32_t qualityTier = 0;      // live: 0 = full analysis quality, higher = reduced under CPU load
+    };
+
+    // Producer: replace the source's snapshot
+    void publish(Source s, const Snapshot& snap) noexcept
+    {
+        auto& slot = slots[(int)s];
+        lockWriter(slot);
+        slot.value.store(snap);
+        unlockWriter(slot);
+    }
+
+    // Producer: read-modify-write a few fields (fn(Snapshot&) must not block)
+    template <typename Fn>
+    void update(Source s, Fn&& fn) noexcept
+    {
+        auto& slot = slots[(int)s];
+        lockWriter(slot);
+        auto snap = slot.value.load();
+        fn(snap);
+        slot.value.store(snap);
+        unlockWriter(slot);
+    }
+
+    // Any thread: latest snapshot
+    Snapshot latest(Source s) const noexcept { return slots[(int)s].value.load(); }
+
+    // UI thread only: true (and the snapshot) if the source changed since the last take()
+    bool take(Source s, Snapshot& out) noexcept
+    {
+        auto& slot = slots[(int)s];
+        const uint32_t v = slot.value.version();
+        if (v == slot.taken) return false;
+
+        // Read the version first: a store racing with the load is simply seen again next time
+        slot.taken = v;
+        out = slot.value.load();
+        return true;
+    }
+
+private:
+    struct Slot
+    {
+        SeqLock<Snapshot> value;
+        std::atomic<bool> writing{ false };
+        uint32_t          taken = 0;   // consumer-side version of the last take()
+    };
+
+    static void lockWriter(Slot& slot) noexcept
+    {
+        while (slot.writing.exchange(true, std::memory_order_acquire)) {}
+    }
+
+    static void unlockWriter(Slot& slot) noexcept
+    {
+        slot.writing.store(false, std::memory_order_release);
+    }
+
+    Slot slots[numSources];
+};
@@ -4,11 +4,17 @@
 #include <cstdint>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include "SimdKernels.h"
 
 // Single-producer / single-consumer lock-free ring buffer (float, mono).
-// Producer: audio thread (pushPlanarToMono)
-// Consumer: analyzer/timer thread (pop)
+// Producer: audio thread (pushPlanarToMono / pushInterleavedToMono)
+// Consumer: analyzer/timer thread (pop, or waitForSamples + peek/consume)
 // Capacity is rounded to power-of-two for fast masking.
+// The producer never locks: it notifies on every push that finds a waiting
+// consumer's fill watermark crossed, until the consumer wakes and clears it.
 class RingBuffer
 {
 public:
@@ -37,6 +43,17 @@ public:
 
     size_t freeSpace() const noexcept { return capacity_ - 1 - size(); }
 
+    // Readable region as (at most) two spans into ring storage
+    struct ReadSpans
+    {
+        const float* first = nullptr;
+        size_t firstSize = 0;
+        const float* second = nullptr;
+        size_t secondSize = 0;
+
+        size_t size() const noexcept { return firstSize + secondSize; }
+    };
+
     void clear() noexcept
     {
         auto w = write_.load(std::memory_order_relaxed);
@@ -53,15 +70,68 @@ public:
         size_t free = capacity_ - 1 - (w - r);
         size_t toWrite = (size_t)std::min<int>(numSamples, (int)free);
 
-        for (size_t i = 0; i < toWrite; ++i)
-        {
-            float s = 0.0f;
-            for (int c = 0; c < numCh; ++c) s += input[c][(int)i];
-            s = (s / (float)numCh) * gain; // average to avoid clipping
-            buffer_[(w + i) & mask_] = s;
-        }
+        // Average to avoid clipping; the ring wraps at most once per push
+        const float g = gain / (float)numCh;
+        const size_t idx = w & mask_;
+        const size_t first = std::min(toWrite, capacity_ - idx);
+        SimdKernels::downmix(input, numCh, 0, buffer_.data() + idx, (int)first, g);
+        if (toWrite > first)
+            SimdKernels::downmix(input, numCh, (int)first, buffer_.data(), (int)(toWrite - first), g);
 
         write_.store(w + toWrite, std::memory_order_release);
+        notifyIfWatermarkReached(w + toWrite);
+
+        size_t dropped = (size_t)std::max<int>(0, numSamples - (int)toWrite);
+        if (dropped) dropped_.fetch_add(dropped, std::memory_order_relaxed);
+
+        return toWrite;
+    }
+
+    // Downmix interleaved device frames (float32 / int16 / int24) straight into ring storage.
+    // Any channel count; returns frames written (<= numFrames).
+    size_t pushInterleavedToMono(const void* frames, SimdKernels::SampleFormat format, int numCh, int numFrames,
+        float gain = 1.0f) noexcept
+    {
+        if (frames == nullptr || numCh <= 0 || numFrames <= 0) return 0;
+
+        auto w = write_.load(std::memory_order_relaxed);
+        auto r = read_.load(std::memory_order_acquire);
+        size_t free = capacity_ - 1 - (w - r);
+        size_t toWrite = (size_t)std::min<int>(numFrames, (int)free);
+
+        const float g = gain / (float)numCh;
+        const size_t idx = w & mask_;
+        const size_t first = std::min(toWrite, capacity_ - idx);
+        SimdKernels::downmixInterleaved(frames, format, numCh, 0, buffer_.data() + idx, (int)first, g);
+        if (toWrite > first)
+            SimdKernels::downmixInterleaved(frames, format, numCh, (int)first, buffer_.data(), (int)(toWrite - first), g);
+
+        write_.store(w + toWrite, std::memory_order_release);
+        notifyIfWatermarkReached(w + toWrite);
+
+        size_t dropped = (size_t)std::max<int>(0, numFrames - (int)toWrite);
+        if (dropped) dropped_.fetch_add(dropped, std::memory_order_relaxed);
+
+        return toWrite;
+    }
+
+    // Push numSamples zeros (silent device packets keep the stream clock running)
+    size_t pushSilence(int numSamples) noexcept
+    {
+        if (numSamples <= 0) return 0;
+
+        auto w = write_.load(std::memory_order_relaxed);
+        auto r = read_.load(std::memory_order_acquire);
+        size_t free = capacity_ - 1 - (w - r);
+        size_t toWrite = (size_t)std::min<int>(numSamples, (int)free);
+
+        const size_t idx = w & mask_;
+        const size_t first = std::min(toWrite, capacity_ - idx);
+        std::fill_n(buffer_.data() + idx, first, 0.0f);
+        std::fill_n(buffer_.data(), toWrite - first, 0.0f);
+
+        write_.store(w + toWrite, std::memory_order_release);
+        notifyIfWatermarkReached(w + toWrite);
 
         size_t dropped = (size_t)std::max<int>(0, numSamples - (int)toWrite);
         if (dropped) dropped_.fetch_add(dropped, std::memory_order_relaxed);
@@ -86,9 +156,74 @@ public:
         return toRead;
     }
 
+    // Consumer: zero-copy view of up to maxSamples readable samples.
+    // Spans stay valid until consume(); the producer never writes into them.
+    ReadSpans peek(size_t maxSamples) const noexcept
+    {
+        ReadSpans s;
+        auto r = read_.load(std::memory_order_relaxed);
+        auto w = write_.load(std::memory_order_acquire);
+        const size_t n = std::min((size_t)(w - r), maxSamples);
+
+        const size_t idx = r & mask_;
+        s.first = buffer_.data() + idx;
+        s.firstSize = std::min(n, capacity_ - idx);
+        s.second = buffer_.data();
+        s.secondSize = n - s.firstSize;
+        return s;
+    }
+
+    // Consumer: release samples obtained from peek()
+    void consume(size_t numSamples) noexcept
+    {
+        auto r = read_.load(std::memory_order_relaxed);
+        auto w = write_.load(std::memory_order_acquire);
+        read_.store(r + std::min(numSamples, (size_t)(w - r)), std::memory_order_release);
+    }
+
+    // Consumer: block until at least minSamples are readable, wakeConsumer() is
+    // called or timeoutMs elapses. Returns true when the watermark was reached.
+    bool waitForSamples(size_t minSamples, int timeoutMs)
+    {
+        minSamples = std::max<size_t>(1, std::min(minSamples, capacity_ - 1));
+
+        std::unique_lock<std::mutex> lk(waitMutex_);
+        watermark_.store(minSamples, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // A notify landing between the check and the wait is lost, but the watermark
+        // stays set, so the next push notifies again
+        const bool reached = waitCv_.wait_for(lk, std::chrono::milliseconds(timeoutMs), [&]
+            {
+                return size() >= minSamples || wakeRequested_.load(std::memory_order_relaxed);
+            });
+
+        watermark_.store(0, std::memory_order_relaxed);
+        wakeRequested_.store(false, std::memory_order_relaxed);
+        return reached && size() >= minSamples;
+    }
+
+    // Any thread: release a consumer blocked in waitForSamples (stop/reset)
+    void wakeConsumer() noexcept
+    {
+        wakeRequested_.store(true, std::memory_order_relaxed);
+        waitCv_.notify_one();
+    }
+
     size_t droppedSamples() const noexcept { return dropped_.load(std::memory_order_relaxed); }
 
 private:
+    void notifyIfWatermarkReached(size_t written) noexcept
+    {
+        // Pairs with the seq_cst watermark store so either the consumer sees the
+        // new write index or the producer sees the watermark. Only the consumer
+        // clears it: a notify that misses the wait is repeated on the next push.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const size_t want = watermark_.load(std::memory_order_relaxed);
+        if (want != 0 && written - read_.load(std::memory_order_relaxed) >= want)
+            waitCv_.notify_one();
+    }
+
     std::vector<float> buffer_;
     size_t capacity_ = 0;
     size_t mask_ = 0;
@@ -96,4 +231,10 @@ private:
     std::atomic<size_t> write_{ 0 };
     std::atomic<size_t> read_{ 0 };
     std::atomic<size_t> dropped_{ 0 };
+
+    // consumer wait (the mutex is only ever taken by the consumer)
+    std::atomic<size_t> watermark_{ 0 };   // 0 = no consumer waiting
+    std::atomic<bool>   wakeRequested_{ false };
+    std::mutex              waitMutex_;
+    std::condition_variable waitCv_;
 };
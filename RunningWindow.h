@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Fixed-capacity sliding window of floats with O(1) running mean / stddev.
+// Storage is contiguous and preallocated: push() never allocates, so it is
+// safe on real-time threads. Sums are re-synchronised once per capacity
+// pushes to bound floating-point drift (amortised O(1)).
+class RunningWindow
+{
+public:
+    explicit RunningWindow(int capacity = 1) { reset(capacity); }
+
+    // Allocates: call from constructors / non-RT code only
+    void reset(int capacity)
+    {
+        cap = std::max(1, capacity);
+        data.assign((size_t)cap, 0.0f);
+        clear();
+    }
+
+    void clear() noexcept
+    {
+        head = 0; count = 0; sinceResync = 0;
+        sum = 0.0; sumSq = 0.0;
+    }
+
+    void push(float v) noexcept
+    {
+        if (count == cap)
+        {
+            const double old = data[(size_t)head];
+            sum -= old;
+            sumSq -= old * old;
+        }
+        else
+            ++count;
+
+        data[(size_t)head] = v;
+        sum += v;
+        sumSq += (double)v * (double)v;
+        if (++head == cap) head = 0;
+
+        if (++sinceResync >= cap) resync();
+    }
+
+    int  size() const noexcept { return count; }
+    int  capacity() const noexcept { return cap; }
+    bool empty() const noexcept { return count == 0; }
+    bool full() const noexcept { return count == cap; }
+
+    float mean() const noexcept { return count > 0 ? (float)(sum / (double)count) : 0.0f; }
+
+    // Sample standard deviation (n - 1)
+    float stddev() const noexcept
+    {
+        if (count < 2) return 0.0f;
+        const double var = (sumSq - sum * sum / (double)count) / (double)(count - 1);
+        return var > 0.0 ? (float)std::sqrt(var) : 0.0f;
+    }
+
+    // i = 0 is the oldest sample
+    float operator[](int i) const noexcept
+    {
+        int idx = head - count + i;
+        if (idx < 0) idx += cap;
+        return data[(size_t)idx];
+    }
+
+    // Copy oldest-first into dst (size() floats, at most two memcpys)
+    void copyTo(float* dst) const noexcept
+    {
+        const int start = (head - count + cap) % cap;
+        const int first = std::min(count, cap - start);
+        std::memcpy(dst, data.data() + start, (size_t)first * sizeof(float));
+        if (count > first)
+            std::memcpy(dst + first, data.data(), (size_t)(count - first) * sizeof(float));
+    }
+
+private:
+    void resync() noexcept
+    {
+        double s = 0.0, s2 = 0.0;
+        for (int i = 0; i < count; ++i)
+        {
+            const double v = (*this)[i];
+            s += v; s2 += v * v;
+        }
+        sum = s; sumSq = s2;
+        sinceResync = 0;
+    }
+
+    std::vector<float> data;
+    int cap = 1, head = 0, count = 0, sinceResync = 0;
+    double sum = 0.0, sumSq = 0.0;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer / multi-reader sequence lock for small trivially-copyable values.
+// The writer never blocks; readers retry while a write is in flight. The payload
+// is kept in relaxed atomic words so there is no data race under the C++ model.
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+public:
+    SeqLock() noexcept { store(T{}); }
+    explicit SeqLock(const T& v) noexcept { store(v); }
+
+    // Writer side (one thread at a time)
+    void store(const T& v) noexcept
+    {
+        uint32_t w[numWords] = {};
+        std::memcpy(w, &v, sizeof(T));
+
+        const uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < numWords; ++i)
+            words[i].store(w[i], std::memory_order_relaxed);
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    // Reader side (any thread)
+    T load() const noexcept
+    {
+        uint32_t w[numWords];
+        for (;;)
+        {
+            const uint32_t s0 = seq.load(std::memory_order_acquire);
+            if (s0 & 1u) continue;   // write in progress
+            for (size_t i = 0; i < numWords; ++i)
+                w[i] = words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == s0) break;
+        }
+        T out;
+        std::memcpy(&out, w, sizeof(T));
+        return out;
+    }
+
+    // Number of completed stores (cheap change detection for pollers)
+    uint32_t version() const noexcept { return seq.load(std::memory_order_acquire) >> 1; }
+
+private:
+    static constexpr size_t numWords = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> seq{ 0 };
+    std::atomic<uint32_t> words[numWords];
+};
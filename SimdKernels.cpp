@@ -0,0 +1,649 @@
+#include "SimdKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if CANONKEY_SIMD && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define CANONKEY_SIMD_X86 1
+ #include <immintrin.h>
+ #if defined(_MSC_VER)
+  #include <intrin.h>
+ #else
+  #include <cpuid.h>
+ #endif
+#else
+ #define CANONKEY_SIMD_X86 0
+#endif
+
+#if CANONKEY_SIMD && (defined(__aarch64__) || defined(_M_ARM64))
+ #define CANONKEY_SIMD_NEON 1
+ #include <arm_neon.h>
+#else
+ #define CANONKEY_SIMD_NEON 0
+#endif
+
+// AVX2 bodies are compiled per function so the rest of the file stays SSE2
+#if CANONKEY_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+ #define CANONKEY_AVX2_FN __attribute__((target("avx2")))
+#else
+ #define CANONKEY_AVX2_FN
+#endif
+
+namespace
+{
+    // Cephes logf: log(m * 2^e) with m folded into [sqrt(0.5), sqrt(2))
+    constexpr float logP[9] = { 7.0376836292e-2f, -1.1514610310e-1f, 1.1676998740e-1f,
+                                -1.2420140846e-1f, 1.4249322787e-1f, -1.6668057665e-1f,
+                                 2.0000714765e-1f, -2.4999993993e-1f, 3.3333331174e-1f };
+    constexpr float sqrtHalf = 0.707106781186547524f;
+    constexpr float logQ1 = -2.12194440e-4f;
+    constexpr float logQ2 = 0.693359375f;
+
+    // x must be positive and normal (callers pass 1 + lambda * |.|)
+    inline float logPositive(float x) noexcept
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        int e = (int)(bits >> 23) - 126;
+        bits = (bits & 0x807FFFFFu) | 0x3F000000u;   // mantissa in [0.5, 1)
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+
+        const float t = m < sqrtHalf ? m : 0.0f;
+        if (m < sqrtHalf) e -= 1;
+        m = (m - 1.0f) + t;
+
+        const float z = m * m;
+        float y = logP[0];
+        for (int i = 1; i < 9; ++i) y = y * m + logP[i];
+        y = y * m * z;
+
+        const float fe = (float)e;
+        y = y + fe * logQ1;
+        y = y - 0.5f * z;
+        return (m + y) + fe * logQ2;
+    }
+
+    // Raw (unscaled) interleaved sample; int24 is sign-extended from three bytes
+    inline float rawSample(const uint8_t* p, SimdKernels::SampleFormat f) noexcept
+    {
+        switch (f)
+        {
+            case SimdKernels::SampleFormat::float32: { float v; std::memcpy(&v, p, 4); return v; }
+            case SimdKernels::SampleFormat::int16:   { int16_t v; std::memcpy(&v, p, 2); return (float)v; }
+            default: break;
+        }
+        const int32_t v = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8;
+        return (float)v;
+    }
+
+    inline float formatScale(SimdKernels::SampleFormat f) noexcept
+    {
+        return f == SimdKernels::SampleFormat::float32 ? 1.0f
+             : f == SimdKernels::SampleFormat::int16 ? 1.0f / 32768.0f : 1.0f / 8388608.0f;
+    }
+
+   #if CANONKEY_SIMD_X86
+    bool detectAvx2() noexcept
+    {
+       #if defined(_MSC_VER)
+        int r[4];
+        __cpuid(r, 0);
+        if (r[0] < 7) return false;
+        __cpuid(r, 1);
+        if ((r[2] & (1 << 27)) == 0 || (r[2] & (1 << 28)) == 0) return false;   // OSXSAVE, AVX
+        if ((_xgetbv(0) & 6) != 6) return false;                                 // OS saves YMM
+        __cpuidex(r, 7, 0);
+        return (r[1] & (1 << 5)) != 0;
+       #else
+        unsigned a = 0, b = 0, c = 0, d = 0;
+        if (!__get_cpuid(1, &a, &b, &c, &d)) return false;
+        if ((c & bit_OSXSAVE) == 0 || (c & bit_AVX) == 0) return false;
+        unsigned lo = 0, hi = 0;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        if ((lo & 6) != 6) return false;
+        if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) return false;
+        return (b & bit_AVX2) != 0;
+       #endif
+    }
+
+    inline bool useAvx2() noexcept
+    {
+        static const bool avx2 = detectAvx2();
+        return avx2;
+    }
+
+    //==============================================================================
+    namespace sse2
+    {
+        inline float hsum(__m128 v) noexcept
+        {
+            __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+            s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+            return _mm_cvtss_f32(s);
+        }
+
+        inline __m128 logPositive(__m128 x) noexcept
+        {
+            const __m128i xi = _mm_castps_si128(x);
+            __m128i e = _mm_sub_epi32(_mm_srli_epi32(xi, 23), _mm_set1_epi32(126));
+            __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(xi, _mm_set1_epi32(0x807FFFFF)),
+                _mm_set1_epi32(0x3F000000)));
+
+            const __m128 lt = _mm_cmplt_ps(m, _mm_set1_ps(sqrtHalf));
+            e = _mm_add_epi32(e, _mm_castps_si128(lt));   // lanes set to -1 step down
+            m = _mm_add_ps(_mm_sub_ps(m, _mm_set1_ps(1.0f)), _mm_and_ps(m, lt));
+
+            const __m128 z = _mm_mul_ps(m, m);
+            __m128 y = _mm_set1_ps(logP[0]);
+            for (int i = 1; i < 9; ++i)
+                y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(logP[i]));
+            y = _mm_mul_ps(_mm_mul_ps(y, m), z);
+
+            const __m128 fe = _mm_cvtepi32_ps(e);
+            y = _mm_add_ps(y, _mm_mul_ps(fe, _mm_set1_ps(logQ1)));
+            y = _mm_sub_ps(y, _mm_mul_ps(_mm_set1_ps(0.5f), z));
+            return _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(fe, _mm_set1_ps(logQ2)));
+        }
+
+        int magnitude(const float* x, float* mag, int n) noexcept
+        {
+            int k = 0;
+            for (; k + 4 <= n; k += 4)
+            {
+                const __m128 a = _mm_loadu_ps(x + 2 * k);
+                const __m128 b = _mm_loadu_ps(x + 2 * k + 4);
+                const __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                const __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(mag + k, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im))));
+            }
+            return k;
+        }
+
+        int log1pScaled(const float* in, float* out, int n, float lambda) noexcept
+        {
+            const __m128 one = _mm_set1_ps(1.0f), l = _mm_set1_ps(lambda);
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+                _mm_storeu_ps(out + i, logPositive(_mm_add_ps(one, _mm_mul_ps(l, _mm_loadu_ps(in + i)))));
+            return i;
+        }
+
+        float dot(const float* a, const float* b, int n, int& done) noexcept
+        {
+            __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+            int i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+                acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+            }
+            for (; i + 4 <= n; i += 4)
+                acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            done = i;
+            return hsum(_mm_add_ps(acc0, acc1));
+        }
+
+        int multiply(const float* a, const float* b, float* out, int n) noexcept
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+                _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            return i;
+        }
+
+        int downmix(const float* const* ch, int numCh, int start, float* out, int n, float gain) noexcept
+        {
+            const __m128 g = _mm_set1_ps(gain);
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m128 s = _mm_loadu_ps(ch[0] + start + i);
+                for (int c = 1; c < numCh; ++c)
+                    s = _mm_add_ps(s, _mm_loadu_ps(ch[c] + start + i));
+                _mm_storeu_ps(out + i, _mm_mul_ps(s, g));
+            }
+            return i;
+        }
+
+        // Stereo float32 / int16 only (the WASAPI shared-mode cases); others fall to scalar
+        int downmixInterleaved(const uint8_t* p, SimdKernels::SampleFormat f, int numCh, float* out, int n, float gain) noexcept
+        {
+            if (numCh != 2) return 0;
+            const __m128 g = _mm_set1_ps(gain);
+            int i = 0;
+            if (f == SimdKernels::SampleFormat::float32)
+            {
+                const float* x = reinterpret_cast<const float*> (p);
+                for (; i + 4 <= n; i += 4)
+                {
+                    const __m128 a = _mm_loadu_ps(x + 2 * i);
+                    const __m128 b = _mm_loadu_ps(x + 2 * i + 4);
+                    const __m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                    const __m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+                    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(l, r), g));
+                }
+            }
+            else if (f == SimdKernels::SampleFormat::int16)
+            {
+                const __m128i ones = _mm_set1_epi16(1);
+                for (; i + 4 <= n; i += 4)
+                {
+                    // madd sums each L/R pair into one int32
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*> (p + 4 * i));
+                    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_madd_epi16(v, ones)), g));
+                }
+            }
+            return i;
+        }
+
+        float maxValue(const float* x, int n, int& done) noexcept
+        {
+            if (n < 4) { done = 0; return x[0]; }
+            __m128 m = _mm_loadu_ps(x);
+            int i = 4;
+            for (; i + 4 <= n; i += 4)
+                m = _mm_max_ps(m, _mm_loadu_ps(x + i));
+            m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+            m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+            done = i;
+            return _mm_cvtss_f32(m);
+        }
+
+        float absMaxValue(const float* x, int n, int& done) noexcept
+        {
+            const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+            __m128 m = _mm_setzero_ps();
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+                m = _mm_max_ps(m, _mm_and_ps(_mm_loadu_ps(x + i), absMask));
+            m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+            m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+            done = i;
+            return _mm_cvtss_f32(m);
+        }
+    }
+
+    //==============================================================================
+    namespace avx2
+    {
+        CANONKEY_AVX2_FN inline __m256 logPositive(__m256 x) noexcept
+        {
+            const __m256i xi = _mm256_castps_si256(x);
+            __m256i e = _mm256_sub_epi32(_mm256_srli_epi32(xi, 23), _mm256_set1_epi32(126));
+            __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(xi, _mm256_set1_epi32(0x807FFFFF)),
+                _mm256_set1_epi32(0x3F000000)));
+
+            const __m256 lt = _mm256_cmp_ps(m, _mm256_set1_ps(sqrtHalf), _CMP_LT_OQ);
+            e = _mm256_add_epi32(e, _mm256_castps_si256(lt));
+            m = _mm256_add_ps(_mm256_sub_ps(m, _mm256_set1_ps(1.0f)), _mm256_and_ps(m, lt));
+
+            const __m256 z = _mm256_mul_ps(m, m);
+            __m256 y = _mm256_set1_ps(logP[0]);
+            for (int i = 1; i < 9; ++i)
+                y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(logP[i]));
+            y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+
+            const __m256 fe = _mm256_cvtepi32_ps(e);
+            y = _mm256_add_ps(y, _mm256_mul_ps(fe, _mm256_set1_ps(logQ1)));
+            y = _mm256_sub_ps(y, _mm256_mul_ps(_mm256_set1_ps(0.5f), z));
+            return _mm256_add_ps(_mm256_add_ps(m, y), _mm256_mul_ps(fe, _mm256_set1_ps(logQ2)));
+        }
+
+        CANONKEY_AVX2_FN int magnitude(const float* x, float* mag, int n) noexcept
+        {
+            int k = 0;
+            for (; k + 8 <= n; k += 8)
+            {
+                const __m256 a = _mm256_loadu_ps(x + 2 * k);
+                const __m256 b = _mm256_loadu_ps(x + 2 * k + 8);
+                // In-lane shuffles give bins [0 1 4 5 | 2 3 6 7]; fix the order after sqrt
+                const __m256 re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                const __m256 im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+                const __m256 r = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(re, re), _mm256_mul_ps(im, im)));
+                _mm256_storeu_ps(mag + k, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0))));
+            }
+            return k;
+        }
+
+        CANONKEY_AVX2_FN int log1pScaled(const float* in, float* out, int n, float lambda) noexcept
+        {
+            const __m256 one = _mm256_set1_ps(1.0f), l = _mm256_set1_ps(lambda);
+            int i = 0;
+            for (; i + 8 <= n; i += 8)
+                _mm256_storeu_ps(out + i, logPositive(_mm256_add_ps(one, _mm256_mul_ps(l, _mm256_loadu_ps(in + i)))));
+            return i;
+        }
+
+        CANONKEY_AVX2_FN float dot(const float* a, const float* b, int n, int& done) noexcept
+        {
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+            int i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+                acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+            }
+            for (; i + 8 <= n; i += 8)
+                acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            const __m256 s = _mm256_add_ps(acc0, acc1);
+            done = i;
+            return sse2::hsum(_mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1)));
+        }
+
+        CANONKEY_AVX2_FN int multiply(const float* a, const float* b, float* out, int n) noexcept
+        {
+            int i = 0;
+            for (; i + 8 <= n; i += 8)
+                _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            return i;
+        }
+
+        CANONKEY_AVX2_FN int downmix(const float* const* ch, int numCh, int start, float* out, int n, float gain) noexcept
+        {
+            const __m256 g = _mm256_set1_ps(gain);
+            int i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256 s = _mm256_loadu_ps(ch[0] + start + i);
+                for (int c = 1; c < numCh; ++c)
+                    s = _mm256_add_ps(s, _mm256_loadu_ps(ch[c] + start + i));
+                _mm256_storeu_ps(out + i, _mm256_mul_ps(s, g));
+            }
+            return i;
+        }
+    }
+   #endif // CANONKEY_SIMD_X86
+
+   #if CANONKEY_SIMD_NEON
+    //==============================================================================
+    namespace neon
+    {
+        inline float32x4_t logPositive(float32x4_t x) noexcept
+        {
+            const uint32x4_t xi = vreinterpretq_u32_f32(x);
+            int32x4_t e = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(xi, 23)), vdupq_n_s32(126));
+            float32x4_t m = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(xi, vdupq_n_u32(0x807FFFFFu)), vdupq_n_u32(0x3F000000u)));
+
+            const uint32x4_t lt = vcltq_f32(m, vdupq_n_f32(sqrtHalf));
+            e = vaddq_s32(e, vreinterpretq_s32_u32(lt));
+            m = vaddq_f32(vsubq_f32(m, vdupq_n_f32(1.0f)), vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(m), lt)));
+
+            const float32x4_t z = vmulq_f32(m, m);
+            float32x4_t y = vdupq_n_f32(logP[0]);
+            for (int i = 1; i < 9; ++i)
+                y = vaddq_f32(vmulq_f32(y, m), vdupq_n_f32(logP[i]));
+            y = vmulq_f32(vmulq_f32(y, m), z);
+
+            const float32x4_t fe = vcvtq_f32_s32(e);
+            y = vaddq_f32(y, vmulq_f32(fe, vdupq_n_f32(logQ1)));
+            y = vsubq_f32(y, vmulq_f32(vdupq_n_f32(0.5f), z));
+            return vaddq_f32(vaddq_f32(m, y), vmulq_f32(fe, vdupq_n_f32(logQ2)));
+        }
+
+        int magnitude(const float* x, float* mag, int n) noexcept
+        {
+            int k = 0;
+            for (; k + 4 <= n; k += 4)
+            {
+                const float32x4x2_t c = vld2q_f32(x + 2 * k);   // de-interleaves re / im
+                vst1q_f32(mag + k, vsqrtq_f32(vaddq_f32(vmulq_f32(c.val[0], c.val[0]), vmulq_f32(c.val[1], c.val[1]))));
+            }
+            return k;
+        }
+
+        int log1pScaled(const float* in, float* out, int n, float lambda) noexcept
+        {
+            const float32x4_t one = vdupq_n_f32(1.0f), l = vdupq_n_f32(lambda);
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+                vst1q_f32(out + i, logPositive(vaddq_f32(one, vmulq_f32(l, vld1q_f32(in + i)))));
+            return i;
+        }
+
+        float dot(const float* a, const float* b, int n, int& done) noexcept
+        {
+            float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+            int i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                acc0 = vaddq_f32(acc0, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+                acc1 = vaddq_f32(acc1, vmulq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4)));
+            }
+            for (; i + 4 <= n; i += 4)
+                acc0 = vaddq_f32(acc0, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+            done = i;
+            return vaddvq_f32(vaddq_f32(acc0, acc1));
+        }
+
+        int multiply(const float* a, const float* b, float* out, int n) noexcept
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+                vst1q_f32(out + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+            return i;
+        }
+
+        int downmix(const float* const* ch, int numCh, int start, float* out, int n, float gain) noexcept
+        {
+            const float32x4_t g = vdupq_n_f32(gain);
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                float32x4_t s = vld1q_f32(ch[0] + start + i);
+                for (int c = 1; c < numCh; ++c)
+                    s = vaddq_f32(s, vld1q_f32(ch[c] + start + i));
+                vst1q_f32(out + i, vmulq_f32(s, g));
+            }
+            return i;
+        }
+
+        int downmixInterleaved(const uint8_t* p, SimdKernels::SampleFormat f, int numCh, float* out, int n, float gain) noexcept
+        {
+            if (numCh != 2) return 0;
+            const float32x4_t g = vdupq_n_f32(gain);
+            int i = 0;
+            if (f == SimdKernels::SampleFormat::float32)
+            {
+                const float* x = reinterpret_cast<const float*> (p);
+                for (; i + 4 <= n; i += 4)
+                {
+                    const float32x4x2_t c = vld2q_f32(x + 2 * i);
+                    vst1q_f32(out + i, vmulq_f32(vaddq_f32(c.val[0], c.val[1]), g));
+                }
+            }
+            else if (f == SimdKernels::SampleFormat::int16)
+            {
+                const int16_t* x = reinterpret_cast<const int16_t*> (p);
+                for (; i + 4 <= n; i += 4)
+                {
+                    const int16x4x2_t c = vld2_s16(x + 2 * i);
+                    vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vaddl_s16(c.val[0], c.val[1])), g));
+                }
+            }
+            return i;
+        }
+
+        float maxValue(const float* x, int n, int& done) noexcept
+        {
+            if (n < 4) { done = 0; return x[0]; }
+            float32x4_t m = vld1q_f32(x);
+            int i = 4;
+            for (; i + 4 <= n; i += 4)
+                m = vmaxq_f32(m, vld1q_f32(x + i));
+            done = i;
+            return vmaxvq_f32(m);
+        }
+
+        float absMaxValue(const float* x, int n, int& done) noexcept
+        {
+            float32x4_t m = vdupq_n_f32(0.0f);
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+                m = vmaxq_f32(m, vabsq_f32(vld1q_f32(x + i)));
+            done = i;
+            return vmaxvq_f32(m);
+        }
+    }
+   #endif // CANONKEY_SIMD_NEON
+}
+
+namespace SimdKernels
+{
+    void magnitude(const float* x, float* mag, int n) noexcept
+    {
+        int k = 0;
+       #if CANONKEY_SIMD_X86
+        k = useAvx2() ? avx2::magnitude(x, mag, n) : sse2::magnitude(x, mag, n);
+       #elif CANONKEY_SIMD_NEON
+        k = neon::magnitude(x, mag, n);
+       #endif
+        for (; k < n; ++k)
+        {
+            const float re = x[2 * k];
+            const float im = x[2 * k + 1];
+            mag[k] = std::sqrt(re * re + im * im);
+        }
+    }
+
+    void log1pScaled(const float* in, float* out, int n, float lambda) noexcept
+    {
+        int i = 0;
+       #if CANONKEY_SIMD_X86
+        i = useAvx2() ? avx2::log1pScaled(in, out, n, lambda) : sse2::log1pScaled(in, out, n, lambda);
+       #elif CANONKEY_SIMD_NEON
+        i = neon::log1pScaled(in, out, n, lambda);
+       #endif
+        for (; i < n; ++i)
+            out[i] = logPositive(1.0f + lambda * in[i]);
+    }
+
+    float dot(const float* a, const float* b, int n) noexcept
+    {
+        float s = 0.0f;
+        int i = 0;
+       #if CANONKEY_SIMD_X86
+        s = useAvx2() ? avx2::dot(a, b, n, i) : sse2::dot(a, b, n, i);
+       #elif CANONKEY_SIMD_NEON
+        s = neon::dot(a, b, n, i);
+       #endif
+        for (; i < n; ++i)
+            s += a[i] * b[i];
+        return s;
+    }
+
+    void multiply(const float* a, const float* b, float* out, int n) noexcept
+    {
+        int i = 0;
+       #if CANONKEY_SIMD_X86
+        i = useAvx2() ? avx2::multiply(a, b, out, n) : sse2::multiply(a, b, out, n);
+       #elif CANONKEY_SIMD_NEON
+        i = neon::multiply(a, b, out, n);
+       #endif
+        for (; i < n; ++i)
+            out[i] = a[i] * b[i];
+    }
+
+    void downmix(const float* const* channels, int numChannels, int start, float* out, int numSamples, float gain) noexcept
+    {
+        if (numChannels <= 0 || numSamples <= 0) return;
+
+        int i = 0;
+       #if CANONKEY_SIMD_X86
+        i = useAvx2() ? avx2::downmix(channels, numChannels, start, out, numSamples, gain)
+                      : sse2::downmix(channels, numChannels, start, out, numSamples, gain);
+       #elif CANONKEY_SIMD_NEON
+        i = neon::downmix(channels, numChannels, start, out, numSamples, gain);
+       #endif
+        for (; i < numSamples; ++i)
+        {
+            float s = channels[0][start + i];
+            for (int c = 1; c < numChannels; ++c)
+                s += channels[c][start + i];
+            out[i] = s * gain;
+        }
+    }
+
+    void downmixInterleaved(const void* frames, SampleFormat format, int numChannels, int startFrame,
+        float* out, int numFrames, float gain) noexcept
+    {
+        if (frames == nullptr || numChannels <= 0 || numFrames <= 0) return;
+
+        const int frameBytes = numChannels * bytesPerSample(format);
+        const uint8_t* p = static_cast<const uint8_t*> (frames) + (size_t)startFrame * (size_t)frameBytes;
+        const float g = gain * formatScale(format);
+
+        int i = 0;
+       #if CANONKEY_SIMD_X86
+        i = sse2::downmixInterleaved(p, format, numChannels, out, numFrames, g);
+       #elif CANONKEY_SIMD_NEON
+        i = neon::downmixInterleaved(p, format, numChannels, out, numFrames, g);
+       #endif
+        const int sampleBytes = bytesPerSample(format);
+        for (; i < numFrames; ++i)
+        {
+            const uint8_t* f = p + (size_t)i * (size_t)frameBytes;
+            float s = 0.0f;
+            for (int c = 0; c < numChannels; ++c)
+                s += rawSample(f + c * sampleBytes, format);
+            out[i] = s * g;
+        }
+    }
+
+    float absMaxInterleaved(const void* frames, SampleFormat format, int numChannels, int channel,
+        int numFrames) noexcept
+    {
+        if (frames == nullptr || channel < 0 || channel >= numChannels) return 0.0f;
+
+        const int sampleBytes = bytesPerSample(format);
+        const size_t frameBytes = (size_t)(numChannels * sampleBytes);
+        const uint8_t* p = static_cast<const uint8_t*> (frames) + channel * sampleBytes;
+
+        float m = 0.0f;
+        for (int i = 0; i < numFrames; ++i)
+            m = std::max(m, std::abs(rawSample(p + (size_t)i * frameBytes, format)));
+        return m * formatScale(format);
+    }
+
+    float maxValue(const float* x, int n) noexcept
+    {
+        if (n <= 0) return 0.0f;
+
+        float m = x[0];
+        int i = 0;
+       #if CANONKEY_SIMD_X86
+        m = sse2::maxValue(x, n, i);
+       #elif CANONKEY_SIMD_NEON
+        m = neon::maxValue(x, n, i);
+       #endif
+        for (; i < n; ++i)
+            if (x[i] > m) m = x[i];
+        return m;
+    }
+
+    float absMaxValue(const float* x, int n) noexcept
+    {
+        float m = 0.0f;
+        int i = 0;
+       #if CANONKEY_SIMD_X86
+        m = sse2::absMaxValue(x, n, i);
+       #elif CANONKEY_SIMD_NEON
+        m = neon::absMaxValue(x, n, i);
+       #endif
+        for (; i < n; ++i)
+            m = std::max(m, std::abs(x[i]));
+        return m;
+    }
+
+    const char* activeInstructionSet() noexcept
+    {
+       #if CANONKEY_SIMD_X86
+        return useAvx2() ? "avx2" : "sse2";
+       #elif CANONKEY_SIMD_NEON
+        return "neon";
+       #else
+        return "scalar";
+       #endif
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+// Vectorised inner loops for the analysis hot paths.
+// x86: SSE2 baseline plus AVX2 picked at runtime (CPUID), AArch64: NEON,
+// anything else: scalar. Build with CANONKEY_SIMD=0 to force the scalar
+// versions everywhere (reference results / benchmarking).
+// All kernels take unaligned pointers, never allocate and are RT-safe.
+#ifndef CANONKEY_SIMD
+ #define CANONKEY_SIMD 1
+#endif
+
+namespace SimdKernels
+{
+    // Interleaved PCM layouts accepted by downmixInterleaved (int24 = packed little-endian)
+    enum class SampleFormat { float32, int16, int24 };
+
+    constexpr int bytesPerSample(SampleFormat f) noexcept
+    {
+        return f == SampleFormat::float32 ? 4 : (f == SampleFormat::int16 ? 2 : 3);
+    }
+
+    // mag[k] = |X[k]| for numBins bins of an interleaved [Re0, Im0, Re1, Im1, ...] spectrum
+    void magnitude(const float* interleaved, float* mag, int numBins) noexcept;
+
+    // out[i] = log(1 + lambda * in[i]) for in >= 0 (Cephes polynomial, abs error < 1e-6)
+    void log1pScaled(const float* in, float* out, int n, float lambda) noexcept;
+
+    // sum a[i] * b[i]
+    float dot(const float* a, const float* b, int n) noexcept;
+
+    // out[i] = a[i] * b[i]
+    void multiply(const float* a, const float* b, float* out, int n) noexcept;
+
+    // out[i] = gain * sum_c channels[c][start + i]
+    void downmix(const float* const* channels, int numChannels, int start,
+        float* out, int numSamples, float gain) noexcept;
+
+    // out[i] = gain * sum_c frame[startFrame + i][c], integer formats scaled to [-1, 1)
+    void downmixInterleaved(const void* frames, SampleFormat format, int numChannels, int startFrame,
+        float* out, int numFrames, float gain) noexcept;
+
+    // max(|frame[i][channel]|) over numFrames interleaved frames (peak meters)
+    float absMaxInterleaved(const void* frames, SampleFormat format, int numChannels, int channel,
+        int numFrames) noexcept;
+
+    // max(x[0..n)), 0 for n <= 0
+    float maxValue(const float* x, int n) noexcept;
+
+    // max(|x[0..n)|), 0 for n <= 0 (peak meters)
+    float absMaxValue(const float* x, int n) noexcept;
+
+    // "avx2", "sse2", "neon" or "scalar"
+    const char* activeInstructionSet() noexcept;
+}
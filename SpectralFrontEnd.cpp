@@ -0,0 +1,189 @@
+#include "SpectralFrontEnd.h"
+#include "SimdKernels.h"
+#include "AnalysisTables.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <cmath>
+
+static constexpr int decimationChunk = 1024;   // decimated samples per processDecimated() call
+
+SpectralFrontEnd::Resolution::Resolution(int order, int hopSize)
+    : fftOrder(order),
+    fftSize(1 << order),
+    hop(juce::jlimit(1, 1 << order, hopSize)),
+    fft(order),
+    window(AnalysisTables::getHannWindow(1 << order))
+{
+    fftBuf.assign((size_t)(2 * fftSize), 0.0f);
+    mag.assign((size_t)(fftSize / 2 + 1), 0.0f);
+    nextFrameEnd = fftSize;
+}
+
+void SpectralFrontEnd::addConsumer(Consumer& c, int fftOrder, int hop)
+{
+    fftOrder = juce::jlimit(4, 16, fftOrder);
+
+    Resolution* target = nullptr;
+    for (auto& r : resolutions)
+        if (r->fftOrder == fftOrder && r->hop == hop)
+            target = r.get();
+
+    if (target == nullptr)
+    {
+        resolutions.push_back(std::make_unique<Resolution>(fftOrder, hop));
+        target = resolutions.back().get();
+
+        // Grow history to hold the largest frame
+        size_t cap = 256;
+        while (cap < (size_t)target->fftSize) cap <<= 1;
+        if (cap > history.size())
+        {
+            history.assign(cap, 0.0f);
+            histMask = cap - 1;
+        }
+        reset();
+    }
+
+    if (std::find(target->consumers.begin(), target->consumers.end(), &c) == target->consumers.end())
+        target->consumers.push_back(&c);
+}
+
+void SpectralFrontEnd::setDecimation(int factor)
+{
+    factor = juce::jmax(1, factor);
+    if (factor == decimator.getFactor()) return;
+
+    decimator = PolyphaseDecimator(factor);
+    decimated.assign(factor > 1 ? (size_t)decimationChunk : 0u, 0.0f);
+    reset();
+}
+
+void SpectralFrontEnd::setFrameStride(const Consumer& c, int stride) noexcept
+{
+    for (auto& r : resolutions)
+        if (std::find(r->consumers.begin(), r->consumers.end(), &c) != r->consumers.end())
+            r->stride = juce::jlimit(1, 64, stride);
+}
+
+void SpectralFrontEnd::setSilenceGate(bool enabled, float thresholdDb) noexcept
+{
+    gateLevel = enabled ? juce::jmax(1.0e-9f, juce::Decibels::decibelsToGain(thresholdDb, -200.0f)) : 0.0f;
+    loudEnd = totalSamples;   // what is already buffered was never checked
+    quietInputs = 0;
+}
+
+int SpectralFrontEnd::getSmallestHop() const noexcept
+{
+    int h = 0;
+    for (auto& r : resolutions)
+        h = (h == 0) ? r->hop : std::min(h, r->hop);
+    return h * decimator.getFactor();
+}
+
+void SpectralFrontEnd::reset() noexcept
+{
+    decimator.reset();
+    std::fill(history.begin(), history.end(), 0.0f);
+    totalSamples = 0;
+    loudEnd = 0;
+    quietInputs = 0;
+    for (auto& r : resolutions)
+        r->nextFrameEnd = r->fftSize;
+}
+
+void SpectralFrontEnd::processMono(const float* samples, int numSamples) noexcept
+{
+    if (!samples || numSamples <= 0 || resolutions.empty()) return;
+
+    if (decimator.getFactor() == 1)
+    {
+        processDecimated(samples, numSamples);
+        return;
+    }
+
+    // Chunks sized so the decimator output always fits the preallocated scratch
+    const int maxIn = decimationChunk * decimator.getFactor() - decimator.getFactor();
+    for (int idx = 0; idx < numSamples;)
+    {
+        const int n = std::min(maxIn, numSamples - idx);
+
+        // Gated silence skips the filter too, once its tail has left the history
+        const bool quiet = gateLevel > 0.0f && SimdKernels::absMaxValue(samples + idx, n) < gateLevel;
+        const int produced = quiet && quietInputs >= decimator.getNumTaps()
+            ? decimator.processSilence(n, decimated.data())
+            : decimator.process(samples + idx, n, decimated.data());
+        quietInputs = quiet ? quietInputs + n : 0;
+        if (produced > 0) processDecimated(decimated.data(), produced);
+        idx += n;
+    }
+}
+
+void SpectralFrontEnd::processDecimated(const float* samples, int numSamples) noexcept
+{
+    int idx = 0;
+    while (idx < numSamples)
+    {
+        // Copy only up to the next frame boundary of any resolution
+        juce::int64 nextEnd = resolutions.front()->nextFrameEnd;
+        for (auto& r : resolutions)
+            nextEnd = std::min(nextEnd, r->nextFrameEnd);
+
+        const int take = (int)std::min<juce::int64>((juce::int64)(numSamples - idx), nextEnd - totalSamples);
+
+        // Write into circular history (at most two segments)
+        const size_t w = (size_t)totalSamples & histMask;
+        const size_t first = std::min((size_t)take, history.size() - w);
+        std::memcpy(history.data() + w, samples + idx, first * sizeof(float));
+        if ((size_t)take > first)
+            std::memcpy(history.data(), samples + idx + first, ((size_t)take - first) * sizeof(float));
+
+        if (gateLevel > 0.0f && SimdKernels::absMaxValue(samples + idx, take) >= gateLevel)
+            loudEnd = totalSamples + take;
+
+        totalSamples += take;
+        idx += take;
+
+        for (auto& r : resolutions)
+        {
+            if (totalSamples == r->nextFrameEnd)
+            {
+                // Nothing reached the gate since the window started
+                if (gateLevel > 0.0f && loudEnd <= totalSamples - r->fftSize)
+                    skipFrame(*r);
+                else
+                    computeFrame(*r);
+                r->nextFrameEnd += (juce::int64)r->hop * r->stride;
+            }
+        }
+    }
+}
+
+void SpectralFrontEnd::computeFrame(Resolution& r) noexcept
+{
+    {
+        Telemetry::ScopedStage timer(Telemetry::Stage::stft);
+
+        // Window the most recent fftSize samples into the FFT buffer (history wraps at most once)
+        const size_t start = (size_t)(totalSamples - r.fftSize) & histMask;
+        const int first = (int)std::min((size_t)r.fftSize, history.size() - start);
+        float* buf = r.fftBuf.data();
+        const float* window = r.window->data();
+        SimdKernels::multiply(history.data() + start, window, buf, first);
+        SimdKernels::multiply(history.data(), window + first, buf + first, r.fftSize - first);
+
+        r.fft.performRealOnlyForwardTransform(buf, true);
+
+        // JUCE real FFT output: interleaved [Re0, Im0, Re1, Im1, ... Re(N/2), Im(N/2)]
+        SimdKernels::magnitude(buf, r.mag.data(), r.fftSize / 2 + 1);
+    }
+
+    for (auto* c : r.consumers)
+        c->processSpectrum(r.mag);
+}
+
+void SpectralFrontEnd::skipFrame(Resolution& r) noexcept
+{
+    Telemetry::increment(Telemetry::Counter::silentFrames);
+    for (auto* c : r.consumers)
+        c->processSilentFrame();
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+#include <memory>
+#include "PolyphaseDecimator.h"
+
+// Shared STFT front-end.
+// Buffers the mono stream once and computes one Hann-windowed magnitude
+// spectrum per registered resolution (fftOrder + hop). Consumers that ask for
+// the same resolution share the transform; spectra are handed out by const ref.
+// Optionally decimates the stream first; fftOrder / hop are then in decimated samples.
+// Windows come from AnalysisTables, shared with every other front-end; each resolution
+// owns its FFT engine, so chains can run on any thread.
+class SpectralFrontEnd
+{
+public:
+    class Consumer
+    {
+    public:
+        virtual ~Consumer() = default;
+
+        // mag holds fftSize/2 + 1 linear magnitudes, valid only for the call
+        virtual void processSpectrum(const std::vector<float>& mag) = 0;
+
+        // Called instead when the silence gate skipped the frame (no spectrum).
+        // Default: ignore it, so the consumer's state is frozen across the gap.
+        virtual void processSilentFrame() {}
+    };
+
+    SpectralFrontEnd() = default;
+
+    // Downsample by factor before the history (1 = off). Allocates: call before streaming.
+    void setDecimation(int factor);
+    int getDecimation() const noexcept { return decimator.getFactor(); }
+    // Input sample aligned with decimated sample m: m * getDecimation() + getDecimationOffset()
+    double getDecimationOffset() const noexcept { return decimator.getOutputOffset(); }
+
+    // Register a consumer for frames of 2^fftOrder samples every hop samples.
+    // Allocates: call before streaming, never from the audio thread.
+    void addConsumer(Consumer& c, int fftOrder, int hop);
+
+    // Compute only every stride-th frame of c's resolution (1 = every hop): the same
+    // window, a longer hop for every consumer sharing it. RT-safe, streaming thread.
+    void setFrameStride(const Consumer& c, int stride) noexcept;
+
+    // Silence gate: frames whose whole window peaks below thresholdDb (dBFS) skip the
+    // transform and reach consumers as processSilentFrame(). Off by default. RT-safe.
+    void setSilenceGate(bool enabled, float thresholdDb = -60.0f) noexcept;
+    bool isSilenceGateEnabled() const noexcept { return gateLevel > 0.0f; }
+
+    // Drop stream history (keeps FFT plans, windows and consumers)
+    void reset() noexcept;
+
+    // Feed time-domain mono samples (any block size)
+    void processMono(const float* samples, int numSamples) noexcept;
+
+    int getNumResolutions() const noexcept { return (int)resolutions.size(); }
+
+    // Smallest registered hop in input samples (between two consecutive frames), 0 if none
+    int getSmallestHop() const noexcept;
+
+private:
+    struct Resolution
+    {
+        Resolution(int order, int hopSize);
+
+        int fftOrder, fftSize, hop;
+        int stride = 1;                // frames advance by hop * stride
+        juce::dsp::FFT fft;
+        std::shared_ptr<const std::vector<float>> window;   // AnalysisTables
+        std::vector<float> fftBuf;     // 2*fftSize for in-place JUCE real FFT
+        std::vector<float> mag;        // fftSize/2 + 1
+        std::vector<Consumer*> consumers;
+        juce::int64 nextFrameEnd = 0;  // stream position that completes the next frame
+    };
+
+    void processDecimated(const float* samples, int numSamples) noexcept;
+    void computeFrame(Resolution& r) noexcept;
+    void skipFrame(Resolution& r) noexcept;
+
+    PolyphaseDecimator decimator;
+    std::vector<float> decimated;      // scratch for one chunk of decimator output
+
+    std::vector<std::unique_ptr<Resolution>> resolutions;
+
+    // Circular history, power-of-two sized to the largest frame
+    std::vector<float> history;
+    size_t histMask = 0;
+    juce::int64 totalSamples = 0;
+
+    // Silence gate: chunk peaks are checked as they are buffered
+    float gateLevel = 0.0f;            // linear peak, 0 = off
+    juce::int64 loudEnd = 0;           // stream position just past the last chunk at or above gateLevel
+    juce::int64 quietInputs = 0;       // input samples since the last chunk at or above gateLevel
+};
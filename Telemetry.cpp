@@ -0,0 +1,262 @@
+#include "Telemetry.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+    // Log-linear histogram: 8 buckets per power of two (bucket width <= 12.5% of its value),
+    // exact below 8 ns, everything past ~2^38 ns in the last bucket
+    constexpr int subBits = 3;
+    constexpr int subBuckets = 1 << subBits;
+    constexpr int maxOctave = 38;
+    constexpr int numBuckets = subBuckets * (maxOctave - subBits + 2);
+
+    inline int highestBit(uint64_t v) noexcept
+    {
+       #if defined(_MSC_VER)
+        unsigned long i = 0;
+        _BitScanReverse64(&i, v);
+        return (int)i;
+       #else
+        return 63 - __builtin_clzll(v);
+       #endif
+    }
+
+    inline int bucketOf(uint64_t ns) noexcept
+    {
+        if (ns < (uint64_t)subBuckets) return (int)ns;
+        const int top = highestBit(ns);
+        if (top > maxOctave) return numBuckets - 1;
+        return subBuckets * (top - subBits + 1) + (int)((ns >> (top - subBits)) & (subBuckets - 1));
+    }
+
+    // Centre of a bucket in ns
+    inline double bucketValue(int idx) noexcept
+    {
+        if (idx < subBuckets) return (double)idx;
+        const int octave = idx / subBuckets + subBits - 1;
+        const int sub = idx % subBuckets;
+        const double width = std::ldexp(1.0, octave - subBits);
+        return ((double)(subBuckets + sub) + 0.5) * width;
+    }
+
+    struct Histogram
+    {
+        std::atomic<uint64_t> buckets[numBuckets];
+        std::atomic<uint64_t> count{ 0 }, sumNs{ 0 }, maxNs{ 0 };
+    };
+
+    struct Registry
+    {
+        Histogram stages[Telemetry::numStages];
+        std::atomic<uint64_t> counters[Telemetry::numCounters];
+        std::atomic<double> gauges[Telemetry::numGauges];
+        std::atomic<bool> recordAll{ false };
+
+        Registry() noexcept
+        {
+            for (auto& h : stages)
+                for (auto& b : h.buckets) b.store(0, std::memory_order_relaxed);
+            for (auto& c : counters) c.store(0, std::memory_order_relaxed);
+            for (auto& g : gauges) g.store(0.0, std::memory_order_relaxed);
+        }
+    };
+
+    // Constructed on first use, before any audio thread can record
+    Registry& registry() noexcept
+    {
+        static Registry r;
+        return r;
+    }
+
+   #if CANONKEY_TELEMETRY
+    thread_local bool threadRecording = false;
+   #endif
+
+    // Value below which fraction q of the events fall (bucket centre)
+    double percentileNs(const uint64_t* counts, uint64_t total, double q) noexcept
+    {
+        if (total == 0) return 0.0;
+        const auto rank = (uint64_t)std::ceil(q * (double)total);
+        uint64_t seen = 0;
+        for (int i = 0; i < numBuckets; ++i)
+        {
+            seen += counts[i];
+            if (seen >= rank) return bucketValue(i);
+        }
+        return bucketValue(numBuckets - 1);
+    }
+}
+
+namespace Telemetry
+{
+    const char* getName(Stage s) noexcept
+    {
+        switch (s)
+        {
+            case Stage::audioCallback: return "audioCallback";
+            case Stage::downmixPush:   return "downmixPush";
+            case Stage::stft:          return "stft";
+            case Stage::envelope:      return "envelope";
+            case Stage::acf:           return "acf";
+            case Stage::hpcp:          return "hpcp";
+            case Stage::viterbi:       return "viterbi";
+            default:                   return "?";
+        }
+    }
+
+    const char* getName(Counter c) noexcept
+    {
+        switch (c)
+        {
+            case Counter::audioBlocks:      return "audioBlocks";
+            case Counter::callbackOverruns: return "callbackOverruns";
+            case Counter::silentFrames:     return "silentFrames";
+            default:                        return "?";
+        }
+    }
+
+    const char* getName(Gauge g) noexcept
+    {
+        switch (g)
+        {
+            case Gauge::ringFill:       return "ringFill";
+            case Gauge::droppedSamples: return "droppedSamples";
+            case Gauge::analyzerLagMs:  return "analyzerLagMs";
+            case Gauge::analyzerLoad:   return "analyzerLoad";
+            case Gauge::qualityTier:    return "qualityTier";
+            case Gauge::xruns:          return "xruns";
+            default:                    return "?";
+        }
+    }
+
+    uint64_t nowNanos() noexcept
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+#if CANONKEY_TELEMETRY
+    void record(Stage s, uint64_t nanos) noexcept
+    {
+        auto& h = registry().stages[(int)s];
+        h.buckets[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+        h.count.fetch_add(1, std::memory_order_relaxed);
+        h.sumNs.fetch_add(nanos, std::memory_order_relaxed);
+
+        auto m = h.maxNs.load(std::memory_order_relaxed);
+        while (nanos > m && !h.maxNs.compare_exchange_weak(m, nanos, std::memory_order_relaxed)) {}
+    }
+
+    void increment(Counter c, uint64_t n) noexcept
+    {
+        registry().counters[(int)c].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void setGauge(Gauge g, double value) noexcept
+    {
+        registry().gauges[(int)g].store(value, std::memory_order_relaxed);
+    }
+
+    void reset() noexcept
+    {
+        auto& r = registry();
+        for (auto& h : r.stages)
+        {
+            for (auto& b : h.buckets) b.store(0, std::memory_order_relaxed);
+            h.count.store(0, std::memory_order_relaxed);
+            h.sumNs.store(0, std::memory_order_relaxed);
+            h.maxNs.store(0, std::memory_order_relaxed);
+        }
+        for (auto& c : r.counters) c.store(0, std::memory_order_relaxed);
+    }
+
+    bool isRecording() noexcept
+    {
+        return threadRecording || registry().recordAll.load(std::memory_order_relaxed);
+    }
+
+    void setRecordAllThreads(bool shouldRecord) noexcept { registry().recordAll.store(shouldRecord, std::memory_order_relaxed); }
+    void setThreadRecording(bool shouldRecord) noexcept  { threadRecording = shouldRecord; }
+    bool isThreadRecording() noexcept                    { return threadRecording; }
+#endif
+
+    Snapshot snapshot() noexcept
+    {
+        Snapshot out;
+        auto& r = registry();
+
+        for (int s = 0; s < numStages; ++s)
+        {
+            const auto& h = r.stages[s];
+            uint64_t counts[numBuckets];
+            uint64_t total = 0;
+            for (int i = 0; i < numBuckets; ++i)
+                total += (counts[i] = h.buckets[i].load(std::memory_order_relaxed));
+
+            auto& st = out.stages[s];
+            st.count = total;
+            if (total == 0) continue;
+
+            const auto n = juce::jmax<uint64_t>(1, h.count.load(std::memory_order_relaxed));
+            st.meanUs = 1.0e-3 * (double)h.sumNs.load(std::memory_order_relaxed) / (double)n;
+            st.p50Us = 1.0e-3 * percentileNs(counts, total, 0.50);
+            st.p99Us = 1.0e-3 * percentileNs(counts, total, 0.99);
+            st.maxUs = 1.0e-3 * (double)h.maxNs.load(std::memory_order_relaxed);
+        }
+
+        for (int c = 0; c < numCounters; ++c)
+            out.counters[c] = r.counters[c].load(std::memory_order_relaxed);
+        for (int g = 0; g < numGauges; ++g)
+            out.gauges[g] = r.gauges[g].load(std::memory_order_relaxed);
+        return out;
+    }
+
+    juce::var toVar(const Snapshot& s)
+    {
+        auto* root = new juce::DynamicObject();
+        root->setProperty("enabled", CANONKEY_TELEMETRY != 0);
+
+        auto* stages = new juce::DynamicObject();
+        for (int i = 0; i < numStages; ++i)
+        {
+            const auto& st = s.stages[i];
+            auto* o = new juce::DynamicObject();
+            o->setProperty("count", (juce::int64)st.count);
+            o->setProperty("meanUs", st.meanUs);
+            o->setProperty("p50Us", st.p50Us);
+            o->setProperty("p99Us", st.p99Us);
+            o->setProperty("maxUs", st.maxUs);
+            stages->setProperty(getName((Stage)i), juce::var(o));
+        }
+        root->setProperty("stages", juce::var(stages));
+
+        auto* counters = new juce::DynamicObject();
+        for (int i = 0; i < numCounters; ++i)
+            counters->setProperty(getName((Counter)i), (juce::int64)s.counters[i]);
+        root->setProperty("counters", juce::var(counters));
+
+        auto* gauges = new juce::DynamicObject();
+        for (int i = 0; i < numGauges; ++i)
+            gauges->setProperty(getName((Gauge)i), s.gauges[i]);
+        root->setProperty("gauges", juce::var(gauges));
+
+        return juce::var(root);
+    }
+
+    juce::String toJson(const Snapshot& s)
+    {
+        return juce::JSON::toString(toVar(s), true);
+    }
+
+    bool writeJson(const juce::File& file)
+    {
+        juce::TemporaryFile tmp(file);
+        return tmp.getFile().replaceWithText(toJson(snapshot()) + "\n")
+            && tmp.overwriteTargetFileWithTemporary();
+    }
+}
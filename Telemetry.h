@@ -0,0 +1,97 @@
+#pragma once
+#include <JuceHeader.h>
+#include <cstdint>
+
+// Runtime instrumentation: per-stage timing histograms, event counters and gauges.
+// Stage timers record only on threads that opted in (ScopedThreadRecording: the
+// audio callback and the live analyzer) or when recording is switched on for all
+// threads (CLI profiling), so file and batch analysis do not blur the live figures;
+// elsewhere a timer costs one thread-local read. Recording is relaxed atomics only,
+// no locks or allocation, so it is safe on the audio thread.
+// Build with CANONKEY_TELEMETRY=0 to compile recording out (snapshots read zeros).
+#ifndef CANONKEY_TELEMETRY
+ #define CANONKEY_TELEMETRY 1
+#endif
+
+namespace Telemetry
+{
+    enum class Stage { audioCallback, downmixPush, stft, envelope, acf, hpcp, viterbi, numStages };
+    enum class Counter { audioBlocks, callbackOverruns, silentFrames, numCounters };
+    enum class Gauge { ringFill, droppedSamples, analyzerLagMs, analyzerLoad, qualityTier, xruns, numGauges };
+
+    static constexpr int numStages = (int)Stage::numStages;
+    static constexpr int numCounters = (int)Counter::numCounters;
+    static constexpr int numGauges = (int)Gauge::numGauges;
+
+    const char* getName(Stage s) noexcept;
+    const char* getName(Counter c) noexcept;
+    const char* getName(Gauge g) noexcept;
+
+    // Monotonic clock for stage timing
+    uint64_t nowNanos() noexcept;
+
+#if CANONKEY_TELEMETRY
+    void record(Stage s, uint64_t nanos) noexcept;
+    void increment(Counter c, uint64_t n = 1) noexcept;
+    void setGauge(Gauge g, double value) noexcept;
+
+    // Clear histograms and counters (gauges keep their last value)
+    void reset() noexcept;
+
+    bool isRecording() noexcept;
+    void setRecordAllThreads(bool shouldRecord) noexcept;
+    void setThreadRecording(bool shouldRecord) noexcept;
+    bool isThreadRecording() noexcept;
+#else
+    inline void record(Stage, uint64_t) noexcept {}
+    inline void increment(Counter, uint64_t = 1) noexcept {}
+    inline void setGauge(Gauge, double) noexcept {}
+    inline void reset() noexcept {}
+    inline bool isRecording() noexcept { return false; }
+    inline void setRecordAllThreads(bool) noexcept {}
+    inline void setThreadRecording(bool) noexcept {}
+    inline bool isThreadRecording() noexcept { return false; }
+#endif
+
+    struct StageStats
+    {
+        uint64_t count = 0;
+        double meanUs = 0.0, p50Us = 0.0, p99Us = 0.0, maxUs = 0.0;   // percentiles to ~10%
+    };
+
+    struct Snapshot
+    {
+        StageStats stages[numStages];
+        uint64_t counters[numCounters] = {};
+        double gauges[numGauges] = {};
+    };
+
+    // Any thread; values may lag concurrent writers by a few events
+    Snapshot snapshot() noexcept;
+
+    juce::var toVar(const Snapshot& s);
+    juce::String toJson(const Snapshot& s);
+    // Replace file with the current snapshot as JSON (via a temporary, so scrapers never see half a file)
+    bool writeJson(const juce::File& file);
+
+    // RAII: record stage timers on this thread for the scope's lifetime
+    struct ScopedThreadRecording
+    {
+        ScopedThreadRecording() noexcept : previous(isThreadRecording()) { setThreadRecording(true); }
+        ~ScopedThreadRecording() noexcept { setThreadRecording(previous); }
+        ScopedThreadRecording(const ScopedThreadRecording&) = delete;
+        ScopedThreadRecording& operator=(const ScopedThreadRecording&) = delete;
+        const bool previous;
+    };
+
+    // RAII stage timer
+    struct ScopedStage
+    {
+        explicit ScopedStage(Stage s) noexcept : stage(s), start(isRecording() ? nowNanos() : 0) {}
+        ~ScopedStage() noexcept { if (start != 0) record(stage, nowNanos() - start); }
+        ScopedStage(const ScopedStage&) = delete;
+        ScopedStage& operator=(const ScopedStage&) = delete;
+        const Stage stage;
+        const uint64_t start;
+    };
+}
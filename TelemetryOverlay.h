@@ -0,0 +1,82 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Telemetry.h"
+
+// Debug overlay: the current Telemetry snapshot as a small table.
+// Polls at 4 Hz only while visible; never takes mouse clicks.
+class TelemetryOverlay : public juce::Component, private juce::Timer
+{
+public:
+    TelemetryOverlay()
+    {
+        setInterceptsMouseClicks (false, false);
+    }
+
+    void visibilityChanged() override
+    {
+        if (isVisible())
+        {
+            timerCallback();
+            startTimerHz (4);
+        }
+        else
+        {
+            stopTimer();
+        }
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        g.setColour (juce::Colour (0xe00b1220));
+        g.fillRoundedRectangle (getLocalBounds().toFloat(), 10.0f);
+
+        g.setFont (juce::Font (juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain));
+        g.setColour (juce::Colours::white);
+
+        auto area = getLocalBounds().reduced (12, 8);
+        auto line = [&] (const juce::String& text)
+        {
+            g.drawText (text, area.removeFromTop (16), juce::Justification::centredLeft, false);
+        };
+
+        line ("stage            count    mean     p50     p99     max  (us)");
+        for (int i = 0; i < Telemetry::numStages; ++i)
+        {
+            const auto& st = snap.stages[i];
+            line (juce::String (Telemetry::getName ((Telemetry::Stage) i)).paddedRight (' ', 14)
+                  + juce::String ((juce::int64) st.count).paddedLeft (' ', 9)
+                  + juce::String (st.meanUs, 1).paddedLeft (' ', 8)
+                  + juce::String (st.p50Us, 1).paddedLeft (' ', 8)
+                  + juce::String (st.p99Us, 1).paddedLeft (' ', 8)
+                  + juce::String (st.maxUs, 1).paddedLeft (' ', 8));
+        }
+
+        area.removeFromTop (6);
+        const auto gauge = [this] (Telemetry::Gauge gg) { return snap.gauges[(int) gg]; };
+        const auto counter = [this] (Telemetry::Counter c) { return (juce::int64) snap.counters[(int) c]; };
+
+        line (juce::String::formatted ("ring fill %5.1f%%   dropped %.0f   analyzer lag %.1f ms",
+                                       100.0 * gauge (Telemetry::Gauge::ringFill),
+                                       gauge (Telemetry::Gauge::droppedSamples),
+                                       gauge (Telemetry::Gauge::analyzerLagMs)));
+        line (juce::String::formatted ("analyzer load %5.1f%%   quality tier %d",
+                                       100.0 * gauge (Telemetry::Gauge::analyzerLoad),
+                                       (int) gauge (Telemetry::Gauge::qualityTier)));
+        line ("blocks " + juce::String (counter (Telemetry::Counter::audioBlocks))
+              + "   overruns " + juce::String (counter (Telemetry::Counter::callbackOverruns))
+              + "   xruns " + juce::String ((juce::int64) gauge (Telemetry::Gauge::xruns))
+              + "   silent frames " + juce::String (counter (Telemetry::Counter::silentFrames)));
+    }
+
+    // Height that fits every line
+    static int getPreferredHeight() noexcept { return 16 * (Telemetry::numStages + 4) + 6 + 16; }
+
+private:
+    Telemetry::Snapshot snap;
+
+    void timerCallback() override
+    {
+        snap = Telemetry::snapshot();
+        repaint();
+    }
+};
@@ -7,6 +7,7 @@
 #pragma comment(lib, "Mmdevapi.lib")
 //#pragma comment(lib, "audioclient.lib")
 #pragma comment(lib, "Uuid.lib")
+#pragma comment(lib, "Avrt.lib")
 
 WasapiLoopback::WasapiLoopback() {}
 WasapiLoopback::~WasapiLoopback() { stop(); }
@@ -15,11 +16,30 @@ bool WasapiLoopback::start(BlockCB cb, juce::String& error)
 {
     if (running.load()) return true;
     onBlock = std::move(cb);
+    onInterleaved = nullptr;
+    return startCapture(error);
+}
+
+bool WasapiLoopback::startInterleaved(InterleavedCB cb, juce::String& error)
+{
+    if (running.load()) return true;
+    onInterleaved = std::move(cb);
+    onBlock = nullptr;
+    return startCapture(error);
+}
 
+bool WasapiLoopback::startCapture(juce::String& error)
+{
     HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
     if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) { error = "CoInitializeEx failed"; return false; }
 
-    if (!initClient(error)) { releaseAll(); return false; }
+    // Loopback + event callback needs Windows 10 1703+; fall back to polling
+    if (!initClient(true, error))
+    {
+        releaseAll();
+        error.clear();
+        if (!initClient(false, error)) { releaseAll(); return false; }
+    }
 
     running.store(true);
     worker = std::thread(&WasapiLoopback::threadProc, this);
@@ -34,8 +54,10 @@ void WasapiLoopback::stop()
     CoUninitialize();
 }
 
-bool WasapiLoopback::initClient(juce::String& error)
+bool WasapiLoopback::initClient(bool useEvent, juce::String& error)
 {
+    eventDriven.store(false);
+
     HRESULT hr = CoCreateInstance(__uuidof (MMDeviceEnumerator), nullptr, CLSCTX_ALL,
         __uuidof (IMMDeviceEnumerator), (void**)&enumerator);
     if (FAILED(hr)) { error = "MMDeviceEnumerator create failed"; return false; }
@@ -49,12 +71,44 @@ bool WasapiLoopback::initClient(juce::String& error)
     hr = client->GetMixFormat(&mixFmt);
     if (FAILED(hr)) { error = "GetMixFormat failed"; return false; }
 
+    // Shared-mode mix formats are float32 in practice; accept the packed PCM layouts
+    // too. The sample type comes from the format tag (or the extensible SubFormat),
+    // never from the bit depth alone: 32-bit integer PCM is not float.
+    bool isFloat = mixFmt->wFormatTag == WAVE_FORMAT_IEEE_FLOAT;
+    bool isPcm = mixFmt->wFormatTag == WAVE_FORMAT_PCM;
+    if (mixFmt->wFormatTag == WAVE_FORMAT_EXTENSIBLE && mixFmt->cbSize >= 22)
+    {
+        const auto& sub = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(mixFmt)->SubFormat;
+        isFloat = IsEqualGUID(sub, KSDATAFORMAT_SUBTYPE_IEEE_FLOAT) != FALSE;
+        isPcm = IsEqualGUID(sub, KSDATAFORMAT_SUBTYPE_PCM) != FALSE;
+    }
+
+    if (isFloat && mixFmt->wBitsPerSample == 32)      format = SimdKernels::SampleFormat::float32;
+    else if (isPcm && mixFmt->wBitsPerSample == 24)   format = SimdKernels::SampleFormat::int24;
+    else if (isPcm && mixFmt->wBitsPerSample == 16)   format = SimdKernels::SampleFormat::int16;
+    else
+    {
+        error = "Unsupported loopback mix format (" + juce::String(mixFmt->wBitsPerSample) + "-bit "
+            + (isFloat ? "float" : (isPcm ? "integer PCM" : "unknown type")) + ")";
+        return false;
+    }
+
     REFERENCE_TIME hnsBuffer = 20 * 10000; // 20ms
+    const DWORD streamFlags = AUDCLNT_STREAMFLAGS_LOOPBACK | (useEvent ? AUDCLNT_STREAMFLAGS_EVENTCALLBACK : 0);
     hr = client->Initialize(AUDCLNT_SHAREMODE_SHARED,
-        AUDCLNT_STREAMFLAGS_LOOPBACK,
+        streamFlags,
         hnsBuffer, 0, mixFmt, nullptr);
     if (FAILED(hr)) { error = "IAudioClient Initialize (loopback) failed"; return false; }
 
+    if (useEvent)
+    {
+        samplesReady = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+        if (samplesReady == nullptr) { error = "CreateEvent failed"; return false; }
+
+        hr = client->SetEventHandle(samplesReady);
+        if (FAILED(hr)) { error = "IAudioClient SetEventHandle failed"; return false; }
+    }
+
     hr = client->GetBufferSize(&bufferFrames);
     if (FAILED(hr)) { error = "GetBufferSize failed"; return false; }
 
@@ -64,12 +118,20 @@ bool WasapiLoopback::initClient(juce::String& error)
     sampleRate = (double)mixFmt->nSamplesPerSec;
 
     const int channels = mixFmt->nChannels;
-    planar.resize((size_t)channels);
-    for (auto& ch : planar) ch.assign((size_t)bufferFrames, 0.0f);
+    planar.clear();
+    planarPtrs.clear();
+    if (onBlock)
+    {
+        planar.resize((size_t)channels);
+        for (auto& ch : planar) ch.assign((size_t)bufferFrames, 0.0f);
+        planarPtrs.resize((size_t)channels, nullptr);
+    }
+    planarSilent = true;
 
     hr = client->Start();
     if (FAILED(hr)) { error = "IAudioClient Start failed"; return false; }
 
+    eventDriven.store(useEvent);
     return true;
 }
 
@@ -77,6 +139,36 @@ void WasapiLoopback::threadProc()
 {
     const int channels = (int)mixFmt->nChannels;
 
+    // MMCSS: scheduled like an audio engine thread (no-op if the service is unavailable)
+    DWORD taskIndex = 0;
+    HANDLE mmcss = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
+
+    while (running.load())
+    {
+        if (eventDriven.load(std::memory_order_relaxed))
+        {
+            // Timeout so stop() is noticed while the endpoint is idle. Builds before
+            // 1703 accept the event flag for loopback but never signal it: data found
+            // after a timeout means the event is dead, so poll from then on.
+            if (WaitForSingleObject(samplesReady, 100) == WAIT_OBJECT_0)
+                drainPackets(channels);
+            else if (drainPackets(channels) > 0)
+                eventDriven.store(false, std::memory_order_relaxed);
+        }
+        else if (drainPackets(channels) == 0)
+        {
+            juce::Thread::sleep(2);
+        }
+    }
+
+    if (client) client->Stop();
+    if (mmcss) AvRevertMmThreadCharacteristics(mmcss);
+}
+
+int WasapiLoopback::drainPackets(int channels)
+{
+    // One event can cover several packets: read until the endpoint is empty
+    int packets = 0;
     while (running.load())
     {
         UINT32 packetFrames = 0;
@@ -84,51 +176,87 @@ void WasapiLoopback::threadProc()
         BYTE* data = nullptr;
 
         HRESULT hr = capture->GetNextPacketSize(&packetFrames);
-        if (FAILED(hr)) { juce::Thread::sleep(2); continue; }
-
-        if (packetFrames == 0) { juce::Thread::sleep(2); continue; }
+        if (FAILED(hr) || packetFrames == 0) break;
 
         hr = capture->GetBuffer(&data, &packetFrames, &flags, nullptr, nullptr);
-        if (FAILED(hr)) { juce::Thread::sleep(2); continue; }
+        if (FAILED(hr)) break;
 
-        const int bps = mixFmt->wBitsPerSample;
-        const bool isFloat = (bps == 32);
+        deliverPacket(data, packetFrames, flags, channels);
+        capture->ReleaseBuffer(packetFrames);
+        ++packets;
+    }
+    return packets;
+}
 
-        for (auto& ch : planar) if ((int)ch.size() < (int)packetFrames) ch.resize(packetFrames);
+void WasapiLoopback::deliverPacket(const BYTE* data, UINT32 packetFrames, DWORD flags, int channels)
+{
+    const bool silent = (flags & AUDCLNT_BUFFERFLAGS_SILENT) != 0;
+    if ((flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY) != 0)
+        discontinuities.fetch_add(1, std::memory_order_relaxed);
+
+    if (onInterleaved)
+    {
+        // Contents of data must be ignored for silent packets
+        onInterleaved(silent ? nullptr : data, format, channels, (int)packetFrames, sampleRate);
+        return;
+    }
 
-        if (isFloat)
+    if (!onBlock) return;
+
+    for (auto& ch : planar)
+    {
+        if ((int)ch.size() < (int)packetFrames)
         {
-            const float* interleaved = reinterpret_cast<const float*> (data);
-            for (int c = 0; c < channels; ++c)
-            {
-                float* dst = planar[(size_t)c].data();
-                for (UINT32 i = 0; i < packetFrames; ++i)
-                    dst[i] = interleaved[i * channels + c];
-            }
+            ch.resize(packetFrames);
+            planarSilent = false;
         }
-        else
+    }
+
+    if (silent)
+    {
+        // Hand out zeros (cleared once per silent run)
+        if (!planarSilent)
         {
-            const int16_t* inter = reinterpret_cast<const int16_t*> (data);
-            for (int c = 0; c < channels; ++c)
-            {
-                float* dst = planar[(size_t)c].data();
-                for (UINT32 i = 0; i < packetFrames; ++i)
-                    dst[i] = (float)inter[i * channels + c] / 32768.0f;
-            }
+            for (auto& ch : planar) std::fill(ch.begin(), ch.end(), 0.0f);
+            planarSilent = true;
         }
-
-        if (onBlock)
+    }
+    else
+    {
+        for (int c = 0; c < channels; ++c)
         {
-            const float* ptrs[16] = {};
-            for (int c = 0; c < channels && c < 16; ++c)
-                ptrs[c] = planar[(size_t)c].data();
-            onBlock(ptrs, channels, (int)packetFrames, sampleRate);
+            float* dst = planar[(size_t)c].data();
+            switch (format)
+            {
+                case SimdKernels::SampleFormat::float32:
+                {
+                    const float* inter = reinterpret_cast<const float*> (data);
+                    for (UINT32 i = 0; i < packetFrames; ++i)
+                        dst[i] = inter[i * channels + c];
+                    break;
+                }
+                case SimdKernels::SampleFormat::int16:
+                {
+                    const int16_t* inter = reinterpret_cast<const int16_t*> (data);
+                    for (UINT32 i = 0; i < packetFrames; ++i)
+                        dst[i] = (float)inter[i * channels + c] / 32768.0f;
+                    break;
+                }
+                case SimdKernels::SampleFormat::int24:
+                {
+                    const BYTE* p = data + 3 * c;
+                    for (UINT32 i = 0; i < packetFrames; ++i, p += 3 * channels)
+                        dst[i] = (float)((int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8) / 8388608.0f;
+                    break;
+                }
+            }
         }
-
-        capture->ReleaseBuffer(packetFrames);
+        planarSilent = false;
     }
 
-    if (client) client->Stop();
+    for (int c = 0; c < channels; ++c)
+        planarPtrs[(size_t)c] = planar[(size_t)c].data();
+    onBlock(planarPtrs.data(), channels, (int)packetFrames, sampleRate);
 }
 
 void WasapiLoopback::releaseAll()
@@ -138,5 +266,6 @@ void WasapiLoopback::releaseAll()
     if (client) { client->Release();      client = nullptr; }
     if (renderDevice) { renderDevice->Release(); renderDevice = nullptr; }
     if (enumerator) { enumerator->Release();  enumerator = nullptr; }
+    if (samplesReady) { CloseHandle(samplesReady); samplesReady = nullptr; }
 }
 #endif // JUCE_WINDOWS
@@ -14,34 +14,57 @@
 #include <windows.h>
 #include <mmdeviceapi.h>
 #include <audioclient.h>
+#include <mmreg.h>
+#include <ksmedia.h>
+#include <avrt.h>
 
+#include "SimdKernels.h"
 #include <functional>
 #include <atomic>
 #include <thread>
 #include <vector>
 
 // Very small WASAPI loopback capturer
-// Calls onBlock with planar float** buffers.
+// Calls onBlock with planar float** buffers, or hands the endpoint's interleaved
+// packets to onInterleaved untouched (no deinterleave, no channel limit).
+// Event-driven (AUDCLNT_STREAMFLAGS_EVENTCALLBACK) where the OS supports it
+// for loopback, sleep-polling otherwise; the capture thread joins MMCSS "Pro Audio".
 class WasapiLoopback
 {
 public:
     using BlockCB = std::function<void(const float* const* input, int numCh, int numSamples, double sampleRate)>;
 
+    // frames == nullptr for packets flagged silent (numFrames of zeros)
+    using InterleavedCB = std::function<void(const void* frames, SimdKernels::SampleFormat format,
+        int numCh, int numFrames, double sampleRate)>;
+
     WasapiLoopback();
     ~WasapiLoopback();
 
     bool start(BlockCB cb, juce::String& error);
+    bool startInterleaved(InterleavedCB cb, juce::String& error);
     void stop();
     bool isRunning() const { return running.load(); }
 
+    // True when the capture thread waits on the client's event instead of polling
+    // (drops to polling if the event never fires)
+    bool isEventDriven() const { return eventDriven.load(std::memory_order_relaxed); }
+
+    // Packets the endpoint flagged as following a gap (capture glitches, the loopback xrun count)
+    int getDiscontinuityCount() const noexcept { return discontinuities.load(std::memory_order_relaxed); }
+
 private:
     void threadProc();
-    bool initClient(juce::String& error);
+    bool startCapture(juce::String& error);
+    bool initClient(bool useEvent, juce::String& error);
+    int  drainPackets(int channels);   // returns packets delivered
+    void deliverPacket(const BYTE* data, UINT32 frames, DWORD flags, int channels);
     void releaseAll();
 
     std::thread       worker;
     std::atomic<bool> running{ false };
     BlockCB           onBlock;
+    InterleavedCB     onInterleaved;
 
     // COM interfaces
     IMMDeviceEnumerator* enumerator = nullptr;
@@ -52,9 +75,16 @@ private:
     WAVEFORMATEX* mixFmt = nullptr; // freed via CoTaskMemFree
     UINT32        bufferFrames = 0;
     double        sampleRate = 0.0;
+    SimdKernels::SampleFormat format = SimdKernels::SampleFormat::float32;
+
+    HANDLE samplesReady = nullptr;  // signalled by WASAPI in event mode
+    std::atomic<bool> eventDriven{ false };   // written by the capture thread once it polls
+    std::atomic<int> discontinuities{ 0 };
 
-    // scratch planar buffers
+    // scratch planar buffers (planar callback only)
     std::vector<std::vector<float>> planar;
+    std::vector<const float*> planarPtrs;
+    bool planarSilent = false;      // planar already holds zeros (silent packets skip the deinterleave)
 };
 
 #endif // JUCE_WINDOWS